@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "asm.h"
+
+AsmProgram* createAsmProgram() {
+    return calloc(1, sizeof(AsmProgram));
+}
+
+static char* copyString(const char *s) {
+    char *copy = malloc(strlen(s) + 1);
+    strcpy(copy, s);
+    return copy;
+}
+
+static AsmLine* appendLine(AsmProgram *program, AsmKind kind) {
+    AsmLine *line = calloc(1, sizeof(AsmLine));
+    line->kind = kind;
+    line->prev = program->last;
+    if (program->last) program->last->next = line;
+    else program->first = line;
+    program->last = line;
+    return line;
+}
+
+static void copyTrimmed(char *dst, const char *start, const char *end, int size) {
+    while (start < end && isspace((unsigned char) *start)) start++;
+    while (end > start && isspace((unsigned char) end[-1])) end--;
+    int len = (int) (end - start);
+    if (len >= size) len = size - 1;
+    memcpy(dst, start, len);
+    dst[len] = '\0';
+}
+
+AsmLine* appendAsmInstr(AsmProgram *program, const char *text) {
+    AsmLine *line = appendLine(program, ASM_INSTR);
+    program->instrCount++;
+
+    const char *p = text;
+    while (*p && !isspace((unsigned char) *p)) p++;
+    copyTrimmed(line->mnemonic, text, p, MAX_ASM_MNEMONIC);
+
+    // Gli operandi sono separati dalla virgola fuori da [] e da apici
+    while (*p && line->operandCount < MAX_ASM_OPERANDS) {
+        const char *start = p;
+        int depth = 0, quoted = 0;
+        while (*p && (depth > 0 || quoted || *p != ',')) {
+            if (*p == '\'') quoted = !quoted;
+            else if (!quoted && *p == '[') depth++;
+            else if (!quoted && *p == ']') depth--;
+            p++;
+        }
+        copyTrimmed(line->operands[line->operandCount], start, p, MAX_ASM_OPERAND);
+        if (line->operands[line->operandCount][0]) line->operandCount++;
+        if (*p == ',') p++;
+    }
+    return line;
+}
+
+AsmLine* appendAsmLabel(AsmProgram *program, const char *name) {
+    AsmLine *line = appendLine(program, ASM_LABEL);
+    line->text = copyString(name);
+    return line;
+}
+
+AsmLine* appendAsmDirective(AsmProgram *program, const char *text) {
+    AsmLine *line = appendLine(program, ASM_DIRECTIVE);
+    line->text = copyString(text);
+    return line;
+}
+
+void setAsmInstr(AsmLine *line, const char *mnemonic, const char *op0, const char *op1) {
+    strncpy(line->mnemonic, mnemonic, MAX_ASM_MNEMONIC - 1);
+    line->operandCount = 0;
+    if (op0) strncpy(line->operands[line->operandCount++], op0, MAX_ASM_OPERAND - 1);
+    if (op1) strncpy(line->operands[line->operandCount++], op1, MAX_ASM_OPERAND - 1);
+}
+
+void removeAsmLine(AsmProgram *program, AsmLine *line) {
+    if (line->prev) line->prev->next = line->next;
+    else program->first = line->next;
+    if (line->next) line->next->prev = line->prev;
+    else program->last = line->prev;
+    if (line->kind == ASM_INSTR) program->instrCount--;
+    free(line->text);
+    free(line);
+}
+
+void printAsm(AsmProgram *program, FILE *out) {
+    for (AsmLine *line = program->first; line; line = line->next) {
+        switch (line->kind) {
+            case ASM_LABEL:
+                // Riga vuota prima di ogni routine (etichette non locali)
+                if (line->text[0] != '.' && line != program->first) fprintf(out, "\n");
+                fprintf(out, "%s:\n", line->text);
+                break;
+            case ASM_DIRECTIVE:
+                fprintf(out, "%s\n", line->text);
+                break;
+            case ASM_INSTR:
+                fprintf(out, "%s", line->mnemonic);
+                for (int i = 0; i < line->operandCount; i++) {
+                    fprintf(out, "%s%s", i == 0 ? " " : ", ", line->operands[i]);
+                }
+                fprintf(out, "\n");
+                break;
+        }
+    }
+}
+
+void freeAsmProgram(AsmProgram *program) {
+    if (!program) return;
+    AsmLine *line = program->first;
+    while (line) {
+        AsmLine *next = line->next;
+        free(line->text);
+        free(line);
+        line = next;
+    }
+    free(program);
+}
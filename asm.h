@@ -0,0 +1,46 @@
+#ifndef ASM_H
+#define ASM_H
+
+#include <stdio.h>
+
+// Programma assembly in memoria: il codegen accoda le righe, il peephole le
+// riscrive e solo alla fine vengono stampate in sintassi NASM.
+
+#define MAX_ASM_OPERANDS 3     // imul r, r/m, imm
+#define MAX_ASM_OPERAND  64
+#define MAX_ASM_MNEMONIC 16
+
+typedef enum {
+    ASM_INSTR,      // mnemonico + operandi
+    ASM_LABEL,      // etichetta (senza ':')
+    ASM_DIRECTIVE   // section, global, dati: stampate così come sono
+} AsmKind;
+
+typedef struct AsmLine {
+    AsmKind kind;
+    char mnemonic[MAX_ASM_MNEMONIC];
+    char operands[MAX_ASM_OPERANDS][MAX_ASM_OPERAND];
+    int operandCount;
+    char *text;                     // nome dell'etichetta o testo della direttiva
+    struct AsmLine *prev, *next;
+} AsmLine;
+
+typedef struct {
+    AsmLine *first, *last;
+    int instrCount;
+} AsmProgram;
+
+AsmProgram* createAsmProgram();
+
+// Accoda una riga; le istruzioni vengono scomposte in mnemonico e operandi
+AsmLine* appendAsmInstr(AsmProgram *program, const char *text);
+AsmLine* appendAsmLabel(AsmProgram *program, const char *name);
+AsmLine* appendAsmDirective(AsmProgram *program, const char *text);
+
+void setAsmInstr(AsmLine *line, const char *mnemonic, const char *op0, const char *op1);
+void removeAsmLine(AsmProgram *program, AsmLine *line);
+
+void printAsm(AsmProgram *program, FILE *out);
+void freeAsmProgram(AsmProgram *program);
+
+#endif // ASM_H
@@ -2,59 +2,125 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
+#include "intern.h"
 
-ASTNode* createASTNode(ASTNodeType type, const char* value) {
-    ASTNode* node = (ASTNode*) malloc(sizeof(ASTNode));
-    if (!node) return NULL;
+// ---------- ARENA ----------
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used, size;
+    char data[];
+} ArenaChunk;
+
+static _Thread_local ArenaChunk *arena = NULL;
+static _Thread_local int nodeCount = 0;
+
+// Allocazione a puntatore crescente, allineata a 8 byte; la memoria si
+// rilascia solo tutta insieme con freeAST()
+static void* arenaAlloc(size_t size) {
+    size = (size + 7) & ~(size_t) 7;
+    if (!arena || arena->used + size > arena->size) {
+        size_t chunkSize = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + chunkSize);
+        if (!chunk) {
+            fprintf(stderr, "Memoria esaurita per l'AST\n");
+            exit(EXIT_FAILURE);
+        }
+        chunk->next = arena;
+        chunk->used = 0;
+        chunk->size = chunkSize;
+        arena = chunk;
+    }
+    void *p = arena->data + arena->used;
+    arena->used += size;
+    return p;
+}
+
+// ---------- NODI ----------
+
+ASTNode* createASTNode(ASTNodeType type, int childCount) {
+    ASTNode* node = arenaAlloc(sizeof(ASTNode) + sizeof(ASTNode*) * childCount);
+    nodeCount++;
     node->type = type;
-    strncpy(node->value, value ? value : "", MAX_NODE_VALUE);
-    node->childCount = 0;
-    for (int i = 0; i < MAX_CHILDREN; i++) {
+    node->childCount = childCount;
+    node->number = 0;
+    for (int i = 0; i < childCount; i++) {
         node->children[i] = NULL;
     }
     return node;
 }
 
-void addChild(ASTNode *parent, ASTNode *child) {
-    if (parent->childCount < MAX_CHILDREN) {
-        parent->children[parent->childCount++] = child;
-    }
+ASTNode* createNumberNode(long long value) {
+    ASTNode *node = createASTNode(AST_LITERAL, 0);
+    node->number = value;
+    return node;
 }
 
-void printAST(ASTNode *node, int indent) {
+ASTNode* createTextNode(ASTNodeType type, const char *text, int length, int childCount) {
+    ASTNode *node = createASTNode(type, childCount);
+    char *copy = arenaAlloc(length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    node->text = copy;
+    return node;
+}
+
+int countNodes(ASTNode *node) {
+    if (!node) return 0;
+    int count = 1;
+    for (int i = 0; i < node->childCount; i++) count += countNodes(node->children[i]);
+    return count;
+}
+
+int assignedSymbol(ASTNode *node) {
+    if (node->type == AST_VAR_DECL) return node->symbol;
+    if (node->type == AST_ASSIGNMENT) return node->children[0]->symbol;
+    return -1;
+}
+
+void printAST(ASTNode *node, int indent, FILE *out) {
     if (!node) return;
     for (int i = 0; i < indent; i++) {
-        printf("  ");
+        fputs("  ", out);
     }
 
     // Stampa il tipo di nodo e l’eventuale value
     switch (node->type) {
-        case AST_PROGRAM:      printf("PROGRAM\n"); break;
-        case AST_VAR_DECL:     printf("VAR_DECL (%s)\n", node->value); break;
-        case AST_ASSIGNMENT:   printf("ASSIGNMENT\n"); break;
-        case AST_IF:           printf("IF\n"); break;
-        case AST_LOOP:         printf("LOOP\n"); break;
-        case AST_FUNCTION_DEF: printf("FUNCTION_DEF (%s)\n", node->value); break;
-        case AST_RETURN:       printf("RETURN\n"); break;
-        case AST_PRINT:        printf("PRINT\n"); break;
-        case AST_BLOCK:        printf("BLOCK\n"); break;
-        case AST_BINARY_EXPR:  printf("BINARY_EXPR (%s)\n", node->value); break;
-        case AST_LITERAL:      printf("LITERAL (%s)\n", node->value); break;
-        case AST_IDENTIFIER:   printf("IDENTIFIER (%s)\n", node->value); break;
-        case AST_BREAK:        printf("BREAK\n"); break; 
-        default:               printf("UNKNOWN\n"); break;
+        case AST_PROGRAM:      fprintf(out, "PROGRAM\n"); break;
+        case AST_VAR_DECL:     fprintf(out, "VAR_DECL (%s)\n", symbolName(node->symbol)); break;
+        case AST_ASSIGNMENT:   fprintf(out, "ASSIGNMENT\n"); break;
+        case AST_IF:           fprintf(out, "IF\n"); break;
+        case AST_LOOP:         fprintf(out, "LOOP\n"); break;
+        case AST_FUNCTION_DEF: fprintf(out, "FUNCTION_DEF (%s)\n", symbolName(node->symbol)); break;
+        case AST_RETURN:       fprintf(out, "RETURN\n"); break;
+        case AST_PRINT:        fprintf(out, "PRINT\n"); break;
+        case AST_BLOCK:        fprintf(out, "BLOCK\n"); break;
+        case AST_BINARY_EXPR:  fprintf(out, "BINARY_EXPR (%s)\n", node->text); break;
+        case AST_LITERAL:      fprintf(out, "LITERAL (%lld)\n", node->number); break;
+        case AST_STRING:       fprintf(out, "LITERAL (%s)\n", node->text); break;
+        case AST_IDENTIFIER:   fprintf(out, "IDENTIFIER (%s)\n", symbolName(node->symbol)); break;
+        case AST_BREAK:        fprintf(out, "BREAK\n"); break;
+        case AST_CALL:         fprintf(out, "CALL (%s)\n", symbolName(node->symbol)); break;
+        default:               fprintf(out, "UNKNOWN\n"); break;
     }
 
     // Stampa i figli ricorsivamente
     for (int i = 0; i < node->childCount; i++) {
-        printAST(node->children[i], indent + 1);
+        printAST(node->children[i], indent + 1, out);
     }
 }
 
-void freeAST(ASTNode *node) {
-    if (!node) return;
-    for (int i = 0; i < node->childCount; i++) {
-        freeAST(node->children[i]);
+int astNodeCount() {
+    return nodeCount;
+}
+
+void freeAST() {
+    nodeCount = 0;
+    while (arena) {
+        ArenaChunk *next = arena->next;
+        free(arena);
+        arena = next;
     }
-    free(node);
 }
@@ -1,8 +1,7 @@
 #ifndef AST_H
 #define AST_H
 
-#define MAX_NODE_VALUE 128
-#define MAX_CHILDREN   10
+#include <stdio.h>
 
 typedef enum {
     AST_PROGRAM,
@@ -15,25 +14,35 @@ typedef enum {
     AST_PRINT,
     AST_BLOCK,
     AST_BINARY_EXPR,
-    AST_LITERAL,
+    AST_LITERAL,        // letterale intero
     AST_IDENTIFIER,
     AST_BREAK,
+    AST_CALL,
+    AST_STRING,         // letterale non intero (stringa o float), conservato come testo
     // ...eventuali altri
 } ASTNodeType;
 
+// I nodi vivono in un'arena e hanno la dimensione di ciò che contengono:
+// i figli sono uno span contiguo subito dopo il nodo, fissato alla creazione.
 typedef struct ASTNode {
     ASTNodeType type;
-    char value[MAX_NODE_VALUE]; // es: nome funzione, operatore, stringa
-
-    // Per un albero più generico, possiamo usare un array di puntatori a figli
-    struct ASTNode* children[MAX_CHILDREN];
     int childCount;
+    union {
+        int symbol;         // VAR_DECL, IDENTIFIER, FUNCTION_DEF, CALL: ID interned del nome
+        long long number;   // LITERAL
+        const char *text;   // STRING (escape compresi), BINARY_EXPR: operatore ("-u" per il meno unario, "!" per il not)
+    };
+    struct ASTNode *children[];
 } ASTNode;
 
-// Funzioni per la creazione e gestione dell'AST
-ASTNode* createASTNode(ASTNodeType type, const char* value);
-void addChild(ASTNode *parent, ASTNode *child);
-void printAST(ASTNode *node, int indent);
-void freeAST(ASTNode *node);
+// Funzioni per la creazione e gestione dell'AST. I figli partono a NULL.
+ASTNode* createASTNode(ASTNodeType type, int childCount);
+ASTNode* createNumberNode(long long value);
+ASTNode* createTextNode(ASTNodeType type, const char *text, int length, int childCount);
+void printAST(ASTNode *node, int indent, FILE *out);
+int countNodes(ASTNode *node);      // nodi del sottoalbero, 0 per NULL
+int assignedSymbol(ASTNode *node);  // simbolo scritto da VAR o assegnamento, altrimenti -1
+void freeAST();     // rilascia in un colpo solo tutti i nodi creati
+int astNodeCount(); // nodi creati dall'ultima freeAST()
 
 #endif // AST_H
@@ -0,0 +1,112 @@
+# Funzioni comuni agli script di bench/ (da includere con ".").
+#
+# Prepara una directory di lavoro temporanea ($work) e vi compila
+# bench/measure.c; i programmi di supporto si compilano con $CC (predefinito
+# cc). Le misure di tempo prendono il migliore di $RUNS esecuzioni
+# (predefinito 5). Le variabili interne delle funzioni cominciano con _ per
+# non toccare quelle degli script.
+
+bench=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$bench")
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cc=${CC:-cc}
+runs=${RUNS:-5}
+
+if ! "$cc" -O2 -o "$work/measure" "$bench/measure.c"; then
+    echo "Impossibile compilare bench/measure.c con $cc" >&2
+    exit 2
+fi
+
+# Percorso assoluto di un compilatore già costruito; esce se manca
+compiler_path() {
+    if [ ! -x "$1" ]; then
+        echo "Compilatore non trovato: $1" >&2
+        exit 2
+    fi
+    case $1 in
+        /*) echo "$1" ;;
+        *) echo "$(pwd)/$1" ;;
+    esac
+}
+
+# Primo commit della richiesta $1 ("user-023"): la modifica da misurare,
+# senza le richieste successive
+revision_of() {
+    _first=$(git -C "$root" log --format=%h --grep="^\[$1\]" | tail -n 1)
+    if [ -z "$_first" ]; then
+        echo "Nessun commit [$1] nella storia di $root" >&2
+        exit 2
+    fi
+    echo "$_first"
+}
+
+# Commit che precede il primo commit della richiesta $1: l'albero com'era
+# prima della modifica da misurare
+revision_before() {
+    _first=$(revision_of "$1") || exit 2
+    echo "$_first^"
+}
+
+# Compila il compilatore della revisione git $1 e ne stampa il percorso.
+# $1 può anche essere un compilatore già costruito.
+reference_compiler() {
+    if [ -x "$1" ] && [ ! -d "$1" ]; then
+        compiler_path "$1"
+        return
+    fi
+    _dir=$work/rif-$(echo "$1" | tr -c 'A-Za-z0-9_\n-' _)
+    mkdir -p "$_dir"
+    if ! git -C "$root" archive "$1" | tar -x -C "$_dir"; then
+        echo "Revisione non trovata: $1" >&2
+        exit 2
+    fi
+    if ! (cd "$_dir" && "$cc" -O2 -pthread -o compiler *.c 2>/dev/null); then
+        echo "Impossibile compilare la revisione $1" >&2
+        exit 2
+    fi
+    echo "$_dir/compiler"
+}
+
+# build_elf <compilatore> <sorgente> <eseguibile>. Le revisioni che non
+# hanno -o scrivono output.asm nella directory corrente: si passa da nasm e ld.
+build_elf() {
+    "$1" -o "$3" "$2" > /dev/null 2>&1 && return 0
+    _asmdir=$work/asm
+    rm -rf "$_asmdir"
+    mkdir -p "$_asmdir"
+    _source=$(cd "$(dirname "$2")" && pwd)/$(basename "$2")
+    (cd "$_asmdir" && "$1" "$_source" > /dev/null 2>&1)
+    if [ ! -f "$_asmdir/output.asm" ]; then
+        echo "Compilazione fallita: $2" >&2
+        return 1
+    fi
+    if ! command -v nasm >/dev/null 2>&1 || ! command -v ld >/dev/null 2>&1; then
+        echo "Servono nasm e ld per il compilatore $1" >&2
+        return 1
+    fi
+    nasm -f elf64 -o "$_asmdir/output.o" "$_asmdir/output.asm" && ld -o "$3" "$_asmdir/output.o"
+}
+
+# Tempo migliore in ms di un comando, su $runs esecuzioni
+best_ms() {
+    "$work/measure" -n "$runs" "$@" | sed 's/^ms=\([^ ]*\) .*/\1/'
+}
+
+# Istruzioni e salti eseguiti da un eseguibile del compilatore
+steps() {
+    "$work/measure" --steps "$@"
+}
+
+# Valore di un campo di "measure --steps": field <nome> <riga>
+field() {
+    echo "$2" | tr ' ' '\n' | sed -n "s/^$1=//p"
+}
+
+# I programmi di bench/ cominciano con "VAR giri = <n>", il numero di giri
+# del ciclo esterno. with_rounds <sorgente> <giri> <copia> ne scrive una
+# versione con un altro valore: le istruzioni si contano su versioni ridotte,
+# perché con ptrace ogni istruzione costa qualche microsecondo.
+with_rounds() {
+    sed "1s/^VAR giri = [0-9]*/VAR giri = $2/" "$1" > "$3"
+}
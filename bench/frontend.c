@@ -0,0 +1,92 @@
+// Throughput del front end su sorgenti grandi: lo stream di token da solo e
+// lexer più parser, in MB/s, con la memoria che ciascuno lascia sullo heap.
+// Lo stream tiene solo la finestra di TOKEN_WINDOW token: la sua memoria non
+// cresce con il file (restano i nomi interned, uno per identificatore
+// distinto), quella del parser è l'AST.
+//
+// Compilazione: gcc -O2 -pthread bench/frontend.c <tutti i .c tranne main.c> -o frontend
+// Uso: frontend <file.atl>...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../intern.h"
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static long long heapBytes() {
+    struct mallinfo2 heap = mallinfo2();
+    return (long long) (heap.uordblks + heap.hblkhd);
+}
+
+// Il file con lo zero finale e un blocco di zeri dopo: i percorsi vettoriali
+// del lexer leggono blocchi allineati fino a 32 byte
+static char* loadSource(const char *filename, size_t *length) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        perror(filename);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *length = (size_t) ftell(file);
+    rewind(file);
+    char *source = aligned_alloc(32, (*length + 64) & ~(size_t) 31);
+    size_t got = fread(source, 1, *length, file);
+    fclose(file);
+    if (got != *length) {
+        fprintf(stderr, "Lettura incompleta: %s\n", filename);
+        free(source);
+        return NULL;
+    }
+    memset(source + *length, 0, 32);
+    return source;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s <file.atl>...\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-20s %8s %10s %11s %10s %11s %10s\n", "file", "MB", "Mtoken",
+           "lexer MB/s", "heap KiB", "parser MB/s", "AST KiB");
+    for (int f = 1; f < argc; f++) {
+        size_t length;
+        char *source = loadSource(argv[f], &length);
+        if (!source) return 1;
+        const char *name = strrchr(argv[f], '/') ? strrchr(argv[f], '/') + 1 : argv[f];
+        double mb = length / (double) (1 << 20);
+
+        long long before = heapBytes();
+        double start = now();
+        initLexer(source);
+        while (peekToken(0)->type != TOKEN_EOF) nextToken();
+        double lexTime = now() - start;
+        long long lexHeap = heapBytes() - before;
+        int tokens = scannedTokenCount();
+        freeSymbols();
+
+        before = heapBytes();
+        start = now();
+        initLexer(source);
+        parseProgram();
+        double parseTime = now() - start;
+        long long astHeap = heapBytes() - before;
+        freeAST();
+        freeSymbols();
+
+        printf("%-20s %8.1f %10.2f %11.1f %10lld %11.1f %10lld\n", name, mb, tokens / 1e6,
+               mb / lexTime, lexHeap / 1024, mb / parseTime, astHeap / 1024);
+        free(source);
+    }
+    return 0;
+}
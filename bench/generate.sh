@@ -0,0 +1,42 @@
+#!/bin/sh
+# Genera un programma valido di circa <MB> megabyte per bench/throughput.sh:
+# venti funzioni brevi e cinquanta globali, poi un corpo principale lungo a
+# piacere con cicli, IF/ELSE, chiamate e stringhe. Lo stesso seme dà lo
+# stesso programma.
+#
+# Uso: bench/generate.sh <MB> [seme] > programma.atl
+
+if [ $# -lt 1 ]; then
+    echo "Uso: $0 <MB> [seme] > programma.atl" >&2
+    exit 2
+fi
+
+awk -v megabytes="$1" -v seed="${2:-1}" 'BEGIN {
+    srand(seed)
+    globals = 50
+    functions = 20
+    for (g = 0; g < globals; g++) printf "VAR v%d = %d\n", g, int(rand() * 1000)
+    for (f = 0; f < functions; f++) {
+        printf "DEFINE FUNCTION calcolo%d()\n", f
+        printf "    VAR a = v%d * 3 + %d\n", int(rand() * globals), int(rand() * 100)
+        print "    IF a % 2 == 0 THEN a = a / 2 ELSE a = a * 3 + 1 ENDIF"
+        printf "    v%d = a %% 1000\n", int(rand() * globals)
+        print "    RETURN a"
+        print "ENDDEF"
+    }
+
+    target = megabytes * 1048576
+    for (i = 0; size < target; i++) {
+        x = "v" int(rand() * globals)
+        y = "v" int(rand() * globals)
+        block = sprintf("%s = 0\n", x)
+        block = block sprintf("LOOP %s < %d\n", x, 2 + int(rand() * 8))
+        block = block sprintf("    IF %s %% 2 == 0 THEN %s = %s + %s / 2 ELSE %s = %s * 3 + 1 ENDIF\n", y, y, y, x, y, y)
+        block = block sprintf("    %s = %s + 1\n", x, x)
+        block = block "NEXT\n"
+        block = block sprintf("%s = (%s + calcolo%d()) %% 100000\n", y, y, int(rand() * functions))
+        if (i % 100 == 0) block = block sprintf("PRINT \"blocco %d: \" PRINT %s PRINT \"\\n\"\n", i, y)
+        printf "%s", block
+        size += length(block)
+    }
+}'
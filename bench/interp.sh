@@ -0,0 +1,30 @@
+#!/bin/sh
+# Interprete di bytecode (--interp) contro il codice nativo sui nuclei di
+# test.atl: verifica dei primi, fattoriale, espressioni e modulo. Per il nativo
+# si misurano la compilazione in ELF, l'eseguibile da solo e --run (compila ed
+# esegue in memoria); per --interp il tempo totale dal sorgente. test.atl, che
+# dura pochissimo, mostra il tempo di avvio. Le uscite devono coincidere.
+#
+# Uso: bench/interp.sh [compilatore]        (predefinito: ./compiler)
+
+. "$(dirname "$0")/common.sh"
+
+compiler=$(compiler_path "${1:-./compiler}") || exit 2
+
+printf '%-12s %10s %10s %10s %10s\n' programma "ms -o" "ms ELF" "ms --run" "ms interp"
+failures=0
+for source in "$root/test.atl" "$bench/primi.atl" "$bench/fattoriale.atl" \
+              "$bench/espressioni.atl" "$bench/modulo.atl"; do
+    name=$(basename "$source" .atl)
+    "$compiler" -o "$work/$name" "$source" > /dev/null || exit 1
+    if [ "$("$work/$name")" != "$("$compiler" --interp "$source")" ]; then
+        echo "$name: uscita di --interp diversa dall'eseguibile" >&2
+        failures=$((failures + 1))
+    fi
+    printf '%-12s %10s %10s %10s %10s\n' "$name" \
+        "$(best_ms "$compiler" -o "$work/$name" "$source")" \
+        "$(best_ms "$work/$name")" \
+        "$(best_ms "$compiler" --run "$source")" \
+        "$(best_ms "$compiler" --interp "$source")"
+done
+[ $failures = 0 ]
@@ -0,0 +1,106 @@
+// Throughput del lexer in MB/s, per ogni percorso di scansione (scan.h).
+// Ogni file viene ripetuto fino a circa <MB> megabyte (predefinito 16) e
+// letto per intero più volte, token per token come fa il parser; si stampa
+// il passaggio migliore.
+//
+// Compilazione: gcc -O2 -Wall bench/lexer.c lexer.c scan.c intern.c -o lexer_bench
+// Uso: lexer_bench [-m <MB>] <file.atl>...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../lexer.h"
+#include "../intern.h"
+#include "../scan.h"
+
+#define PASSES 5
+
+static const ScanPath paths[] = { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+#define PATH_COUNT 3
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Il file ripetuto, con lo zero finale e un blocco di zeri dopo: i percorsi
+// vettoriali leggono blocchi allineati fino a 32 byte
+static char* loadRepeated(const char *filename, size_t megabytes, size_t *length) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        perror(filename);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char *text = malloc(size + 1);
+    if (fread(text, 1, size, file) != (size_t) size) size = 0;
+    fclose(file);
+    if (size == 0) {
+        fprintf(stderr, "File vuoto o illeggibile: %s\n", filename);
+        free(text);
+        return NULL;
+    }
+
+    size_t target = megabytes << 20;
+    size_t copies = (target + size - 1) / size;
+    *length = copies * (size + 1);
+    char *source = aligned_alloc(32, (*length + 64) & ~(size_t) 31);
+    char *cursor = source;
+    for (size_t i = 0; i < copies; i++) {
+        memcpy(cursor, text, size);
+        cursor += size;
+        *cursor++ = '\n';
+    }
+    memset(cursor, 0, 32);
+    free(text);
+    return source;
+}
+
+static int lexAll(const char *source) {
+    initLexer(source);
+    while (peekToken(0)->type != TOKEN_EOF) nextToken();
+    return scannedTokenCount();
+}
+
+int main(int argc, char *argv[]) {
+    size_t megabytes = 16;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-m") == 0) {
+        megabytes = (size_t) atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || megabytes < 1) {
+        fprintf(stderr, "Uso: %s [-m <MB>] <file.atl>...\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-24s %-7s %10s %10s %12s\n", "file", "scan", "MB", "MB/s", "Mtoken/s");
+    for (int f = first; f < argc; f++) {
+        size_t length;
+        char *source = loadRepeated(argv[f], megabytes, &length);
+        if (!source) return 1;
+        const char *name = strrchr(argv[f], '/') ? strrchr(argv[f], '/') + 1 : argv[f];
+        for (int k = 0; k < PATH_COUNT; k++) {
+            if (!setScanPath(paths[k])) continue;
+            double best = 0;
+            int tokens = 0;
+            for (int pass = 0; pass < PASSES; pass++) {
+                freeSymbols();
+                double start = now();
+                tokens = lexAll(source);
+                double elapsed = now() - start;
+                if (pass == 0 || elapsed < best) best = elapsed;
+            }
+            double mb = length / (double) (1 << 20);
+            printf("%-24s %-7s %10.1f %10.1f %12.1f\n", name, scanPathName(), mb,
+                   mb / best, tokens / best / 1e6);
+        }
+        free(source);
+    }
+    freeSymbols();
+    return 0;
+}
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Throughput del lexer in MB/s con i percorsi scalare, SSE2 e AVX2 (quelli
+# che la CPU supporta), su sorgenti ripetuti fino a $MB megabyte.
+#
+# Uso: bench/lexer.sh [file.atl...]        (predefiniti: test.atl e tests/*.atl)
+
+. "$(dirname "$0")/common.sh"
+
+if ! "$cc" -O2 -o "$work/lexer" "$bench/lexer.c" "$root/lexer.c" "$root/scan.c" "$root/intern.c"; then
+    echo "Impossibile compilare bench/lexer.c" >&2
+    exit 2
+fi
+if [ $# = 0 ]; then
+    set -- "$root/test.atl" "$root"/tests/*.atl
+fi
+"$work/lexer" -m "${MB:-16}" "$@"
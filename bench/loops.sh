@@ -0,0 +1,50 @@
+#!/bin/sh
+# Cicli ruotati (controllo in fondo, un solo salto all'indietro per giro)
+# contro i cicli con il controllo in testa: salti condizionati, salti presi e
+# salti incondizionati eseguiti dai cicli della verifica dei primi e del
+# fattoriale, più istruzioni e tempo. Le uscite devono coincidere.
+#
+# I due lati predefiniti sono il commit della rotazione e quello che lo
+# precede, così la differenza è solo la rotazione: il compilatore attuale
+# aggiunge anche LICM e srotolamento dei cicli.
+#
+# Uso: bench/loops.sh [dopo] [prima]
+#   dopo   un compilatore già costruito (./compiler) o una revisione git;
+#          predefinita il commit della rotazione dei cicli
+#   prima  come sopra; predefinita la revisione che precede la rotazione
+
+. "$(dirname "$0")/common.sh"
+
+if [ -n "$1" ]; then
+    after=$1
+else
+    after=$(revision_of user-023) || exit 2
+fi
+if [ -n "$2" ]; then
+    reference=$2
+else
+    reference=$(revision_before user-023) || exit 2
+fi
+compiler=$(reference_compiler "$after") || exit 2
+old=$(reference_compiler "$reference") || exit 2
+
+echo "Prima: $reference; dopo: $after; salti e istruzioni con giri = 300"
+printf '%-11s %-6s %11s %11s %8s %8s %9s\n' programma "" istruzioni "salti cond." presi salti ms
+failures=0
+for kernel in primi fattoriale; do
+    with_rounds "$bench/$kernel.atl" 300 "$work/ridotto.atl"
+    for side in prima dopo; do
+        if [ $side = prima ]; then build=$old; else build=$compiler; fi
+        build_elf "$build" "$bench/$kernel.atl" "$work/$side" &&
+            build_elf "$build" "$work/ridotto.atl" "$work/$side-ridotto" || exit 1
+        counts=$(steps "$work/$side-ridotto")
+        printf '%-11s %-6s %11s %11s %8s %8s %9s\n' "$kernel" $side \
+            "$(field istruzioni "$counts")" "$(field salti_condizionati "$counts")" \
+            "$(field presi "$counts")" "$(field salti "$counts")" "$(best_ms "$work/$side")"
+    done
+    if [ "$("$work/prima")" != "$("$work/dopo")" ]; then
+        echo "$kernel: uscite diverse" >&2
+        failures=$((failures + 1))
+    fi
+done
+[ $failures = 0 ]
@@ -0,0 +1,143 @@
+// Misure per gli script di bench/.
+//
+//   measure [-n <volte>] <programma> [argomenti...]
+//       esegue il programma più volte con stdout su /dev/null e stampa il
+//       tempo migliore e il picco di memoria: "ms=<ms> rss_kib=<KiB>"
+//   measure --steps <programma> [argomenti...]
+//       esegue il programma un'istruzione alla volta con ptrace (x86-64,
+//       Linux) e stampa "istruzioni=<n> salti_condizionati=<n> presi=<n>
+//       salti=<n>". Adatto agli eseguibili del compilatore, brevi e senza
+//       librerie; i salti si riconoscono dall'opcode (senza prefissi, come
+//       li emette x86.c).
+//
+// Compilazione: gcc -O2 -Wall bench/measure.c -o measure
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#if defined(__x86_64__) && defined(__linux__)
+#define STEP_COUNT 1
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#endif
+
+static void usage(const char *program) {
+    fprintf(stderr, "Uso: %s [-n <volte>] <programma> [argomenti...]\n"
+                    "     %s --steps <programma> [argomenti...]\n", program, program);
+}
+
+// Figlio con stdout su /dev/null; se trace, si ferma all'exec per ptrace
+static pid_t launch(char *argv[], int trace) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(2);
+    }
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) dup2(null, STDOUT_FILENO);
+#ifdef STEP_COUNT
+        if (trace) ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+#endif
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+    return pid;
+}
+
+static double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+}
+
+static int timeRuns(char *argv[], int runs) {
+    double best = 0;
+    long peak = 0;
+    for (int i = 0; i < runs; i++) {
+        double start = now();
+        pid_t pid = launch(argv, 0);
+        int status;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        double elapsed = now() - start;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 127) return 2;
+        if (i == 0 || elapsed < best) best = elapsed;
+        if (usage.ru_maxrss > peak) peak = usage.ru_maxrss;
+    }
+    printf("ms=%.3f rss_kib=%ld\n", best, peak);
+    return 0;
+}
+
+#ifdef STEP_COUNT
+static int countSteps(char *argv[]) {
+    pid_t pid = launch(argv, 1);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFSTOPPED(status)) {
+        fprintf(stderr, "Impossibile seguire %s\n", argv[0]);
+        return 2;
+    }
+    long instructions = 0, conditional = 0, taken = 0, jumps = 0;
+    unsigned long long fallThrough = 0;     // indirizzo dopo l'ultimo salto condizionato
+    int afterConditional = 0;
+    for (;;) {
+        struct user_regs_struct regs;
+        ptrace(PTRACE_GETREGS, pid, NULL, &regs);
+        if (afterConditional && regs.rip != fallThrough) taken++;
+        afterConditional = 0;
+        long word = ptrace(PTRACE_PEEKTEXT, pid, (void*) regs.rip, NULL);
+        unsigned char op = word & 0xFF, next = (word >> 8) & 0xFF;
+        instructions++;
+        if ((op & 0xF0) == 0x70) {                         // jcc rel8
+            conditional++;
+            afterConditional = 1;
+            fallThrough = regs.rip + 2;
+        } else if (op == 0x0F && (next & 0xF0) == 0x80) {  // jcc rel32
+            conditional++;
+            afterConditional = 1;
+            fallThrough = regs.rip + 6;
+        } else if (op == 0xEB || op == 0xE9) {             // jmp rel8/rel32
+            jumps++;
+        }
+        ptrace(PTRACE_SINGLESTEP, pid, NULL, NULL);
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status) || WIFSIGNALED(status)) break;
+    }
+    printf("istruzioni=%ld salti_condizionati=%ld presi=%ld salti=%ld\n",
+           instructions, conditional, taken, jumps);
+    return 0;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    int runs = 5;
+    int steps = 0;
+    int first = 1;
+    if (first < argc && strcmp(argv[first], "--steps") == 0) {
+        steps = 1;
+        first++;
+    } else if (first + 1 < argc && strcmp(argv[first], "-n") == 0) {
+        runs = atoi(argv[first + 1]);
+        first += 2;
+    }
+    if (first >= argc || runs < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (steps) {
+#ifdef STEP_COUNT
+        return countSteps(argv + first);
+#else
+        fprintf(stderr, "--steps richiede Linux su x86-64\n");
+        return 2;
+#endif
+    }
+    return timeRuns(argv + first, runs);
+}
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Divisione e modulo per costanti: lo stesso ciclo con i divisori scritti nel
+# sorgente (moltiplicazione per il reciproco e shift, senza controllo dello
+# zero) e con i divisori letti da variabili che il compilatore non conosce
+# (cqo e idiv). I due programmi e --interp devono stampare lo stesso valore.
+#
+# Uso: bench/modulo.sh [compilatore]        (predefinito: ./compiler)
+
+. "$(dirname "$0")/common.sh"
+
+compiler=$(compiler_path "${1:-./compiler}") || exit 2
+rounds=2000
+
+echo "Istruzioni con giri = $rounds"
+printf '%-18s %12s %12s %10s\n' programma istruzioni "salti cond." ms
+expected=$("$compiler" --interp "$bench/modulo.atl")
+failures=0
+for kernel in modulo modulo_variabile; do
+    with_rounds "$bench/$kernel.atl" $rounds "$work/ridotto.atl"
+    "$compiler" -o "$work/$kernel" "$bench/$kernel.atl" > /dev/null &&
+        "$compiler" -o "$work/ridotto" "$work/ridotto.atl" > /dev/null || exit 1
+    if [ "$("$work/$kernel")" != "$expected" ]; then
+        echo "$kernel: uscita diversa da --interp" >&2
+        failures=$((failures + 1))
+    fi
+    counts=$(steps "$work/ridotto")
+    printf '%-18s %12s %12s %10s\n' "$kernel" "$(field istruzioni "$counts")" \
+        "$(field salti_condizionati "$counts")" "$(best_ms "$work/$kernel")"
+done
+[ $failures = 0 ]
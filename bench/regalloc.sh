@@ -0,0 +1,41 @@
+#!/bin/sh
+# Allocatore dei registri contro la macchina a stack (push/pop per ogni
+# operatore) del codice di partenza: istruzioni eseguite e tempo degli stessi
+# programmi, compilati dal compilatore attuale e da quello di riferimento.
+# Le uscite dei due eseguibili devono coincidere.
+#
+# Uso: bench/regalloc.sh [compilatore] [riferimento]
+#   compilatore  predefinito ./compiler
+#   riferimento  un compilatore già costruito o una revisione git; predefinita
+#                quella prima dell'allocatore (serve nasm: non ha -o)
+
+. "$(dirname "$0")/common.sh"
+
+compiler=$(compiler_path "${1:-./compiler}") || exit 2
+if [ -n "$2" ]; then
+    reference=$2
+else
+    reference=$(revision_before user-001) || exit 2
+fi
+old=$(reference_compiler "$reference") || exit 2
+rounds=1
+
+echo "Riferimento: $reference; istruzioni con giri = $rounds"
+printf '%-12s %12s %12s %10s %10s\n' programma "istr. prima" "istr. dopo" "ms prima" "ms dopo"
+failures=0
+for kernel in espressioni polinomio; do
+    with_rounds "$bench/$kernel.atl" $rounds "$work/ridotto.atl"
+    build_elf "$old" "$bench/$kernel.atl" "$work/prima" &&
+        build_elf "$old" "$work/ridotto.atl" "$work/prima-ridotto" &&
+        build_elf "$compiler" "$bench/$kernel.atl" "$work/dopo" &&
+        build_elf "$compiler" "$work/ridotto.atl" "$work/dopo-ridotto" || exit 1
+    if [ "$("$work/prima")" != "$("$work/dopo")" ]; then
+        echo "$kernel: uscite diverse" >&2
+        failures=$((failures + 1))
+    fi
+    printf '%-12s %12s %12s %10s %10s\n' "$kernel" \
+        "$(field istruzioni "$(steps "$work/prima-ridotto")")" \
+        "$(field istruzioni "$(steps "$work/dopo-ridotto")")" \
+        "$(best_ms "$work/prima")" "$(best_ms "$work/dopo")"
+done
+[ $failures = 0 ]
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Compilazione con molti identificatori distinti: 25k, 50k e 100k globali,
+# qualche IF/ELSE che le riassegna (la propagazione delle costanti unisce i
+# due rami) e stringhe tutte diverse. Misura --emit-ir, che passa da tutte le
+# tabelle dei nomi, con il compilatore attuale e con quello di riferimento;
+# il tempo deve crescere in modo lineare.
+#
+# Uso: bench/symbols.sh [compilatore] [riferimento]
+#   compilatore  predefinito ./compiler
+#   riferimento  un compilatore già costruito o una revisione git; predefinita
+#                quella prima della tabella dei simboli a hash
+
+. "$(dirname "$0")/common.sh"
+
+compiler=$(compiler_path "${1:-./compiler}") || exit 2
+if [ -n "$2" ]; then
+    reference=$2
+else
+    reference=$(revision_before user-011) || exit 2
+fi
+old=$(reference_compiler "$reference") || exit 2
+
+# Programma con $1 identificatori distinti
+generate() {
+    awk -v count="$1" 'BEGIN {
+        for (i = 0; i < count; i++) {
+            printf "VAR v%d = %d\n", i, i % 1000
+            if (i % 1000 == 999) {
+                printf "IF v%d > 500 THEN v%d = 1 v%d = 2 ELSE v%d = 3 ENDIF\n", i, i - 1, i - 2, i - 1
+            }
+            if (i % 5000 == 4999) printf "PRINT \"fino a v%d: \" PRINT v%d\n", i, i - 1
+        }
+    }'
+}
+
+echo "Riferimento: $reference"
+printf '%-14s %10s %10s\n' identificatori "ms prima" "ms dopo"
+for count in 25000 50000 100000; do
+    generate $count > "$work/nomi.atl"
+    printf '%-14s %10s %10s\n' $count \
+        "$(best_ms "$old" --emit-ir "$work/nomi.atl")" \
+        "$(best_ms "$compiler" --emit-ir "$work/nomi.atl")"
+done
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Throughput del front end su sorgenti di più megabyte, generati con
+# bench/generate.sh: lo stream di token da solo e lexer più parser, in MB/s,
+# con la memoria che lasciano sullo heap (bench/frontend.c).
+#
+# Uso: bench/throughput.sh [MB...]        (predefiniti: 1 4 16)
+
+. "$(dirname "$0")/common.sh"
+
+sources=$(ls "$root"/*.c | grep -v '/main\.c$')
+if ! "$cc" -O2 -pthread -o "$work/frontend" "$bench/frontend.c" $sources; then
+    echo "Impossibile compilare bench/frontend.c" >&2
+    exit 2
+fi
+if [ $# = 0 ]; then
+    set -- 1 4 16
+fi
+files=
+for megabytes in "$@"; do
+    "$bench/generate.sh" "$megabytes" > "$work/generato-${megabytes}MB.atl" || exit 2
+    files="$files $work/generato-${megabytes}MB.atl"
+done
+"$work/frontend" $files
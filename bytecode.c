@@ -0,0 +1,644 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bytecode.h"
+#include "intern.h"
+#include "context.h"
+
+// Traduzione in una passata dell'AST. Un'espressione produce un operando:
+// globali e costanti non vengono copiate in un registro finché
+// un'istruzione non lo richiede, così i casi frequenti usano le forme
+// K e G. I temporanei si allocano a pila da top e si liberano alla fine
+// dell'espressione che li ha creati.
+
+typedef enum {
+    OPND_REG,
+    OPND_GLOBAL,
+    OPND_CONST
+} OperandKind;
+
+typedef struct {
+    OperandKind kind;
+    long long value;    // registro, globale o valore
+} Operand;
+
+static _Thread_local BCProgram *program;
+static _Thread_local int *globalOfSymbol;
+static _Thread_local int *functionOfSymbol;
+static _Thread_local BCFunction *fn;
+static _Thread_local int top;
+
+// Salti dei BREAK ancora da completare, per tutti i LOOP aperti
+static _Thread_local int *breakJumps = NULL;
+static _Thread_local int breakCount = 0, breakCap = 0;
+static _Thread_local int loopDepth = 0;
+
+// Salti delle condizioni ancora da completare: && e || ne producono più di
+// uno per la stessa destinazione
+static _Thread_local int *condJumps = NULL;
+static _Thread_local int condCount = 0, condCap = 0;
+
+// EQ NE LT LE GT GE: condizione negata e condizione a operandi scambiati
+static const int negatedCond[6] = { 1, 0, 5, 4, 3, 2 };
+static const int swappedCond[6] = { 0, 1, 4, 5, 2, 3 };
+
+static void compileStatement(ASTNode *node);
+static Operand compileExpr(ASTNode *node);
+static void compileBranch(ASTNode *cond, int jumpIfTrue);
+
+static void compileError(const char *msg, const char *detail) {
+    sourceError(0, 0, "Errore: %s '%s'", msg, detail);
+}
+
+static const char* functionName(BCFunction *f) {
+    return f->symbol < 0 ? "_start" : symbolName(f->symbol);
+}
+
+// Stessa decodifica di irgen: \n \t \r \\ \" diventano il byte
+// corrispondente, gli altri escape restano invariati
+static int decodeEscapes(const char *raw, char *out) {
+    char *start = out;
+    while (*raw) {
+        if (*raw != '\\' || !raw[1]) {
+            *out++ = *raw++;
+            continue;
+        }
+        switch (raw[1]) {
+            case 'n':  *out++ = '\n'; break;
+            case 't':  *out++ = '\t'; break;
+            case 'r':  *out++ = '\r'; break;
+            case '\\': *out++ = '\\'; break;
+            case '"':  *out++ = '"'; break;
+            default:
+                *out++ = raw[0];
+                *out++ = raw[1];
+        }
+        raw += 2;
+    }
+    *out = '\0';
+    return (int) (out - start);
+}
+
+static int fitsImm32(long long v) {
+    return v >= -2147483648LL && v <= 2147483647LL;
+}
+
+// ---------- EMISSIONE ----------
+
+static int emit(BCOp op, int a, int b, int c) {
+    if (program->codeCount == program->codeCap) {
+        program->codeCap = program->codeCap ? program->codeCap * 2 : 256;
+        program->code = realloc(program->code, sizeof(BCInstr) * program->codeCap);
+    }
+    BCInstr *in = &program->code[program->codeCount];
+    in->handler = NULL;
+    in->op = op;
+    in->a = a;
+    in->b = b;
+    in->c = c;
+    return program->codeCount++;
+}
+
+static int here() {
+    return program->codeCount;
+}
+
+// Completa un salto (-1: nessun salto emesso)
+static void patch(int jump, int target) {
+    if (jump >= 0) program->code[jump].b = target;
+}
+
+static void pushCondJump(int jump) {
+    if (jump < 0) return;
+    if (condCount == condCap) {
+        condCap = condCap ? condCap * 2 : 16;
+        condJumps = realloc(condJumps, sizeof(int) * condCap);
+    }
+    condJumps[condCount++] = jump;
+}
+
+// Completa i salti accodati da first in poi e li toglie dalla coda
+static void patchCondJumps(int first, int target) {
+    for (int i = first; i < condCount; i++) patch(condJumps[i], target);
+    condCount = first;
+}
+
+static int allocReg() {
+    int r = top++;
+    if (top > fn->frameSize) fn->frameSize = top;
+    return r;
+}
+
+static int addConstant(long long value) {
+    if (program->constantCount == program->constantCap) {
+        program->constantCap = program->constantCap ? program->constantCap * 2 : 16;
+        program->constants = realloc(program->constants, sizeof(long long) * program->constantCap);
+    }
+    program->constants[program->constantCount] = value;
+    return program->constantCount++;
+}
+
+static int addString(const char *raw) {
+    if (program->stringCount == program->stringCap) {
+        program->stringCap = program->stringCap ? program->stringCap * 2 : 16;
+        program->strings = realloc(program->strings, sizeof(char*) * program->stringCap);
+        program->stringLengths = realloc(program->stringLengths, sizeof(int) * program->stringCap);
+    }
+    char *text = malloc(strlen(raw) + 1);
+    program->stringLengths[program->stringCount] = decodeEscapes(raw, text);
+    program->strings[program->stringCount] = text;
+    return program->stringCount++;
+}
+
+static Operand operand(OperandKind kind, long long value) {
+    Operand o = { kind, value };
+    return o;
+}
+
+static int toReg(Operand o) {
+    if (o.kind == OPND_REG) return (int) o.value;
+    int r = allocReg();
+    if (o.kind == OPND_GLOBAL) emit(BC_LOADG, r, (int) o.value, 0);
+    else if (fitsImm32(o.value)) emit(BC_LOADK, r, 0, (int) o.value);
+    else emit(BC_LOADKL, r, addConstant(o.value), 0);
+    return r;
+}
+
+// ---------- ESPRESSIONI ----------
+
+static int hasCall(ASTNode *n) {
+    if (n->type == AST_CALL) return 1;
+    for (int i = 0; i < n->childCount; i++) {
+        if (hasCall(n->children[i])) return 1;
+    }
+    return 0;
+}
+
+// Forma RR dell'operatore (BC_ADD..BC_GE), -1 se non supportato
+static int binaryOp(const char *op) {
+    if (strcmp(op, "+") == 0) return BC_ADD;
+    if (strcmp(op, "-") == 0) return BC_SUB;
+    if (strcmp(op, "*") == 0) return BC_MUL;
+    if (strcmp(op, "/") == 0) return BC_DIV;
+    if (strcmp(op, "%") == 0) return BC_MOD;
+    if (strcmp(op, "==") == 0) return BC_EQ;
+    if (strcmp(op, "!=") == 0) return BC_NE;
+    if (strcmp(op, "<") == 0)  return BC_LT;
+    if (strcmp(op, "<=") == 0) return BC_LE;
+    if (strcmp(op, ">") == 0)  return BC_GT;
+    if (strcmp(op, ">=") == 0) return BC_GE;
+    return -1;
+}
+
+static int isComparison(int op) {
+    return op >= BC_EQ && op <= BC_GE;
+}
+
+static int isLogicNode(ASTNode *node) {
+    if (node->type != AST_BINARY_EXPR) return 0;
+    if (node->childCount == 1) return strcmp(node->text, "!") == 0;
+    return strcmp(node->text, "&&") == 0 || strcmp(node->text, "||") == 0;
+}
+
+// Valuta i due operandi da sinistra a destra. Una globale a sinistra va
+// letta prima della destra se questa contiene chiamate che possono
+// modificarla.
+static void compileOperands(ASTNode *node, Operand *a, Operand *b) {
+    *a = compileExpr(node->children[0]);
+    if (a->kind == OPND_GLOBAL && hasCall(node->children[1])) {
+        *a = operand(OPND_REG, toReg(*a));
+    }
+    *b = compileExpr(node->children[1]);
+}
+
+// && || ! come valore 0/1
+static Operand compileLogicValue(ASTNode *node) {
+    int mark = top;
+    if (node->childCount == 1) {
+        int a = toReg(compileExpr(node->children[0]));
+        top = mark;
+        int dst = allocReg();
+        emit(BC_EQK, dst, a, 0);
+        return operand(OPND_REG, dst);
+    }
+    int dst = allocReg();
+    int first = condCount;
+    compileBranch(node, 0);
+    emit(BC_LOADK, dst, 0, 1);
+    int end = emit(BC_JMP, 0, 0, 0);
+    patchCondJumps(first, here());
+    emit(BC_LOADK, dst, 0, 0);
+    patch(end, here());
+    return operand(OPND_REG, dst);
+}
+
+static Operand compileBinary(ASTNode *node) {
+    int mark = top;
+    if (isLogicNode(node)) return compileLogicValue(node);
+    if (node->childCount == 1) {
+        int a = toReg(compileExpr(node->children[0]));
+        top = mark;
+        int dst = allocReg();
+        emit(BC_NEG, dst, a, 0);
+        return operand(OPND_REG, dst);
+    }
+    int op = binaryOp(node->text);
+    if (op < 0) compileError("operatore non supportato", node->text);
+
+    Operand a, b;
+    compileOperands(node, &a, &b);
+    // Costante a sinistra: si scambiano gli operandi dove è possibile
+    if (a.kind == OPND_CONST && b.kind != OPND_CONST &&
+        (op == BC_ADD || op == BC_MUL || isComparison(op))) {
+        Operand t = a;
+        a = b;
+        b = t;
+        if (isComparison(op)) op = BC_EQ + swappedCond[op - BC_EQ];
+    }
+
+    int ra = toReg(a);
+    // DIVK e MODK non controllano lo zero
+    int useImm = b.kind == OPND_CONST && fitsImm32(b.value) &&
+                 !((op == BC_DIV || op == BC_MOD) && b.value == 0);
+    int rb = useImm ? 0 : toReg(b);
+    top = mark;
+    int dst = allocReg();
+    if (useImm) emit((BCOp) (op - BC_ADD + BC_ADDK), dst, ra, (int) b.value);
+    else emit((BCOp) op, dst, ra, rb);
+    return operand(OPND_REG, dst);
+}
+
+static Operand compileExpr(ASTNode *node) {
+    switch (node->type) {
+        case AST_LITERAL:
+            return operand(OPND_CONST, node->number);
+        case AST_STRING:
+            // Le stringhe in un'espressione valgono 0
+            return operand(OPND_CONST, 0);
+        case AST_IDENTIFIER:
+            return operand(OPND_GLOBAL, globalOfSymbol[node->symbol]);
+        case AST_CALL: {
+            int callee = functionOfSymbol[node->symbol];
+            if (callee < 0) compileError("funzione non definita", symbolName(node->symbol));
+            int dst = allocReg();
+            emit(BC_CALL, dst, callee, 0);
+            return operand(OPND_REG, dst);
+        }
+        case AST_BINARY_EXPR:
+            return compileBinary(node);
+        default:
+            compileError("espressione non valida", "");
+            return operand(OPND_CONST, 0);
+    }
+}
+
+// && e ||: se la sinistra basta a decidere verso la destinazione si salta
+// subito, altrimenti la sinistra salta oltre la destra (risultato opposto)
+static void compileLogicBranch(ASTNode *cond, int jumpIfTrue) {
+    if (cond->childCount == 1) {
+        compileBranch(cond->children[0], !jumpIfTrue);
+        return;
+    }
+    int isAnd = cond->text[0] == '&';
+    if (isAnd != jumpIfTrue) {
+        compileBranch(cond->children[0], jumpIfTrue);
+        compileBranch(cond->children[1], jumpIfTrue);
+        return;
+    }
+    int first = condCount;
+    compileBranch(cond->children[0], !jumpIfTrue);
+    int count = condCount - first;
+    int *skip = malloc(sizeof(int) * (count + 1));
+    memcpy(skip, condJumps + first, sizeof(int) * count);
+    condCount = first;
+    compileBranch(cond->children[1], jumpIfTrue);
+    for (int i = 0; i < count; i++) patch(skip[i], here());
+    free(skip);
+}
+
+// Salta se la condizione vale jumpIfTrue, altrimenti prosegue. I salti vanno
+// in coda a condJumps; una condizione costante ne emette al più uno.
+static void compileBranch(ASTNode *cond, int jumpIfTrue) {
+    if (isLogicNode(cond)) {
+        compileLogicBranch(cond, jumpIfTrue);
+        return;
+    }
+    int mark = top;
+    int op = cond->type == AST_BINARY_EXPR && cond->childCount == 2 ? binaryOp(cond->text) : -1;
+    if (!isComparison(op)) {
+        Operand v = compileExpr(cond);
+        if (v.kind == OPND_CONST) {
+            if ((v.value != 0) == jumpIfTrue) pushCondJump(emit(BC_JMP, 0, 0, 0));
+            return;
+        }
+        int r = toReg(v);
+        top = mark;
+        pushCondJump(emit(jumpIfTrue ? BC_JNZ : BC_JZ, r, 0, 0));
+        return;
+    }
+
+    int cc = op - BC_EQ;
+    if (!jumpIfTrue) cc = negatedCond[cc];
+    Operand a, b;
+    compileOperands(cond, &a, &b);
+    if (a.kind == OPND_CONST && b.kind != OPND_CONST) {
+        Operand t = a;
+        a = b;
+        b = t;
+        cc = swappedCond[cc];
+    }
+
+    int jump;
+    int immB = b.kind == OPND_CONST && fitsImm32(b.value);
+    if (a.kind == OPND_GLOBAL && immB) {
+        jump = emit((BCOp) (BC_JEQGK + cc), (int) a.value, 0, (int) b.value);
+    } else if (a.kind == OPND_GLOBAL && b.kind == OPND_GLOBAL) {
+        jump = emit((BCOp) (BC_JEQGG + cc), (int) a.value, 0, (int) b.value);
+    } else {
+        int ra = toReg(a);
+        if (immB) jump = emit((BCOp) (BC_JEQK + cc), ra, 0, (int) b.value);
+        else jump = emit((BCOp) (BC_JEQ + cc), ra, 0, toReg(b));
+    }
+    top = mark;
+    pushCondJump(jump);
+}
+
+// ---------- STATEMENT ----------
+
+// g = g + k e g = g - k diventano un'unica ADDGK
+static int isIncrement(int symbol, ASTNode *expr, long long *step) {
+    if (expr->type != AST_BINARY_EXPR || expr->childCount != 2) return 0;
+    ASTNode *left = expr->children[0];
+    ASTNode *right = expr->children[1];
+    if (left->type != AST_IDENTIFIER || left->symbol != symbol || right->type != AST_LITERAL) return 0;
+    if (!fitsImm32(right->number)) return 0;
+    if (strcmp(expr->text, "+") == 0) *step = right->number;
+    else if (strcmp(expr->text, "-") == 0) *step = -right->number;
+    else return 0;
+    return fitsImm32(*step);
+}
+
+static void assignVar(int symbol, ASTNode *expr) {
+    int g = globalOfSymbol[symbol];
+    long long step;
+    if (isIncrement(symbol, expr, &step)) {
+        emit(BC_ADDGK, g, 0, (int) step);
+        return;
+    }
+    Operand v = compileExpr(expr);
+    if (v.kind == OPND_CONST && fitsImm32(v.value)) emit(BC_SETGK, g, 0, (int) v.value);
+    else emit(BC_STOREG, g, toReg(v), 0);
+}
+
+static void compileIf(ASTNode *node) {
+    int skipThen = condCount;
+    compileBranch(node->children[0], 0);
+    compileStatement(node->children[1]);
+    if (node->childCount > 2) {
+        int skipElse = emit(BC_JMP, 0, 0, 0);
+        patchCondJumps(skipThen, here());
+        compileStatement(node->children[2]);
+        patch(skipElse, here());
+    } else {
+        patchCondJumps(skipThen, here());
+    }
+}
+
+// Il test sta in fondo al corpo: un solo salto per iterazione
+static void compileLoop(ASTNode *node) {
+    int toTest = emit(BC_JMP, 0, 0, 0);
+    int body = here();
+    int firstBreak = breakCount;
+    loopDepth++;
+    compileStatement(node->children[1]);
+    loopDepth--;
+    patch(toTest, here());
+    int toBody = condCount;
+    compileBranch(node->children[0], 1);
+    patchCondJumps(toBody, body);
+    for (int i = firstBreak; i < breakCount; i++) patch(breakJumps[i], here());
+    breakCount = firstBreak;
+}
+
+static void compileStatement(ASTNode *node) {
+    if (!node) return;
+    top = 0;
+    switch (node->type) {
+        case AST_PROGRAM:
+        case AST_BLOCK:
+            for (int i = 0; i < node->childCount; i++) compileStatement(node->children[i]);
+            break;
+        case AST_VAR_DECL:
+            if (node->childCount > 0) assignVar(node->symbol, node->children[0]);
+            else emit(BC_SETGK, globalOfSymbol[node->symbol], 0, 0);
+            break;
+        case AST_ASSIGNMENT:
+            assignVar(node->children[0]->symbol, node->children[1]);
+            break;
+        case AST_IF:
+            compileIf(node);
+            break;
+        case AST_LOOP:
+            compileLoop(node);
+            break;
+        case AST_BREAK:
+            if (loopDepth == 0) compileError("BREAK fuori da un LOOP in", functionName(fn));
+            if (breakCount == breakCap) {
+                breakCap = breakCap ? breakCap * 2 : 8;
+                breakJumps = realloc(breakJumps, sizeof(int) * breakCap);
+            }
+            breakJumps[breakCount++] = emit(BC_JMP, 0, 0, 0);
+            break;
+        case AST_RETURN: {
+            Operand v = node->childCount > 0 ? compileExpr(node->children[0]) : operand(OPND_CONST, 0);
+            // Il RETURN del programma principale termina con codice 0
+            if (fn->symbol < 0) emit(BC_HALT, 0, 0, 0);
+            else if (v.kind == OPND_CONST && v.value == 0) emit(BC_RET0, 0, 0, 0);
+            else emit(BC_RET, toReg(v), 0, 0);
+            break;
+        }
+        case AST_PRINT: {
+            if (node->childCount == 0) break;
+            ASTNode *arg = node->children[0];
+            if (arg->type == AST_STRING) emit(BC_PRINTS, 0, addString(arg->text), 0);
+            else emit(BC_PRINTI, toReg(compileExpr(arg)), 0, 0);
+            break;
+        }
+        case AST_FUNCTION_DEF:
+            // Le funzioni vengono tradotte separatamente
+            break;
+        default:
+            compileExpr(node);
+            break;
+    }
+}
+
+// ---------- PROGRAMMA ----------
+
+static void collectFunctions(ASTNode *node) {
+    if (!node) return;
+    if (node->type == AST_FUNCTION_DEF) {
+        if (functionOfSymbol[node->symbol] >= 0) {
+            compileError("funzione definita più volte", symbolName(node->symbol));
+        }
+        functionOfSymbol[node->symbol] = program->functionCount;
+        program->functions[program->functionCount++].symbol = node->symbol;
+    }
+    for (int i = 0; i < node->childCount; i++) collectFunctions(node->children[i]);
+}
+
+static void collectGlobals(ASTNode *node) {
+    if (!node) return;
+    if ((node->type == AST_VAR_DECL || node->type == AST_IDENTIFIER) &&
+        globalOfSymbol[node->symbol] < 0) {
+        globalOfSymbol[node->symbol] = program->globalCount;
+        program->globalSymbols[program->globalCount++] = node->symbol;
+    }
+    for (int i = 0; i < node->childCount; i++) collectGlobals(node->children[i]);
+}
+
+static int countFunctions(ASTNode *node) {
+    if (!node) return 0;
+    int n = node->type == AST_FUNCTION_DEF;
+    for (int i = 0; i < node->childCount; i++) n += countFunctions(node->children[i]);
+    return n;
+}
+
+static void compileFunction(BCFunction *f, ASTNode *body) {
+    fn = f;
+    fn->entry = here();
+    fn->frameSize = 0;
+    loopDepth = 0;
+    if (body->type == AST_FUNCTION_DEF) {
+        for (int i = 0; i < body->childCount; i++) compileStatement(body->children[i]);
+    } else {
+        compileStatement(body);
+    }
+    emit(fn->symbol < 0 ? BC_HALT : BC_RET0, 0, 0, 0);
+}
+
+static void compileDefinitions(ASTNode *node) {
+    if (!node) return;
+    if (node->type == AST_FUNCTION_DEF) {
+        compileFunction(&program->functions[functionOfSymbol[node->symbol]], node);
+    }
+    for (int i = 0; i < node->childCount; i++) compileDefinitions(node->children[i]);
+}
+
+BCProgram* compileBytecode(ASTNode *root) {
+    breakCount = condCount = 0;  // un errore può aver interrotto la compilazione precedente
+    program = calloc(1, sizeof(BCProgram));
+    program->functions = calloc(countFunctions(root) + 1, sizeof(BCFunction));
+    program->functions[0].symbol = -1;
+    program->functionCount = 1;
+    program->globalSymbols = malloc(sizeof(int) * (symbolCount() + 1));
+
+    globalOfSymbol = malloc(sizeof(int) * (symbolCount() + 1));
+    functionOfSymbol = malloc(sizeof(int) * (symbolCount() + 1));
+    for (int i = 0; i < symbolCount(); i++) globalOfSymbol[i] = functionOfSymbol[i] = -1;
+
+    collectFunctions(root);
+    collectGlobals(root);
+    compileFunction(&program->functions[0], root);
+    compileDefinitions(root);
+
+    free(globalOfSymbol);
+    free(functionOfSymbol);
+    free(breakJumps);
+    breakJumps = NULL;
+    breakCount = breakCap = 0;
+    free(condJumps);
+    condJumps = NULL;
+    condCount = condCap = 0;
+    return program;
+}
+
+// ---------- STAMPA ----------
+
+const char* bytecodeOpName(int op) {
+#define BC_NAME(name) #name,
+    static const char *names[] = { BC_OPCODES(BC_NAME) };
+#undef BC_NAME
+    return op >= 0 && op < BC_OPCOUNT ? names[op] : "?";
+}
+
+static void printString(const char *s, int length, FILE *out) {
+    fputc('"', out);
+    for (int i = 0; i < length; i++) {
+        switch (s[i]) {
+            case '\n': fputs("\\n", out); break;
+            case '\t': fputs("\\t", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '"':  fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            default:   fputc(s[i], out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void printInstr(BCProgram *p, BCInstr *in, FILE *out) {
+    const char *ga = in->a >= 0 && in->a < p->globalCount ? symbolName(p->globalSymbols[in->a]) : "?";
+    int op = in->op;
+    fprintf(out, "  %-7s ", bytecodeOpName(op));
+    if (op == BC_NEG) {
+        fprintf(out, "r%d, r%d", in->a, in->b);
+    } else if (op == BC_LOADK) {
+        fprintf(out, "r%d, %d", in->a, in->c);
+    } else if (op == BC_LOADKL) {
+        fprintf(out, "r%d, %lld", in->a, p->constants[in->b]);
+    } else if (op == BC_LOADG) {
+        fprintf(out, "r%d, %s", in->a, symbolName(p->globalSymbols[in->b]));
+    } else if (op == BC_STOREG) {
+        fprintf(out, "%s, r%d", ga, in->b);
+    } else if (op == BC_SETGK || op == BC_ADDGK) {
+        fprintf(out, "%s, %d", ga, in->c);
+    } else if (op >= BC_ADD && op <= BC_GE) {
+        fprintf(out, "r%d, r%d, r%d", in->a, in->b, in->c);
+    } else if (op >= BC_ADDK && op <= BC_GEK) {
+        fprintf(out, "r%d, r%d, %d", in->a, in->b, in->c);
+    } else if (op == BC_JMP) {
+        fprintf(out, "%d", in->b);
+    } else if (op == BC_JZ || op == BC_JNZ) {
+        fprintf(out, "r%d, %d", in->a, in->b);
+    } else if (op >= BC_JEQ && op <= BC_JGE) {
+        fprintf(out, "r%d, r%d, %d", in->a, in->c, in->b);
+    } else if (op >= BC_JEQK && op <= BC_JGEK) {
+        fprintf(out, "r%d, %d, %d", in->a, in->c, in->b);
+    } else if (op >= BC_JEQGK && op <= BC_JGEGK) {
+        fprintf(out, "%s, %d, %d", ga, in->c, in->b);
+    } else if (op >= BC_JEQGG && op <= BC_JGEGG) {
+        fprintf(out, "%s, %s, %d", ga, symbolName(p->globalSymbols[in->c]), in->b);
+    } else if (op == BC_CALL) {
+        fprintf(out, "r%d, %s", in->a, functionName(&p->functions[in->b]));
+    } else if (op == BC_RET || op == BC_PRINTI) {
+        fprintf(out, "r%d", in->a);
+    } else if (op == BC_PRINTS) {
+        printString(p->strings[in->b], p->stringLengths[in->b], out);
+    }
+    fputc('\n', out);
+}
+
+void printBytecode(BCProgram *p, FILE *out) {
+    for (int f = 0; f < p->functionCount; f++) {
+        BCFunction *func = &p->functions[f];
+        int end = f + 1 < p->functionCount ? p->functions[f + 1].entry : p->codeCount;
+        fprintf(out, "%sfunction %s  ; %d registri\n", f ? "\n" : "", functionName(func), func->frameSize);
+        for (int i = func->entry; i < end; i++) {
+            fprintf(out, "%4d", i);
+            printInstr(p, &p->code[i], out);
+        }
+    }
+}
+
+void freeBytecode(BCProgram *p) {
+    if (!p) return;
+    for (int i = 0; i < p->stringCount; i++) free(p->strings[i]);
+    free(p->strings);
+    free(p->stringLengths);
+    free(p->constants);
+    free(p->functions);
+    free(p->globalSymbols);
+    free(p->code);
+    free(p);
+}
@@ -0,0 +1,78 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdio.h>
+#include "ast.h"
+
+// Bytecode a registri per l'interprete (interp.h), tradotto direttamente
+// dall'AST. Le variabili sono globali (G), i temporanei delle espressioni
+// sono registri del frame (R) assegnati a pila; le costanti (K) stanno
+// nell'istruzione quando entrano in 32 bit. Le istruzioni J<cc> confrontano
+// e saltano in un solo passo, nelle forme RR, RK, GK e GG.
+
+#define BC_OPCODES(X) \
+    X(LOADK)    /* R[a] = c */ \
+    X(LOADKL)   /* R[a] = costanti[b] */ \
+    X(LOADG)    /* R[a] = G[b] */ \
+    X(STOREG)   /* G[a] = R[b] */ \
+    X(SETGK)    /* G[a] = c */ \
+    X(ADDGK)    /* G[a] += c */ \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD)              /* R[a] = R[b] op R[c] */ \
+    X(EQ) X(NE) X(LT) X(LE) X(GT) X(GE) \
+    X(ADDK) X(SUBK) X(MULK) X(DIVK) X(MODK)         /* R[a] = R[b] op c */ \
+    X(EQK) X(NEK) X(LTK) X(LEK) X(GTK) X(GEK) \
+    X(NEG)      /* R[a] = -R[b] */ \
+    X(JMP)      /* salta a b */ \
+    X(JZ) X(JNZ)                                    /* R[a] == 0 / != 0 */ \
+    X(JEQ) X(JNE) X(JLT) X(JLE) X(JGT) X(JGE)       /* R[a] cc R[c] */ \
+    X(JEQK) X(JNEK) X(JLTK) X(JLEK) X(JGTK) X(JGEK) /* R[a] cc c */ \
+    X(JEQGK) X(JNEGK) X(JLTGK) X(JLEGK) X(JGTGK) X(JGEGK) /* G[a] cc c */ \
+    X(JEQGG) X(JNEGG) X(JLTGG) X(JLEGG) X(JGTGG) X(JGEGG) /* G[a] cc G[c] */ \
+    X(CALL)     /* R[a] = funzione b(); il frame del chiamato parte da R[a+1] */ \
+    X(RET)      /* restituisce R[a] */ \
+    X(RET0)     /* restituisce 0 */ \
+    X(PRINTI)   /* print R[a] */ \
+    X(PRINTS)   /* print stringhe[b] */ \
+    X(HALT)     /* fine del programma (codice di uscita 0) */
+
+#define BC_ENUM(name) BC_##name,
+typedef enum {
+    BC_OPCODES(BC_ENUM)
+    BC_OPCOUNT
+} BCOp;
+#undef BC_ENUM
+
+typedef struct {
+    const void *handler;    // gestore nell'interprete (threading diretto)
+    int op;
+    int a, b, c;            // per i salti la destinazione è b
+} BCInstr;
+
+typedef struct {
+    int symbol;             // ID interned del nome (-1 per il programma principale)
+    int entry;              // indice della prima istruzione
+    int frameSize;          // registri usati dal frame
+} BCFunction;
+
+typedef struct {
+    BCInstr *code;
+    int codeCount, codeCap;
+    BCFunction *functions;  // la 0 è il programma principale
+    int functionCount;
+    long long *constants;   // costanti che non entrano in 32 bit
+    int constantCount, constantCap;
+    char **strings;         // escape già decodificati
+    int *stringLengths;
+    int stringCount, stringCap;
+    int *globalSymbols;     // ID del nome di ogni globale
+    int globalCount;
+} BCProgram;
+
+// Gli errori (BREAK fuori da un LOOP, funzioni non definite...) terminano il
+// programma con gli stessi messaggi di lowerProgram
+BCProgram* compileBytecode(ASTNode *root);
+const char* bytecodeOpName(int op);
+void printBytecode(BCProgram *program, FILE *out);
+void freeBytecode(BCProgram *program);
+
+#endif // BYTECODE_H
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "lexer.h"
+
+// Cambia quando cambia il formato delle voci
+#define CACHE_FORMAT "atl-cache-1"
+#define COPY_BUFFER_SIZE 65536
+
+// Configurazione, fissata da initCache prima dei thread
+static char *directory = NULL;
+static long long limit = 0;
+static CacheKey compilerKey;        // formato + eseguibile del compilatore
+
+// Contatori condivisi dai thread (operazioni atomiche)
+static int hits = 0, misses = 0, stores = 0, evictions = 0;
+static int tempCounter = 0;
+
+// Byte occupati dalla cartella, -1 finché non viene misurata
+static pthread_mutex_t sizeLock = PTHREAD_MUTEX_INITIALIZER;
+static long long directoryBytes = -1;
+
+// ---------- HASH ----------
+
+// Due corsie da 64 bit moltiplicative: non crittografico, ma 128 bit
+// bastano a rendere trascurabili le collisioni tra programmi
+static inline unsigned long long rotateLeft(unsigned long long x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static void mixWord(CacheKey *h, unsigned long long word) {
+    h->lo = (h->lo ^ word) * 0x9E3779B97F4A7C15ULL;
+    h->lo ^= h->lo >> 32;
+    h->hi = (h->hi ^ word ^ rotateLeft(h->lo, 17)) * 0xC2B2AE3D27D4EB4FULL;
+    h->hi ^= h->hi >> 29;
+}
+
+static void mixBytes(CacheKey *h, const char *data, size_t length) {
+    mixWord(h, length);
+    unsigned long long word;
+    for (; length >= 8; data += 8, length -= 8) {
+        memcpy(&word, data, 8);
+        mixWord(h, word);
+    }
+    if (length) {
+        word = 0;
+        memcpy(&word, data, length);
+        mixWord(h, word);
+    }
+}
+
+// Qualunque modifica del compilatore cambia le chiavi: si usa il contenuto
+// dell'eseguibile, non la data, perché una ricompilazione identica (CI) deve
+// ritrovare le stesse voci
+static int hashCompiler(CacheKey *h) {
+    int fd = open("/proc/self/exe", O_RDONLY);
+    if (fd < 0) return 0;
+    char *buffer = malloc(COPY_BUFFER_SIZE);
+    ssize_t n;
+    while ((n = read(fd, buffer, COPY_BUFFER_SIZE)) > 0) mixBytes(h, buffer, (size_t) n);
+    free(buffer);
+    close(fd);
+    return n == 0;
+}
+
+// ---------- FILE ----------
+
+static void entryPath(char *out, size_t size, const CacheKey *key, const char *extension) {
+    snprintf(out, size, "%s/%016llx%016llx.%s", directory, key->hi, key->lo, extension);
+}
+
+static int copyFile(const char *from, const char *to, mode_t mode) {
+    int in = open(from, O_RDONLY);
+    if (in < 0) return 0;
+    int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (out < 0) {
+        close(in);
+        return 0;
+    }
+    char *buffer = malloc(COPY_BUFFER_SIZE);
+    int ok = 1;
+    ssize_t n;
+    while (ok && (n = read(in, buffer, COPY_BUFFER_SIZE)) != 0) {
+        if (n < 0) {
+            ok = 0;
+            break;
+        }
+        for (ssize_t done = 0; done < n; ) {
+            ssize_t written = write(out, buffer + done, (size_t) (n - done));
+            if (written <= 0) {
+                ok = 0;
+                break;
+            }
+            done += written;
+        }
+    }
+    free(buffer);
+    close(in);
+    // Un file già esistente conserva i permessi che aveva
+    if (ok) fchmod(out, mode);
+    if (close(out) < 0) ok = 0;
+    return ok;
+}
+
+// ---------- EVICTION ----------
+
+typedef struct {
+    char *name;
+    long long size;
+    struct timespec used;   // mtime: aggiornato a ogni hit
+} Entry;
+
+static int compareUse(const void *a, const void *b) {
+    const Entry *x = a, *y = b;
+    if (x->used.tv_sec != y->used.tv_sec) return x->used.tv_sec < y->used.tv_sec ? -1 : 1;
+    if (x->used.tv_nsec != y->used.tv_nsec) return x->used.tv_nsec < y->used.tv_nsec ? -1 : 1;
+    return 0;
+}
+
+// Misura la cartella e, oltre il limite, elimina le voci usate meno di
+// recente fino a scendere al 90%: la scansione non si ripete a ogni voce
+static void shrinkDirectory() {
+    DIR *dir = opendir(directory);
+    if (!dir) return;
+    Entry *entries = NULL;
+    int count = 0, cap = 0;
+    long long total = 0;
+    char path[4096];
+    struct dirent *d;
+    while ((d = readdir(dir))) {
+        if (d->d_name[0] == '.') continue;      // . .. e i file temporanei
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", directory, d->d_name);
+        if (stat(path, &info) < 0 || !S_ISREG(info.st_mode)) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            entries = realloc(entries, sizeof(Entry) * cap);
+        }
+        entries[count].name = strdup(d->d_name);
+        entries[count].size = (long long) info.st_size;
+        entries[count].used = info.st_mtim;
+        total += entries[count].size;
+        count++;
+    }
+    closedir(dir);
+
+    if (total > limit) {
+        qsort(entries, count, sizeof(Entry), compareUse);
+        for (int i = 0; i < count && total > limit / 10 * 9; i++) {
+            snprintf(path, sizeof(path), "%s/%s", directory, entries[i].name);
+            if (unlink(path) == 0) {
+                total -= entries[i].size;
+                __atomic_fetch_add(&evictions, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) free(entries[i].name);
+    free(entries);
+    directoryBytes = total;
+}
+
+// ---------- API ----------
+
+int initCache(const char *path, long long maxBytes) {
+    struct stat info;
+    if ((mkdir(path, 0777) < 0 && errno != EEXIST) || stat(path, &info) < 0 || !S_ISDIR(info.st_mode)) {
+        fprintf(stderr, "Cartella della cache non utilizzabile: %s\n", path);
+        return 0;
+    }
+    CacheKey key = { 0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL };
+    mixBytes(&key, CACHE_FORMAT, strlen(CACHE_FORMAT));
+    if (!hashCompiler(&key)) {
+        fprintf(stderr, "Impossibile leggere l'eseguibile del compilatore: cache disattivata\n");
+        return 0;
+    }
+    compilerKey = key;
+    directory = strdup(path);
+    limit = maxBytes;
+    return 1;
+}
+
+int cacheEnabled() {
+    return directory != NULL;
+}
+
+void computeCacheKey(CacheKey *key, const char *options) {
+    *key = compilerKey;
+    mixBytes(key, options, strlen(options));
+    for (;;) {
+        const Token *t = peekToken(0);
+        mixWord(key, (unsigned long long) t->type);
+        mixBytes(key, tokenText(t), (size_t) t->length);
+        if (t->type == TOKEN_EOF) break;
+        nextToken();
+    }
+}
+
+int fetchFromCache(const CacheKey *key, const char *extension, const char *path, int executable) {
+    char entry[4096];
+    entryPath(entry, sizeof(entry), key, extension);
+    if (!copyFile(entry, path, executable ? 0755 : 0644)) {
+        __atomic_fetch_add(&misses, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    // L'mtime registra l'ultimo uso per l'eviction
+    utimensat(AT_FDCWD, entry, NULL, 0);
+    __atomic_fetch_add(&hits, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+void storeInCache(const CacheKey *key, const char *extension, const char *path) {
+    char entry[4096], temp[4096];
+    entryPath(entry, sizeof(entry), key, extension);
+    // Copia sotto un nome temporaneo e rename: un lettore concorrente vede
+    // la voce completa o non la vede
+    snprintf(temp, sizeof(temp), "%s/.tmp.%d.%d", directory, (int) getpid(),
+             __atomic_fetch_add(&tempCounter, 1, __ATOMIC_RELAXED));
+    struct stat info;
+    if (!copyFile(path, temp, 0644) || stat(temp, &info) < 0 || rename(temp, entry) < 0) {
+        unlink(temp);
+        return;
+    }
+    __atomic_fetch_add(&stores, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&sizeLock);
+    if (directoryBytes >= 0) directoryBytes += (long long) info.st_size;
+    if (directoryBytes < 0 || directoryBytes > limit) shrinkDirectory();
+    pthread_mutex_unlock(&sizeLock);
+}
+
+void printCacheStats(FILE *out) {
+    fprintf(out, "Cache: %d hit, %d miss, %d voci scritte, %d rimosse\n", hits, misses, stores, evictions);
+}
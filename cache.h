@@ -0,0 +1,29 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+
+// Cache su disco delle uscite (ELF, testo NASM), indirizzata dal contenuto:
+// la chiave è l'hash dello stream di token normalizzato (senza spazi,
+// commenti e posizioni), dell'eseguibile del compilatore e delle opzioni che
+// cambiano l'uscita. Ogni voce è un file <chiave>.<estensione>; quando la
+// cartella supera il limite si eliminano le voci usate meno di recente.
+
+typedef struct {
+    unsigned long long lo, hi;
+} CacheKey;
+
+// Da chiamare prima di avviare i thread. Restituisce 0 (cache disattivata)
+// se la cartella non può essere creata.
+int initCache(const char *directory, long long maxBytes);
+int cacheEnabled();
+
+// Consuma i token del lexer fino a EOF: il chiamante deve riavvolgerlo
+void computeCacheKey(CacheKey *key, const char *options);
+// Copia la voce in path (1 se presente)
+int fetchFromCache(const CacheKey *key, const char *extension, const char *path, int executable);
+// Copia path nella cache; gli errori di I/O vengono ignorati
+void storeInCache(const CacheKey *key, const char *extension, const char *path);
+void printCacheStats(FILE *out);
+
+#endif // CACHE_H
@@ -1,320 +1,722 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "ast.h"
+#include <stdarg.h>
+#include "ir.h"
+#include "asm.h"
 #include "codegen.h"
+#include "regalloc.h"
+#include "context.h"
 
-typedef struct {
-    char name[128];
-} VarDecl;
+#define OUTPUT_BUFFER_SIZE 65536  // byte del buffer di uscita in .bss
 
-static VarDecl declaredVars[256];
-static int varCount = 0;
+static _Thread_local IRModule *module;
+static _Thread_local AsmProgram *program;
+static _Thread_local IRFunction *fn;
+static _Thread_local int lineBuffered = 0; // svuota il buffer di uscita a ogni a capo
+static _Thread_local int hosted = 0;       // eseguito dentro il compilatore: si esce con ret
+static _Thread_local int position = 0;     // indice dell'istruzione corrente nella funzione
+static _Thread_local int stackAdjust = 0;  // qword spinte sullo stack sopra l'area di spill
+static _Thread_local IRInstr *fusedCompare = NULL;  // CMP i cui flag vanno al BR successivo
+static _Thread_local int divisionCount = 0; // etichette .div<n> delle divisioni per -1
 
-typedef struct {
-    char text[256];
-    char label[32];
-} StringLiteral;
+static void emitPrintIntRoutine();
+static void emitOutputRoutines();
+static void emitDivZeroRoutine();
+static void emitHostReturn();
+static void generateFunction(IRFunction *function);
 
-static StringLiteral declaredStrings[256];
-static int stringCount = 0;
+// Le righe vanno nel programma in memoria, non direttamente su stdout
+static void emit(const char *format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    appendAsmInstr(program, line);
+}
 
-static int labelCounter = 0;
-static int loopCounter = 0;
+static void emitLabel(const char *format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    appendAsmLabel(program, line);
+}
 
-static void emitPrintIntRoutine();
-static void emitPrintStringRoutine();
-static void emitStrlenRoutine();
-static void generateNode(ASTNode *node);
-
-static int isVarDeclared(const char *name) {
-    for (int i = 0; i < varCount; i++) {
-        if (strcmp(declaredVars[i].name, name) == 0)
-            return 1;
+static void emitDirective(const char *format, ...) {
+    char line[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    appendAsmDirective(program, line);
+}
+
+static int isImm32(long long v) {
+    return v >= -2147483648LL && v <= 2147483647LL;
+}
+
+static LiveInterval* intervalOf(IRValue v) {
+    return &fn->intervals[v.value];
+}
+
+static int isSpilled(IRValue v) {
+    return v.kind == IRV_VREG && intervalOf(v)->reg == REG_NONE;
+}
+
+static int regOf(IRValue v) {
+    return v.kind == IRV_VREG ? intervalOf(v)->reg : REG_NONE;
+}
+
+// Operando x86 di un valore IR: registro, slot di spill o immediato
+static const char* operand(IRValue v, char *buf) {
+    if (v.kind == IRV_IMM) {
+        sprintf(buf, "%lld", v.value);
+        return buf;
+    }
+    LiveInterval *iv = intervalOf(v);
+    if (iv->reg != REG_NONE) return regName(iv->reg);
+    sprintf(buf, "qword [rsp + %d]", 8 * (iv->spillSlot + stackAdjust));
+    return buf;
+}
+
+static void push(const char *reg) {
+    emit("push %s", reg);
+    stackAdjust++;
+}
+
+static void pop(const char *reg) {
+    emit("pop %s", reg);
+    stackAdjust--;
+}
+
+// Registro vivo attraverso l'istruzione corrente (escluso il risultato)
+static int isLiveAcross(int reg, int except) {
+    for (int v = 0; v < fn->vregCount; v++) {
+        LiveInterval *iv = &fn->intervals[v];
+        if (v == except || iv->reg != reg) continue;
+        if (iv->start < 2 * position && iv->end > 2 * position + 1) return 1;
     }
     return 0;
 }
 
-static void declareVar(const char *name) {
-    strcpy(declaredVars[varCount].name, name);
-    varCount++;
+// Le chiamate (runtime comprese) non preservano i registri del pool
+static int saveLiveRegisters(int except, int *saved) {
+    int count = 0;
+    for (int r = 0; r < NUM_ALLOC_REGS; r++) {
+        if (isLiveAcross(r, except)) {
+            push(regName(r));
+            saved[count++] = r;
+        }
+    }
+    return count;
+}
+
+static void restoreLiveRegisters(int *saved, int count) {
+    for (int i = count - 1; i >= 0; i--) pop(regName(saved[i]));
+}
+
+// Registro su cui calcolare il risultato: r11 se il vreg è in spill
+static const char* workRegister(int dst) {
+    int reg = fn->intervals[dst].reg;
+    return reg == REG_NONE ? REG_SCRATCH : regName(reg);
+}
+
+static void writeBack(int dst) {
+    char buf[64];
+    if (fn->intervals[dst].reg == REG_NONE) {
+        emit("mov %s, %s", operand(irVreg(dst), buf), REG_SCRATCH);
+    }
+}
+
+static void moveTo(const char *reg, IRValue v) {
+    char buf[64];
+    const char *src = operand(v, buf);
+    if (strcmp(reg, src) != 0) emit("mov %s, %s", reg, src);
 }
 
-static int isNumeric(const char *s) {
-    if (!s || !*s) return 0;
-    if (*s == '-' || *s == '+') s++;
-    while (*s) {
-        if (*s < '0' || *s > '9') return 0;
-        s++;
+static const char* blockLabel(IRBlock *block, char *buf) {
+    sprintf(buf, ".L%d", block->id);
+    return buf;
+}
+
+// Suffisso x86 della condizione (setcc, jcc)
+static const char* conditionCode(IRCond cond) {
+    switch (cond) {
+        case CC_EQ: return "e";
+        case CC_NE: return "ne";
+        case CC_LT: return "l";
+        case CC_LE: return "le";
+        case CC_GT: return "g";
+        case CC_GE: return "ge";
+    }
+    return "e";
+}
+
+static IRCond negateCondition(IRCond cond) {
+    switch (cond) {
+        case CC_EQ: return CC_NE;
+        case CC_NE: return CC_EQ;
+        case CC_LT: return CC_GE;
+        case CC_LE: return CC_GT;
+        case CC_GT: return CC_LE;
+        case CC_GE: return CC_LT;
+    }
+    return cond;
+}
+
+// Ogni stringa del pool viene emessa una volta sola con la sua lunghezza:
+// PRINT la scrive senza calcolarla. I caratteri non stampabili e le
+// virgolette vanno fuori dalle virgolette come byte numerici.
+static void emitStringConstant(int index) {
+    const char *text = module->strings[index];
+    int length = (int) strlen(text);
+    char *line = malloc(32 + 6 * length);
+    int pos = sprintf(line, "__str%d db ", index);
+    int quoted = 0;
+    for (int i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) text[i];
+        if (c >= 0x20 && c < 0x7F && c != '"') {
+            if (!quoted) pos += sprintf(line + pos, "%s\"", i ? ", " : "");
+            line[pos++] = c;
+            quoted = 1;
+        } else {
+            if (quoted) line[pos++] = '"';
+            pos += sprintf(line + pos, "%s0x%02X", i ? ", " : "", c);
+            quoted = 0;
+        }
     }
-    return 1;
+    if (quoted) line[pos++] = '"';
+    // La stringa vuota ha comunque un byte, ma lunghezza zero
+    if (length == 0) pos += sprintf(line + pos, "0");
+    line[pos] = '\0';
+    appendAsmDirective(program, line);
+    free(line);
+    emitDirective("__str%d_len equ %d", index, length);
 }
 
-static const char* getStringLabel(const char *txt) {
-    for (int i = 0; i < stringCount; i++) {
-        if (strcmp(declaredStrings[i].text, txt) == 0)
-            return declaredStrings[i].label;
+AsmProgram* generateCode(IRModule *irModule, int lineBufferedOutput, int hostedProgram) {
+    module = irModule;
+    lineBuffered = lineBufferedOutput;
+    hosted = hostedProgram;
+    fusedCompare = NULL;  // un errore può aver interrotto la compilazione precedente
+    stackAdjust = 0;
+    divisionCount = 0;
+    program = createAsmProgram();
+    emitDirective("section .data");
+    emitDirective("__nl db 0x0A");
+    emitDirective("__div_zero_msg db \"Division by zero error\", 0x0A");
+    emitDirective("__div_zero_len equ $ - __div_zero_msg");
+    for (int i = 0; i < module->stringCount; i++) emitStringConstant(i);
+    emitDirective("section .bss");
+    emitDirective("__buf_int resb 32");
+    emitDirective("__out_buf resb %d", OUTPUT_BUFFER_SIZE);
+    emitDirective("__out_len resq 1");
+    if (hosted) emitDirective("__host_rsp resq 1");
+    // I nomi dell'utente prendono un prefisso (g_ le globali, f_ le funzioni):
+    // rax, section o _exit non si confondono con registri, direttive o runtime
+    for (int i = 0; i < module->globalCount; i++) {
+        emitDirective("g_%s resq 1", module->globals[i]);
+    }
+    emitDirective("section .text");
+    emitDirective("global _start");
+    generateFunction(module->functions[0]);
+    emitLabel("_exit");
+    emit("call __flush");
+    if (hosted) {
+        emit("xor eax, eax");
+        emitHostReturn();
+    } else {
+        emit("mov rax, 60");
+        emit("mov rdi, 0");
+        emit("syscall");
     }
-    strcpy(declaredStrings[stringCount].text, txt);
-    sprintf(declaredStrings[stringCount].label, ".str%d", stringCount);
-    stringCount++;
-    return declaredStrings[stringCount - 1].label;
-}
-
-void generateCode(ASTNode *root) {
-    printf("section .data\n");
-    printf("__nl db 0x0A\n");
-    printf("__div_zero_msg db \"Division by zero error\\n\", 0\n");
-    for (int i = 0; i < stringCount; i++) {
-        printf("%s db \"%s\", 0\n", declaredStrings[i].label, declaredStrings[i].text);
+    for (int f = 1; f < module->functionCount; f++) {
+        generateFunction(module->functions[f]);
     }
-    printf("section .bss\n");
-    printf("__buf_int resb 32\n");
-    /* Le variabili globali vengono dichiarate da AST_VAR_DECL */
-    printf("section .text\n");
-    printf("global _start\n");
-    printf("_start:\n");
-    generateNode(root);
-    /* Salto a _exit per evitare di eseguire le routine seguenti */
-    printf("jmp _exit\n");
-    printf("_exit:\n");
-    printf("mov rax, 60\n");
-    printf("mov rdi, 0\n");
-    printf("syscall\n");
     emitPrintIntRoutine();
-    emitPrintStringRoutine();
-    emitStrlenRoutine();
-    printf("\n__error_div_zero:\n");
-    printf("mov rax, 1\n");
-    printf("mov rdi, 1\n");
-    printf("mov rsi, __div_zero_msg\n");
-    printf("mov rdx, 23\n");
-    printf("syscall\n");
-    printf("jmp __error_div_zero\n");
-}
-
-static void generateNode(ASTNode *node) {
-    if (!node) return;
-    switch (node->type) {
-        case AST_PROGRAM:
-            for (int i = 0; i < node->childCount; i++) {
-                generateNode(node->children[i]);
-            }
-            break;
-        case AST_VAR_DECL:
-            if (!isVarDeclared(node->value)) {
-                printf("section .bss\n");
-                printf("%s resq 1\n", node->value);
-                declareVar(node->value);
-            }
-            printf("section .text\n");
-            if (node->childCount > 0) {
-                generateNode(node->children[0]);
-                printf("mov [%s], rax\n", node->value);
+    emitOutputRoutines();
+    emitDivZeroRoutine();
+    return program;
+}
+
+// ---------- SELEZIONE DELLE ISTRUZIONI ----------
+
+static void emitArith(IRInstr *in) {
+    char abuf[64], bbuf[64];
+    const char *mnemonic = in->op == IR_ADD ? "add" : (in->op == IR_SUB ? "sub" : "imul");
+    const char *work = workRegister(in->dst);
+    const char *b = operand(in->b, bbuf);
+
+    if (strcmp(work, b) == 0 && regOf(in->a) != regOf(in->b)) {
+        // Il risultato condivide il registro di b
+        if (in->op == IR_SUB) {
+            emit("neg %s", work);
+            emit("add %s, %s", work, operand(in->a, abuf));
+        } else {
+            emit("%s %s, %s", mnemonic, work, operand(in->a, abuf));
+        }
+    } else {
+        moveTo(work, in->a);
+        emit("%s %s, %s", mnemonic, work, operand(in->b, bbuf));
+    }
+    writeBack(in->dst);
+}
+
+// Costanti (M, s) di Hacker's Delight per la divisione con segno per d,
+// con |d| >= 2 e non potenza di due: q = mulhi(a, M) [+/- a] >> s, +1 se negativo
+static void signedMagic(long long d, long long *magic, int *shift) {
+    const unsigned long long two63 = 1ULL << 63;
+    unsigned long long ad = d < 0 ? 0 - (unsigned long long) d : (unsigned long long) d;
+    unsigned long long t = two63 + ((unsigned long long) d >> 63);
+    unsigned long long anc = t - 1 - t % ad;
+    unsigned long long q1 = two63 / anc, r1 = two63 - q1 * anc;
+    unsigned long long q2 = two63 / ad, r2 = two63 - q2 * ad;
+    unsigned long long delta;
+    int p = 63;
+    do {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    *magic = (long long) (q2 + 1);
+    if (d < 0) *magic = -*magic;
+    *shift = p - 64;
+}
+
+// Divisione per una costante non nulla, senza idiv né controllo dello zero.
+// Il dividendo passa da r11, il risultato resta in rax; rdx viene sporcato.
+static void emitDivisionByConstant(IRInstr *in) {
+    long long d = in->b.value;
+    int isMod = in->op == IR_MOD;
+    moveTo(REG_SCRATCH, in->a);
+
+    if (d == 1 || d == -1) {
+        if (isMod) {
+            emit("xor eax, eax");
+        } else {
+            emit("mov rax, %s", REG_SCRATCH);
+            if (d == -1) emit("neg rax");
+        }
+        return;
+    }
+
+    unsigned long long ad = d < 0 ? 0 - (unsigned long long) d : (unsigned long long) d;
+    if ((ad & (ad - 1)) == 0) {
+        // Potenza di due: ai negativi si aggiunge 2^k - 1 per troncare verso zero
+        int k = 0;
+        while ((1ULL << k) != ad) k++;
+        emit("mov rax, %s", REG_SCRATCH);
+        if (k > 1) emit("sar rax, 63");
+        emit("shr rax, %d", 64 - k);
+        emit("add rax, %s", REG_SCRATCH);
+        if (isMod) {
+            emit("and rax, %lld", -(long long) ad);
+            emit("sub %s, rax", REG_SCRATCH);
+            emit("mov rax, %s", REG_SCRATCH);
+        } else {
+            emit("sar rax, %d", k);
+            if (d < 0) emit("neg rax");
+        }
+        return;
+    }
+
+    long long magic;
+    int shift;
+    signedMagic(d, &magic, &shift);
+    emit("mov rax, %lld", magic);
+    emit("imul %s", REG_SCRATCH);
+    if (d > 0 && magic < 0) emit("add rdx, %s", REG_SCRATCH);
+    if (d < 0 && magic > 0) emit("sub rdx, %s", REG_SCRATCH);
+    if (shift > 0) emit("sar rdx, %d", shift);
+    emit("mov rax, rdx");
+    emit("shr rax, 63");
+    emit("add rax, rdx");
+    if (isMod) {
+        emit("imul rax, rax, %lld", d);
+        emit("sub %s, rax", REG_SCRATCH);
+        emit("mov rax, %s", REG_SCRATCH);
+    }
+}
+
+// Divisione con segno troncata verso zero (cqo/idiv), resto col segno del dividendo
+static void emitDivision(IRInstr *in) {
+    char buf[64];
+    const char *work = workRegister(in->dst);
+    int pushedRax = 0, pushedRdx = 0, pushedDivisor = 0;
+    const char *result = in->op == IR_MOD ? "rdx" : "rax";
+
+    if (strcmp(work, "rax") != 0 && isLiveAcross(REG_RAX, in->dst)) {
+        push("rax");
+        pushedRax = 1;
+    }
+    if (strcmp(work, "rdx") != 0 && isLiveAcross(REG_RDX, in->dst)) {
+        push("rdx");
+        pushedRdx = 1;
+    }
+
+    if (in->b.kind == IRV_IMM && in->b.value != 0) {
+        emitDivisionByConstant(in);
+        result = "rax";
+    } else {
+        // idiv non accetta immediati e il divisore non può stare in rax/rdx
+        const char *divisor;
+        int divReg = regOf(in->b);
+        if (in->b.kind == IRV_IMM || divReg == REG_RAX || divReg == REG_RDX) {
+            push(operand(in->b, buf));
+            pushedDivisor = 1;
+            divisor = "qword [rsp]";
+        } else {
+            divisor = operand(in->b, buf);
+        }
+
+        emit("cmp %s, 0", divisor);
+        emit("je __error_div_zero");
+        moveTo("rax", in->a);
+        // idiv solleva #DE su INT64_MIN / -1: come l'interprete, x / -1 è
+        // 0 - x con wrap-around e x % -1 è 0
+        int label = divisionCount++;
+        emit("cmp %s, -1", divisor);
+        emit("jne .div%d", label);
+        if (in->op == IR_MOD) emit("xor edx, edx");
+        else emit("neg rax");
+        emit("jmp .div%d_fine", label);
+        emitLabel(".div%d", label);
+        emit("cqo");
+        emit("idiv %s", divisor);
+        emitLabel(".div%d_fine", label);
+        if (pushedDivisor) {
+            emit("add rsp, 8");
+            stackAdjust--;
+        }
+    }
+
+    if (strcmp(work, result) != 0) emit("mov %s, %s", work, result);
+    if (pushedRdx) pop("rdx");
+    if (pushedRax) pop("rax");
+    writeBack(in->dst);
+}
+
+// Un confronto usato solo dal BR che lo segue (la condizione di IF e LOOP)
+// non materializza 0/1: il BR salta direttamente sui flag del cmp. Il
+// risultato non è vivo oltre il BR se il suo intervallo finisce lì.
+static int isFusedCompare(IRInstr *in) {
+    IRInstr *br = in->next;
+    return br && br->op == IR_BR && br->a.kind == IRV_VREG && br->a.value == in->dst &&
+           fn->intervals[in->dst].end == 2 * (position + 1);
+}
+
+static void emitCompare(IRInstr *in) {
+    char abuf[64], bbuf[64];
+    const char *a = operand(in->a, abuf);
+    if (in->a.kind == IRV_IMM || (isSpilled(in->a) && isSpilled(in->b))) {
+        emit("mov %s, %s", REG_SCRATCH, a);
+        a = REG_SCRATCH;
+    }
+    emit("cmp %s, %s", a, operand(in->b, bbuf));
+    if (isFusedCompare(in)) {
+        fusedCompare = in;
+        return;
+    }
+    const char *work = workRegister(in->dst);
+    const char *work8 = regName8(fn->intervals[in->dst].reg);
+    emit("set%s %s", conditionCode(in->cond), work8);
+    emit("movzx %s, %s", work, work8);
+    writeBack(in->dst);
+}
+
+static void emitCall(IRInstr *in) {
+    int saved[NUM_ALLOC_REGS];
+    int count = saveLiveRegisters(in->dst, saved);
+    emit("call f_%s", module->functions[in->sym]->name);
+    const char *work = workRegister(in->dst);
+    if (count > 0) {
+        // Il risultato passa da r11 mentre si ripristinano i registri
+        emit("mov %s, rax", REG_SCRATCH);
+        restoreLiveRegisters(saved, count);
+        if (strcmp(work, REG_SCRATCH) != 0) emit("mov %s, %s", work, REG_SCRATCH);
+    } else if (strcmp(work, "rax") != 0) {
+        emit("mov %s, rax", work);
+    }
+    writeBack(in->dst);
+}
+
+static void emitPrint(IRInstr *in) {
+    if (in->op == IR_PRINT_STR && module->strings[in->sym][0] == '\0') return;
+    int saved[NUM_ALLOC_REGS];
+    int count = saveLiveRegisters(-1, saved);
+    if (in->op == IR_PRINT_STR) {
+        emit("mov rsi, __str%d", in->sym);
+        emit("mov rdx, __str%d_len", in->sym);
+        emit("call __out_write");
+    } else {
+        moveTo("rax", in->a);
+        emit("call __print_int");
+    }
+    restoreLiveRegisters(saved, count);
+}
+
+static void emitBranch(IRInstr *in, IRBlock *next) {
+    char buf[64], lbuf[32];
+    IRBlock *ifTrue = in->block->succs[0];
+    IRBlock *ifFalse = in->block->succs[1];
+    if (in->a.kind == IRV_IMM) {
+        IRBlock *target = in->a.value ? ifTrue : ifFalse;
+        if (target != next) emit("jmp %s", blockLabel(target, lbuf));
+        return;
+    }
+    IRCond cond = CC_NE;
+    if (fusedCompare && in->a.value == fusedCompare->dst) {
+        cond = fusedCompare->cond;
+    } else {
+        emit("cmp %s, 0", operand(in->a, buf));
+    }
+    fusedCompare = NULL;
+    if (ifFalse == next) {
+        emit("j%s %s", conditionCode(cond), blockLabel(ifTrue, lbuf));
+    } else {
+        emit("j%s %s", conditionCode(negateCondition(cond)), blockLabel(ifFalse, lbuf));
+        if (ifTrue != next) emit("jmp %s", blockLabel(ifTrue, lbuf));
+    }
+}
+
+static void emitReturn(IRInstr *in) {
+    if (fn->isMain) {
+        emit("jmp _exit");
+        return;
+    }
+    if (in->a.kind != IRV_NONE) moveTo("rax", in->a);
+    else emit("xor rax, rax");
+    if (fn->spillSlots > 0) emit("add rsp, %d", 8 * fn->spillSlots);
+    emit("ret");
+}
+
+static void generateInstr(IRInstr *in, IRBlock *next) {
+    char buf[64], lbuf[32];
+    switch (in->op) {
+        case IR_CONST:
+            if (isSpilled(irVreg(in->dst)) && isImm32(in->a.value)) {
+                emit("mov %s, %lld", operand(irVreg(in->dst), buf), in->a.value);
             } else {
-                printf("mov qword [%s], 0\n", node->value);
+                emit("mov %s, %lld", workRegister(in->dst), in->a.value);
+                writeBack(in->dst);
             }
             break;
-        case AST_ASSIGNMENT:
-            generateNode(node->children[1]);
-            printf("mov [%s], rax\n", node->children[0]->value);
+        case IR_COPY:
+            if (regOf(in->a) != REG_NONE && regOf(in->a) == regOf(irVreg(in->dst))) break;
+            moveTo(workRegister(in->dst), in->a);
+            writeBack(in->dst);
             break;
-        case AST_IDENTIFIER:
-            printf("mov rax, [%s]\n", node->value);
+        case IR_LOAD:
+            emit("mov %s, [g_%s]", workRegister(in->dst), module->globals[in->sym]);
+            writeBack(in->dst);
             break;
-        case AST_LITERAL:
-            if (isNumeric(node->value)) {
-                printf("mov rax, %s\n", node->value);
+        case IR_STORE:
+            if (in->a.kind == IRV_IMM && isImm32(in->a.value)) {
+                emit("mov qword [g_%s], %lld", module->globals[in->sym], in->a.value);
+            } else if (in->a.kind == IRV_IMM || isSpilled(in->a)) {
+                moveTo(REG_SCRATCH, in->a);
+                emit("mov [g_%s], %s", module->globals[in->sym], REG_SCRATCH);
             } else {
-                printf("xor rax, rax\n");
+                emit("mov [g_%s], %s", module->globals[in->sym], operand(in->a, buf));
             }
             break;
-        case AST_BINARY_EXPR: {
-            ASTNode *left = node->children[0];
-            ASTNode *right = node->children[1];
-            generateNode(left);
-            printf("push rax\n");
-            generateNode(right);
-            printf("pop rbx\n");
-            if (strcmp(node->value, "+") == 0) {
-                printf("add rbx, rax\n");
-                printf("mov rax, rbx\n");
-            } else if (strcmp(node->value, "-") == 0) {
-                printf("sub rbx, rax\n");
-                printf("mov rax, rbx\n");
-            } else if (strcmp(node->value, "*") == 0) {
-                printf("imul rbx, rax\n");
-                printf("mov rax, rbx\n");
-            } else if (strcmp(node->value, "/") == 0) {
-                printf("cmp rax, 0\n");
-                printf("je __error_div_zero\n");
-                printf("mov rcx, rax\n");
-                printf("mov rax, rbx\n");
-                printf("xor rdx, rdx\n");
-                printf("div rcx\n");
-            } else if (strcmp(node->value, "<") == 0) {
-                printf("cmp rbx, rax\n");
-                printf("setl al\n");
-                printf("movzx rax, al\n");
-            } else if (strcmp(node->value, ">") == 0) {
-                printf("cmp rbx, rax\n");
-                printf("setg al\n");
-                printf("movzx rax, al\n");
-            } else if (strcmp(node->value, "==") == 0) {
-                printf("cmp rbx, rax\n");
-                printf("sete al\n");
-                printf("movzx rax, al\n");
-            } else if (strcmp(node->value, "!=") == 0) {
-                printf("cmp rbx, rax\n");
-                printf("setne al\n");
-                printf("movzx rax, al\n");
-            }
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+            emitArith(in);
             break;
-        }
-        case AST_IF: {
-            int elseLabel = labelCounter++;
-            int endLabel = labelCounter++;
-            generateNode(node->children[0]);
-            printf("cmp rax, 0\n");
-            printf("je _else%d\n", elseLabel);
-            generateNode(node->children[1]);
-            printf("jmp _endif%d\n", endLabel);
-            printf("_else%d:\n", elseLabel);
-            if (node->childCount > 2)
-                generateNode(node->children[2]);
-            printf("_endif%d:\n", endLabel);
+        case IR_DIV:
+        case IR_MOD:
+            emitDivision(in);
             break;
-        }
-        case AST_LOOP: {
-            int currentLoop = loopCounter++;
-            int endLabel = labelCounter++;
-            printf("_loop%d:\n", currentLoop);
-            generateNode(node->children[0]); // Valutazione della condizione
-            printf("cmp rax, 0\n");
-            printf("je _end_loop%d\n", endLabel);
-            generateNode(node->children[1]); // Corpo del loop
-            printf("jmp _loop%d\n", currentLoop);
-            printf("_end_loop%d:\n", endLabel);
+        case IR_NEG:
+            moveTo(workRegister(in->dst), in->a);
+            emit("neg %s", workRegister(in->dst));
+            writeBack(in->dst);
             break;
-        }
-        case AST_BREAK: {
-            // Trova il loop più vicino e salta alla sua etichetta di fine
-            printf("jmp _end_loop%d\n", loopCounter - 1);
+        case IR_CMP:
+            emitCompare(in);
             break;
-        }
-
-        case AST_FUNCTION_DEF:
-            printf("%s:\n", node->value);
-            for (int i = 0; i < node->childCount; i++) {
-                generateNode(node->children[i]);
-            }
-            printf("ret\n");
+        case IR_CALL:
+            emitCall(in);
             break;
-        case AST_RETURN:
-            if (node->childCount > 0)
-                generateNode(node->children[0]);
-            else
-                printf("xor rax, rax\n");
+        case IR_PRINT_INT:
+        case IR_PRINT_STR:
+            emitPrint(in);
             break;
-        case AST_PRINT: {
-            if (node->childCount > 0) {
-                ASTNode *arg = node->children[0];
-                if (arg->type == AST_LITERAL && !isNumeric(arg->value)) {
-                    const char *lbl = getStringLabel(arg->value);
-                    printf("section .data\n");
-                    printf("%s db \"%s\", 0\n", lbl, arg->value);
-                    printf("section .text\n");
-                    printf("mov rdi, %s\n", lbl);
-                    printf("call __print_string\n");
-                } else {
-                    generateNode(arg);
-                    printf("call __print_int\n");
-                }
-            }
+        case IR_JMP:
+            if (in->block->succs[0] != next) emit("jmp %s", blockLabel(in->block->succs[0], lbuf));
             break;
-        }
-        case AST_BLOCK: {
-            for (int i = 0; i < node->childCount; i++) {
-                generateNode(node->children[i]);
-            }
+        case IR_BR:
+            emitBranch(in, next);
             break;
+        case IR_RET:
+            emitReturn(in);
+            break;
+        case IR_PHI:
+            sourceError(0, 0, "Errore: phi non eliminato prima della generazione del codice");
+    }
+}
+
+// Un blocco raggiunto da un arco all'indietro apre un ciclo: lo si allinea a
+// 16 byte perché il salto in fondo al corpo ricada su una riga di fetch intera
+static int isLoopHeader(IRBlock *block) {
+    for (int i = 0; i < block->predCount; i++) {
+        if (block->preds[i]->rpoIndex >= block->rpoIndex) return 1;
+    }
+    return 0;
+}
+
+static void generateFunction(IRFunction *function) {
+    char lbuf[32];
+    fn = function;
+    allocateRegisters(fn);
+
+    emitLabel(fn->isMain ? "%s" : "f_%s", fn->name);
+    // Lo stack del chiamante, da ripristinare a qualunque profondità si esca
+    if (fn->isMain && hosted) emit("mov [__host_rsp], rsp");
+    if (fn->spillSlots > 0) emit("sub rsp, %d", 8 * fn->spillSlots);
+
+    position = 0;
+    stackAdjust = 0;
+    for (int i = 0; i < fn->blockCount; i++) {
+        IRBlock *block = fn->blocks[i];
+        IRBlock *next = i + 1 < fn->blockCount ? fn->blocks[i + 1] : NULL;
+        if (isLoopHeader(block)) emitDirective("align 16");
+        emitLabel("%s", blockLabel(block, lbuf));
+        for (IRInstr *in = block->first; in; in = in->next) {
+            generateInstr(in, next);
+            position++;
         }
-        default:
-            printf("Errore: nodo sconosciuto\n");
-            exit(EXIT_FAILURE);
     }
 }
 
 static void emitPrintIntRoutine() {
-    printf("\n__print_int:\n");
-    printf("push rbx\n");
-    printf("push rcx\n");
-    printf("push rdx\n");
-    printf("mov rbx, rax\n");
-    printf("mov rax, rbx\n");
-    printf("mov rbx, 0\n");
-    printf("cmp rax, 0\n");
-    printf("jge .conv_start\n");
-    printf("mov rbx, 1\n");
-    printf("neg rax\n");
-    printf(".conv_start:\n");
-    printf("xor rcx, rcx\n");
-    printf("mov rdi, __buf_int\n");
-    printf("add rdi, 31\n");
-    printf("mov byte [rdi], 0\n");
-    printf(".conv_loop:\n");
-    printf("xor rdx, rdx\n");
-    printf("mov rbx, 10\n");
-    printf("div rbx\n");
-    printf("add dl, '0'\n");
-    printf("dec rdi\n");
-    printf("mov [rdi], dl\n");
-    printf("inc rcx\n");
-    printf("cmp rax, 0\n");
-    printf("jne .conv_loop\n");
-    printf("cmp rbx, 1\n");
-    printf("jne .skip_minus\n");
-    printf("dec rdi\n");
-    printf("mov byte [rdi], '-'\n");
-    printf(".skip_minus:\n");
-    printf("mov rsi, rdi\n");
-    printf("mov rax, 1\n");
-    printf("mov rdi, 1\n");
-    printf("xor rcx, rcx\n");
-    printf(".len_loop:\n");
-    printf("cmp byte [rsi + rcx], 0\n");
-    printf("je .len_done\n");
-    printf("inc rcx\n");
-    printf("jmp .len_loop\n");
-    printf(".len_done:\n");
-    printf("mov rdx, rcx\n");
-    printf("syscall\n");
-    printf("pop rdx\n");
-    printf("pop rcx\n");
-    printf("pop rbx\n");
-    printf("ret\n");
-}
-
-static void emitPrintStringRoutine() {
-    printf("\n__print_string:\n");
-    printf("push rdi\n");
-    printf("call strlen\n");
-    printf("mov rdx, rax\n");
-    printf("pop rsi\n");
-    printf("mov rax, 1\n");
-    printf("mov rdi, 1\n");
-    printf("syscall\n");
-    printf("ret\n");
-}
-
-static void emitStrlenRoutine() {
-    printf("\nstrlen:\n");
-    printf("xor rax, rax\n");
-    printf(".strlen_loop:\n");
-    printf("cmp byte [rdi + rax], 0\n");
-    printf("je .strlen_done\n");
-    printf("inc rax\n");
-    printf("jmp .strlen_loop\n");
-    printf(".strlen_done:\n");
-    printf("ret\n");
+    // rax = valore: le cifre vengono scritte a ritroso in __buf_int
+    emitLabel("__print_int");
+    emit("lea rdi, [__buf_int + 32]");
+    emit("mov r8, rax");
+    emit("test rax, rax");
+    emit("jns .conv_loop_start");
+    emit("neg rax");
+    emitLabel(".conv_loop_start");
+    emit("mov rcx, 10");
+    emitLabel(".conv_loop");
+    emit("xor edx, edx");
+    emit("div rcx");
+    emit("add dl, '0'");
+    emit("dec rdi");
+    emit("mov [rdi], dl");
+    emit("test rax, rax");
+    emit("jnz .conv_loop");
+    emit("test r8, r8");
+    emit("jns .conv_done");
+    emit("dec rdi");
+    emit("mov byte [rdi], '-'");
+    emitLabel(".conv_done");
+    emit("mov rsi, rdi");
+    emit("lea rdx, [__buf_int + 32]");
+    emit("sub rdx, rdi");
+    emit("jmp __out_write");
+}
+
+// __out_write accoda rdx byte da rsi al buffer di uscita, svuotandolo
+// quando è pieno; i blocchi più grandi del buffer vanno scritti direttamente
+static void emitOutputRoutines() {
+    emitLabel("__out_write");
+    emit("mov rax, [__out_len]");
+    emit("mov rcx, %d", OUTPUT_BUFFER_SIZE);
+    emit("sub rcx, rax");
+    emit("cmp rdx, rcx");
+    emit("jbe .copy");
+    emit("push rsi");
+    emit("push rdx");
+    emit("call __flush");
+    emit("pop rdx");
+    emit("pop rsi");
+    emit("xor eax, eax");
+    emit("cmp rdx, %d", OUTPUT_BUFFER_SIZE);
+    emit("jbe .copy");
+    emit("mov rax, 1");
+    emit("mov rdi, 1");
+    emit("syscall");
+    emit("ret");
+    emitLabel(".copy");
+    emit("lea rdi, [__out_buf + rax]");
+    emit("add rax, rdx");
+    emit("mov [__out_len], rax");
+    emit("mov rcx, rdx");
+    emit("rep movsb");
+    if (lineBuffered) {
+        // Con un a capo tra i byte appena copiati si svuota subito
+        emit("test rdx, rdx");
+        emit("jz .copy_done");
+        emit("sub rsi, rdx");
+        emit("mov rdi, rsi");
+        emit("mov rcx, rdx");
+        emit("mov al, 0x0A");
+        emit("repne scasb");
+        emit("je __flush");
+        emitLabel(".copy_done");
+    }
+    emit("ret");
+
+    // Scrive il contenuto del buffer, ripetendo la write se parziale
+    emitLabel("__flush");
+    emit("mov rsi, __out_buf");
+    emit("mov rdx, [__out_len]");
+    emitLabel(".flush_loop");
+    emit("test rdx, rdx");
+    emit("jle .flush_done");
+    emit("mov rax, 1");
+    emit("mov rdi, 1");
+    emit("syscall");
+    emit("test rax, rax");
+    emit("jle .flush_done");
+    emit("add rsi, rax");
+    emit("sub rdx, rax");
+    emit("jmp .flush_loop");
+    emitLabel(".flush_done");
+    emit("mov qword [__out_len], 0");
+    emit("ret");
+}
+
+static void emitDivZeroRoutine() {
+    // L'uscita già accumulata va scritta prima del messaggio
+    emitLabel("__error_div_zero");
+    emit("call __flush");
+    emit("mov rax, 1");
+    emit("mov rdi, 1");
+    emit("mov rsi, __div_zero_msg");
+    emit("mov rdx, __div_zero_len");
+    emit("syscall");
+    if (hosted) {
+        emit("mov eax, 1");
+        emitHostReturn();
+    } else {
+        emit("mov rax, 60");
+        emit("mov rdi, 1");
+        emit("syscall");
+    }
+}
+
+// Torna al compilatore con il codice di uscita in eax: _start è stato
+// chiamato come una funzione e usa solo registri caller-saved
+static void emitHostReturn() {
+    emit("mov rsp, [__host_rsp]");
+    emit("ret");
 }
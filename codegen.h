@@ -3,11 +3,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include "ast.h"
+#include "ir.h"
+#include "asm.h"
 
 // Funzioni principali del compilatore
-void generateCode(ASTNode *root);
+// Seleziona le istruzioni per tutto il modulo e le restituisce in memoria.
+// L'uscita di PRINT passa da un buffer svuotato quando è pieno e all'uscita;
+// con lineBufferedOutput anche a ogni a capo. Con hostedProgram il programma
+// non termina il processo: _start si chiama come int (*)(void) e restituisce
+// il codice di uscita (--run).
+AsmProgram* generateCode(IRModule *module, int lineBufferedOutput, int hostedProgram);
 static void emitPrintIntRoutine();
-static void generateNode(ASTNode *node);
 
-#endif // COMPILER_H
\ No newline at end of file
+#endif // COMPILER_H
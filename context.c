@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "context.h"
+#include "lexer.h"
+#include "parser.h"
+#include "fold.h"
+#include "irgen.h"
+#include "ssa.h"
+#include "licm.h"
+#include "unroll.h"
+#include "codegen.h"
+#include "peephole.h"
+#include "intern.h"
+#include "scan.h"
+#include "x86.h"
+#include "elf64.h"
+#include "jit.h"
+#include "bytecode.h"
+#include "interp.h"
+#include "cache.h"
+#include "report.h"
+
+// Il sorgente viene mappato in sola lettura e il lexer lavora direttamente
+// sulla mappatura. Il lexer si ferma al primo '\0' e legge blocchi allineati
+// (scan.h), quindi dopo il file serve almeno un byte a zero nella stessa
+// mappatura: si riserva una regione anonima (azzerata) di un byte più grande
+// del file, arrotondata alle pagine, e il file viene mappato sopra l'inizio.
+static const char *mapSource(const char *filename, size_t *sourceLength, size_t *mappedLength) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: errore nell'aprire il file sorgente: %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || !S_ISREG(info.st_mode)) {
+        fprintf(stderr, "%s: il sorgente deve essere un file regolare\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t) info.st_size;
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t total = (length + 1 + page - 1) & ~(page - 1);
+    char *base = mmap(NULL, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "%s: errore nel mappare il file sorgente: %s\n", filename, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if (length > 0 &&
+        mmap(base, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        fprintf(stderr, "%s: errore nel mappare il file sorgente: %s\n", filename, strerror(errno));
+        munmap(base, total);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    madvise(base, total, MADV_SEQUENTIAL);
+    *sourceLength = length;
+    *mappedLength = total;
+    return base;
+}
+
+void initCompilerContext(CompilerContext *ctx) {
+    memset(ctx, 0, sizeof(CompilerContext));
+    ctx->output = OUTPUT_ELF;
+    ctx->peephole = 1;
+    ctx->unroll = 4;
+}
+
+static void releaseContext(CompilerContext *ctx) {
+    freeAsmProgram(ctx->program);
+    freeIRModule(ctx->module);
+    freeAST();
+    freeSymbols();
+    if (ctx->source) munmap((void*) ctx->source, ctx->mappedLength);
+    ctx->program = NULL;
+    ctx->module = NULL;
+    ctx->root = NULL;
+    ctx->source = NULL;
+}
+
+// Bytecode e interprete partono dall'AST così com'è, senza constant folding
+// né IR: l'interprete resta un riferimento indipendente da quelle fasi
+static int runBytecodeBackend(CompilerContext *ctx, FILE *out, CompileReport *report) {
+    BCProgram *bytecode = compileBytecode(ctx->root);
+    addPhaseCounter(endPhase(report, "bytecode"), "instructions", bytecode->codeCount);
+    int status = 0;
+    if (ctx->output == OUTPUT_BYTECODE) {
+        printBytecode(bytecode, out);
+        endPhase(report, "print");
+    } else {
+        status = runBytecode(bytecode, ctx->lineBuffered);
+        endPhase(report, "run");
+    }
+    freeBytecode(bytecode);
+    return status >= 0 ? status : 1;
+}
+
+static int writeAsmText(CompilerContext *ctx) {
+    // Testo NASM, da assemblare con nasm -f elf64 e ld
+    if (!ctx->outputPath && ctx->sink) {
+        printAsm(ctx->program, ctx->sink);
+        return 1;
+    }
+    FILE *file = fopen(ctx->outputPath ? ctx->outputPath : "output.asm", "w");
+    if (!file) {
+        perror("Errore nell'aprire il file");
+        return 0;
+    }
+    printAsm(ctx->program, file);
+    fclose(file);
+    return 1;
+}
+
+// Percorso del file prodotto, NULL se l'uscita non è un file (e quindi non
+// passa dalla cache)
+static const char *outputFile(const CompilerContext *ctx) {
+    if (ctx->output == OUTPUT_ELF) return ctx->outputPath ? ctx->outputPath : "program";
+    if (ctx->output == OUTPUT_ASM && (ctx->outputPath || !ctx->sink)) {
+        return ctx->outputPath ? ctx->outputPath : "output.asm";
+    }
+    return NULL;
+}
+
+static long long countIRInstrs(IRModule *module) {
+    long long count = 0;
+    for (int f = 0; f < module->functionCount; f++) {
+        IRFunction *fn = module->functions[f];
+        for (int b = 0; b < fn->blockCount; b++) {
+            for (IRInstr *instr = fn->blocks[b]->first; instr; instr = instr->next) count++;
+        }
+    }
+    return count;
+}
+
+static long long fileSize(const char *path) {
+    struct stat info;
+    return path && stat(path, &info) == 0 ? (long long) info.st_size : 0;
+}
+
+static const char *outputKindName(OutputKind output) {
+    static const char *names[] = { "elf", "asm", "ir", "bytecode", "run", "interp" };
+    return names[output];
+}
+
+// folded < 0: constant folding non eseguito
+static void emitReport(CompilerContext *ctx, CompileReport *report, FILE *out, int cacheHit, int folded) {
+    if (ctx->report == REPORT_TEXT) {
+        printReport(report, stderr);
+        return;
+    }
+    if (ctx->output == OUTPUT_RUN || ctx->output == OUTPUT_INTERP) out = stderr;
+    fputs("{\"input\": ", out);
+    printJSONString(ctx->inputPath, out);
+    fprintf(out, ", \"output\": \"%s\", \"cache_hit\": %s, \"total_ms\": %.3f, \"phases\": ",
+            outputKindName(ctx->output), cacheHit ? "true" : "false", totalMilliseconds(report));
+    printReportPhasesJSON(report, out);
+    if (folded >= 0) fprintf(out, ", \"fold_removed\": %d", folded);
+    if (ctx->program && ctx->peephole) {
+        fputs(", \"peephole\": ", out);
+        printPeepholeStatsJSON(out);
+    }
+    fputs("}\n", out);
+}
+
+// Dove riprende il thread quando una fase chiama failCompilation
+static _Thread_local jmp_buf *failureTarget;
+static _Thread_local const char *failurePath;   // sorgente della compilazione in corso
+
+_Noreturn void failCompilation(void) {
+    if (failureTarget) longjmp(*failureTarget, 1);
+    exit(EXIT_FAILURE);
+}
+
+_Noreturn void sourceError(int line, int position, const char *format, ...) {
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    // Un solo fprintf per messaggio: le righe dei worker non si mescolano
+    if (!failurePath) fprintf(stderr, "%s\n", message);
+    else if (line > 0) fprintf(stderr, "%s:%d:%d: %s\n", failurePath, line, position, message);
+    else fprintf(stderr, "%s: %s\n", failurePath, message);
+    failCompilation();
+}
+
+static int compileSource(CompilerContext *ctx) {
+    FILE *out = ctx->sink ? ctx->sink : stdout;
+    CompileReport phases;
+    CompileReport *report = NULL;
+    if (ctx->report != REPORT_NONE) {
+        initReport(&phases);
+        report = &phases;
+    }
+
+    ctx->source = mapSource(ctx->inputPath, &ctx->sourceLength, &ctx->mappedLength);
+    if (!ctx->source) return 1;     // mapSource ha già segnalato il file
+    addPhaseCounter(endPhase(report, "read"), "bytes", (long long) ctx->sourceLength);
+
+    // Di norma non si stampa nulla: le fasi si ispezionano con --dump-*
+    initLexer(ctx->source);
+
+    // Con la cache un sorgente già visto (stessi token, stesso compilatore,
+    // stesse opzioni) non viene né analizzato né compilato. I dump chiedono
+    // le fasi, quindi la escludono.
+    CacheKey key;
+    const char *path = outputFile(ctx);
+    const char *extension = ctx->output == OUTPUT_ASM ? "asm" : "elf";
+    int cached = cacheEnabled() && path && !ctx->dumpTokens && !ctx->dumpAST;
+    if (cached) {
+        char options[64];
+        snprintf(options, sizeof(options), "%s peephole=%d unroll=%d line=%d", extension, ctx->peephole,
+                 ctx->unroll, ctx->lineBuffered);
+        computeCacheKey(&key, options);
+        int hit = fetchFromCache(&key, extension, path, ctx->output == OUTPUT_ELF);
+        PhaseReport *lookup = endPhase(report, "cache-lookup");
+        addPhaseCounter(lookup, "tokens", scannedTokenCount());
+        if (hit) {
+            addPhaseCounter(lookup, "bytes", fileSize(path));
+            if (report) emitReport(ctx, report, out, 1, -1);
+            releaseContext(ctx);
+            return 0;
+        }
+        initLexer(ctx->source);
+    }
+
+    if (ctx->dumpTokens) {
+        fprintf(out, "=== LEXER PHASE ===\n");
+        printTokens(out);
+        endPhase(report, "dump-tokens");
+    }
+
+    // Il lexer produce i token su richiesta del parser: le due fasi si
+    // misurano insieme
+    ctx->root = parseProgram();
+    PhaseReport *parse = endPhase(report, "parse");
+    addPhaseCounter(parse, "tokens", scannedTokenCount());
+    addPhaseCounter(parse, "nodes", astNodeCount());
+    if (ctx->dumpAST) {
+        fprintf(out, "=== PARSER PHASE ===\n");
+        printAST(ctx->root, 0, out);
+        endPhase(report, "dump-ast");
+    }
+
+    if (ctx->output == OUTPUT_BYTECODE || ctx->output == OUTPUT_INTERP) {
+        int status = runBytecodeBackend(ctx, out, report);
+        if (report) emitReport(ctx, report, out, 0, -1);
+        releaseContext(ctx);
+        return status;
+    }
+
+    int folded = foldConstants(ctx->root);
+    addPhaseCounter(endPhase(report, "fold"), "removed", folded);
+    // Il folding trova i limiti costanti dei cicli; sulle copie srotolate
+    // ripiega le espressioni del contatore
+    int unrolled = unrollLoops(ctx->root, ctx->unroll);
+    int refolded = unrolled > 0 ? foldConstants(ctx->root) : 0;
+    folded += refolded;
+    PhaseReport *unrollPhase = endPhase(report, "unroll");
+    addPhaseCounter(unrollPhase, "loops", unrolled);
+    addPhaseCounter(unrollPhase, "removed", refolded);
+    if (ctx->stats) {
+        fprintf(out, "Constant folding: %d nodi rimossi\n", folded);
+        fprintf(out, "Unrolling: %d cicli srotolati\n", unrolled);
+    }
+
+    ctx->module = lowerProgram(ctx->root);
+    IRModule *module = ctx->module;
+    if (report) addPhaseCounter(endPhase(report, "lower"), "instructions", countIRInstrs(module));
+    // Le definizioni rimaste senza usi si tolgono subito dopo la costruzione
+    // e di nuovo dopo le ottimizzazioni dei cicli, che ne lasciano altre
+    int dead = 0, loopDead = 0;
+    for (int f = 0; f < module->functionCount; f++) {
+        constructSSA(module->functions[f]);
+        dead += removeDeadCode(module->functions[f]);
+    }
+    PhaseReport *ssa = endPhase(report, "ssa");
+    if (report) addPhaseCounter(ssa, "instructions", countIRInstrs(module));
+    addPhaseCounter(ssa, "dead", dead);
+    int hoisted = 0, reduced = 0;
+    for (int f = 0; f < module->functionCount; f++) {
+        hoisted += hoistLoopInvariants(module->functions[f]);
+        reduced += reduceInductionStrength(module->functions[f]);
+        loopDead += removeDeadCode(module->functions[f]);
+    }
+    PhaseReport *loops = endPhase(report, "loops");
+    addPhaseCounter(loops, "hoisted", hoisted);
+    addPhaseCounter(loops, "reduced", reduced);
+    addPhaseCounter(loops, "dead", loopDead);
+    if (ctx->stats) {
+        fprintf(out, "LICM: %d istruzioni spostate fuori dai cicli\n", hoisted);
+        fprintf(out, "Riduzione di forza: %d moltiplicazioni sostituite da somme\n", reduced);
+        fprintf(out, "Codice morto: %d istruzioni rimosse\n", dead + loopDead);
+    }
+
+    if (ctx->output == OUTPUT_IR) {
+        // Solo l'IR, per poterlo confrontare con diff
+        printIR(module, out);
+        endPhase(report, "print");
+        if (report) emitReport(ctx, report, out, 0, folded);
+        releaseContext(ctx);
+        return 0;
+    }
+
+    for (int f = 0; f < module->functionCount; f++) {
+        destructSSA(module->functions[f]);
+    }
+    if (report) addPhaseCounter(endPhase(report, "ssa-destruct"), "instructions", countIRInstrs(module));
+
+    ctx->program = generateCode(module, ctx->lineBuffered, ctx->output == OUTPUT_RUN);
+    addPhaseCounter(endPhase(report, "codegen"), "instructions", ctx->program->instrCount);
+    if (ctx->peephole) {
+        optimizePeephole(ctx->program);
+        addPhaseCounter(endPhase(report, "peephole"), "instructions", ctx->program->instrCount);
+        if (ctx->stats) printPeepholeStats(out);
+    }
+
+    int ok = 1;
+    int status = 0;
+    if (ctx->output == OUTPUT_RUN) {
+        // Nessun file: il codice viene eseguito qui, il suo codice di uscita è il nostro
+        MachineCode *code = assembleProgram(ctx->program);
+        addPhaseCounter(endPhase(report, "assemble"), "bytes", code->textSize + code->dataSize);
+        status = runMachineCode(code);
+        ok = status >= 0;
+        freeMachineCode(code);
+        endPhase(report, "run");
+    } else if (ctx->output == OUTPUT_ASM) {
+        ok = writeAsmText(ctx);
+        addPhaseCounter(endPhase(report, "write"), "bytes", fileSize(path));
+    } else {
+        MachineCode *code = assembleProgram(ctx->program);
+        addPhaseCounter(endPhase(report, "assemble"), "bytes", code->textSize + code->dataSize);
+        ok = writeElfExecutable(code, path);
+        freeMachineCode(code);
+        addPhaseCounter(endPhase(report, "write"), "bytes", fileSize(path));
+    }
+    if (ok && cached) {
+        storeInCache(&key, extension, path);
+        endPhase(report, "cache-store");
+    }
+
+    if (report) emitReport(ctx, report, out, 0, folded);
+    releaseContext(ctx);
+    return ok ? status : 1;
+}
+
+// Un errore in una fase non termina il processo: con --jobs gli altri
+// sorgenti continuano, e questo conta fra le compilazioni fallite
+int compileFile(CompilerContext *ctx) {
+    jmp_buf failure;
+    if (setjmp(failure)) {
+        failureTarget = NULL;
+        failurePath = NULL;
+        releaseContext(ctx);
+        return 1;
+    }
+    failureTarget = &failure;
+    failurePath = ctx->inputPath;
+    int status = compileSource(ctx);
+    failureTarget = NULL;
+    failurePath = NULL;
+    return status;
+}
+
+// ---------- BATCH ----------
+
+// I thread si contendono l'indice del prossimo sorgente: i file lunghi non
+// bloccano quelli corti assegnati allo stesso thread
+typedef struct {
+    const CompilerContext *options;
+    const char **inputs;
+    int count;
+    int next;
+    int failures;
+} BatchQueue;
+
+// prova.atl -> prova (ELF) o prova.asm; senza estensione .atl si aggiunge
+// .out, così l'uscita non sovrascrive mai il sorgente
+static char* batchOutputPath(const char *input, OutputKind output) {
+    size_t length = strlen(input);
+    int hasExtension = length > 4 && strcmp(input + length - 4, ".atl") == 0;
+    size_t base = hasExtension ? length - 4 : length;
+    const char *suffix = output == OUTPUT_ASM ? ".asm" : hasExtension ? "" : ".out";
+    char *path = malloc(base + strlen(suffix) + 1);
+    memcpy(path, input, base);
+    strcpy(path + base, suffix);
+    return path;
+}
+
+static void* batchWorker(void *arg) {
+    BatchQueue *queue = arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+        if (i >= queue->count) break;
+        CompilerContext ctx = *queue->options;
+        ctx.inputPath = queue->inputs[i];
+        char *outputPath = batchOutputPath(ctx.inputPath, ctx.output);
+        ctx.outputPath = outputPath;
+        if (compileFile(&ctx) != 0) __atomic_fetch_add(&queue->failures, 1, __ATOMIC_RELAXED);
+        free(outputPath);
+    }
+    return NULL;
+}
+
+int compileBatch(const CompilerContext *options, const char **inputs, int count, int jobs) {
+    BatchQueue queue = { options, inputs, count, 0, 0 };
+    if (jobs > count) jobs = count;
+    if (jobs < 1) jobs = 1;
+
+    // Il percorso di scansione è condiviso: si sceglie prima di avviare i thread
+    initScan();
+    pthread_t *threads = malloc(sizeof(pthread_t) * jobs);
+    int started = 0;
+    for (int t = 1; t < jobs; t++) {
+        if (pthread_create(&threads[started], NULL, batchWorker, &queue) != 0) break;
+        started++;
+    }
+    // Anche il thread chiamante compila
+    batchWorker(&queue);
+    for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+    free(threads);
+    return queue.failures;
+}
@@ -0,0 +1,79 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "ast.h"
+#include "ir.h"
+#include "asm.h"
+
+// Una compilazione completa, dal file sorgente all'uscita richiesta. Lo stato
+// interno delle fasi (lexer, arena dell'AST, nomi interned, assemblatore...)
+// non sta nel CompilerContext: è _Thread_local e viene azzerato da ogni
+// compilazione. Lo stesso processo può compilare più file uno dopo l'altro,
+// e thread diversi in parallelo, ma su un thread c'è una sola compilazione
+// alla volta: compileFile non è rientrante (una fase non può avviarne
+// un'altra, né su un thread che ne ha una in corso).
+
+typedef enum {
+    OUTPUT_ELF,         // eseguibile ELF64
+    OUTPUT_ASM,         // testo NASM
+    OUTPUT_IR,          // IR in forma SSA
+    OUTPUT_BYTECODE,    // listato del bytecode
+    OUTPUT_RUN,         // esecuzione del codice macchina nel processo
+    OUTPUT_INTERP       // esecuzione del bytecode
+} OutputKind;
+
+typedef enum {
+    REPORT_NONE,
+    REPORT_TEXT,        // tabella delle fasi su stderr (--time-report)
+    REPORT_JSON         // fasi e statistiche in JSON su sink (--stats=json); su
+                        // stderr con --run e --interp, dove stdout è del programma
+} ReportKind;
+
+typedef struct {
+    // Opzioni
+    const char *inputPath;
+    const char *outputPath;     // ELF e ASM, NULL: program / output.asm
+    FILE *sink;                 // testo (dump, IR, bytecode, statistiche), NULL: stdout
+    OutputKind output;
+    int dumpTokens;
+    int dumpAST;
+    int stats;
+    ReportKind report;
+    int peephole;
+    int unroll;                 // fattore di srotolamento dei cicli, 1: nessuno
+    int lineBuffered;
+
+    // Prodotti delle fasi, rilasciati alla fine di compileFile
+    const char *source;
+    size_t sourceLength;
+    size_t mappedLength;
+    ASTNode *root;
+    IRModule *module;
+    AsmProgram *program;
+} CompilerContext;
+
+void initCompilerContext(CompilerContext *ctx);     // opzioni predefinite
+// Restituisce il codice di uscita del programma per OUTPUT_RUN e
+// OUTPUT_INTERP, altrimenti 0 (1 se l'uscita non è stata prodotta). Un
+// errore nel sorgente viene segnalato e la compilazione restituisce 1.
+int compileFile(CompilerContext *ctx);
+
+// Per le fasi: dopo aver segnalato un errore, abbandona la compilazione in
+// corso su questo thread (compileFile restituisce 1). Fuori da compileFile
+// termina il processo.
+_Noreturn void failCompilation(void);
+
+// Segnala un errore nel sorgente in compilazione su questo thread e la
+// abbandona come failCompilation. Il messaggio va su stderr preceduto dal
+// file, "<file>:<riga>:<colonna>: ", così in --jobs si sa quale sorgente è
+// sbagliato; con line 0 la posizione non è nota e si stampa solo il file.
+_Noreturn void sourceError(int line, int position, const char *format, ...);
+
+// Compila ogni sorgente con le opzioni di *options su jobs thread. L'uscita
+// (ELF o ASM) prende il nome dal sorgente: prova.atl -> prova / prova.asm.
+// Restituisce il numero di compilazioni fallite.
+int compileBatch(const CompilerContext *options, const char **inputs, int count, int jobs);
+
+#endif // CONTEXT_H
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+#include <elf.h>
+#include <sys/stat.h>
+#include "elf64.h"
+
+#define ELF_BASE    0x400000ULL     // indirizzo del primo segmento, come con ld
+#define ELF_PAGE    0x1000ULL
+
+int writeElfExecutable(MachineCode *code, const char *path) {
+    // File: intestazioni | text | data | tabella delle sezioni. In memoria ogni segmento inizia su una
+    // pagina propria, allo stesso offset nella pagina che ha nel file. Il text parte su una riga di
+    // cache, come con ld: gli align dei cicli cadono così sulle stesse finestre di fetch.
+    unsigned long long headersSize = sizeof(Elf64_Ehdr) + 2 * sizeof(Elf64_Phdr);
+    unsigned long long textOffset = alignUp(headersSize, 64);
+    unsigned long long dataOffset = alignUp(textOffset + code->textSize, 16);
+    unsigned long long address[SEG_COUNT];
+    address[SEG_TEXT] = ELF_BASE + textOffset;
+    address[SEG_DATA] = alignUp(ELF_BASE + dataOffset, ELF_PAGE) + (dataOffset & (ELF_PAGE - 1));
+    address[SEG_BSS] = alignUp(address[SEG_DATA] + code->dataSize, 16);
+    if (!relocateMachineCode(code, address)) {
+        fprintf(stderr, "Errore: indirizzo non rappresentabile in 32 bit\n");
+        return 0;
+    }
+
+    Elf64_Ehdr header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_EXEC;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_entry = address[SEG_TEXT] + code->entry;
+    header.e_phoff = sizeof(Elf64_Ehdr);
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_phentsize = sizeof(Elf64_Phdr);
+    header.e_phnum = 2;
+
+    // Le sezioni servono solo agli strumenti (objdump, gdb): il kernel usa i segmenti
+    static const char sectionNames[] = "\0.text\0.data\0.bss\0.shstrtab";
+    unsigned long long namesOffset = dataOffset + code->dataSize;
+    unsigned long long sectionsOffset = alignUp(namesOffset + sizeof(sectionNames), 8);
+    Elf64_Shdr sections[5];
+    memset(sections, 0, sizeof(sections));
+    sections[1].sh_name = 1;
+    sections[1].sh_type = SHT_PROGBITS;
+    sections[1].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    sections[1].sh_addr = address[SEG_TEXT];
+    sections[1].sh_offset = textOffset;
+    sections[1].sh_size = code->textSize;
+    sections[1].sh_addralign = 64;
+    sections[2].sh_name = 7;
+    sections[2].sh_type = SHT_PROGBITS;
+    sections[2].sh_flags = SHF_ALLOC | SHF_WRITE;
+    sections[2].sh_addr = address[SEG_DATA];
+    sections[2].sh_offset = dataOffset;
+    sections[2].sh_size = code->dataSize;
+    sections[2].sh_addralign = 16;
+    sections[3].sh_name = 13;
+    sections[3].sh_type = SHT_NOBITS;
+    sections[3].sh_flags = SHF_ALLOC | SHF_WRITE;
+    sections[3].sh_addr = address[SEG_BSS];
+    sections[3].sh_offset = namesOffset;
+    sections[3].sh_size = code->bssSize;
+    sections[3].sh_addralign = 16;
+    sections[4].sh_name = 18;
+    sections[4].sh_type = SHT_STRTAB;
+    sections[4].sh_offset = namesOffset;
+    sections[4].sh_size = sizeof(sectionNames);
+    sections[4].sh_addralign = 1;
+    header.e_shoff = sectionsOffset;
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = 5;
+    header.e_shstrndx = 4;
+
+    Elf64_Phdr segments[2];
+    memset(segments, 0, sizeof(segments));
+    segments[0].p_type = PT_LOAD;
+    segments[0].p_flags = PF_R | PF_X;
+    segments[0].p_offset = 0;
+    segments[0].p_vaddr = segments[0].p_paddr = ELF_BASE;
+    segments[0].p_filesz = segments[0].p_memsz = textOffset + code->textSize;
+    segments[0].p_align = ELF_PAGE;
+    // .bss segue .data nello stesso segmento: il kernel azzera la parte oltre il file
+    segments[1].p_type = PT_LOAD;
+    segments[1].p_flags = PF_R | PF_W;
+    segments[1].p_offset = dataOffset;
+    segments[1].p_vaddr = segments[1].p_paddr = address[SEG_DATA];
+    segments[1].p_filesz = code->dataSize;
+    segments[1].p_memsz = address[SEG_BSS] + code->bssSize - address[SEG_DATA];
+    segments[1].p_align = ELF_PAGE;
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror("Errore nell'aprire il file eseguibile");
+        return 0;
+    }
+    static const unsigned char padding[64];
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(segments, sizeof(segments), 1, out);
+    fwrite(padding, 1, textOffset - headersSize, out);
+    fwrite(code->text, 1, code->textSize, out);
+    fwrite(padding, 1, dataOffset - (textOffset + code->textSize), out);
+    fwrite(code->data, 1, code->dataSize, out);
+    fwrite(sectionNames, 1, sizeof(sectionNames), out);
+    fwrite(padding, 1, sectionsOffset - (namesOffset + sizeof(sectionNames)), out);
+    fwrite(sections, sizeof(sections), 1, out);
+    if (fclose(out) != 0) {
+        perror("Errore nello scrivere il file eseguibile");
+        return 0;
+    }
+    chmod(path, 0755);
+    return 1;
+}
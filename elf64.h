@@ -0,0 +1,11 @@
+#ifndef ELF64_H
+#define ELF64_H
+
+#include "x86.h"
+
+// Eseguibile ELF64 statico per Linux x86-64, senza assembler né linker:
+// un segmento R+X con intestazioni e codice, uno RW con .data e .bss.
+// Riloca il codice agli indirizzi scelti; restituisce 0 in caso di errore.
+int writeElfExecutable(MachineCode *code, const char *path);
+
+#endif // ELF64_H
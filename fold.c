@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "fold.h"
+#include "intern.h"
+#include "symbol_table.h"
+
+// Valori costanti noti delle variabili nel punto corrente del programma:
+// i rami degli IF e i corpi dei LOOP aprono uno scope della tabella, così
+// all'uscita le loro definizioni si scartano senza copiare l'ambiente
+typedef SymbolTable ConstEnv;
+
+// Variabili che una qualsiasi funzione può modificare: una chiamata le invalida.
+// modifiedByCalls è indicizzato per ID di simbolo, modifiedList li elenca.
+static _Thread_local char *modifiedByCalls = NULL;
+static _Thread_local int *modifiedList = NULL;
+static _Thread_local int modifiedCount = 0;
+
+// Nodi tolti dall'albero, contati dove vengono sostituiti o scartati: i nodi
+// creati al loro posto (letterali, confronti "!= 0") non si sottraggono
+static _Thread_local int removedNodes = 0;
+
+static ASTNode* foldStatement(ASTNode *node, ConstEnv *env);
+
+static int isIntegerLiteral(ASTNode *node) {
+    return node->type == AST_LITERAL;
+}
+
+// ---------- AMBIENTE DELLE COSTANTI ----------
+
+static Symbol* findConst(ConstEnv *env, int symbol) {
+    Symbol *sym = lookupSymbol(env, symbol);
+    return sym && sym->kind == SYM_CONST ? sym : NULL;
+}
+
+static void bindConst(ConstEnv *env, int symbol, long long value) {
+    insertSymbol(env, symbol, SYM_CONST, value);
+}
+
+static void killConst(ConstEnv *env, int symbol) {
+    // Un nome senza definizioni visibili è già ignoto
+    if (findConst(env, symbol)) insertSymbol(env, symbol, SYM_UNKNOWN, 0);
+}
+
+static void killModifiedByCalls(ConstEnv *env) {
+    for (int i = 0; i < modifiedCount; i++) killConst(env, modifiedList[i]);
+}
+
+// Definizioni dello scope più interno, copiate prima di chiuderlo
+static Symbol* copyScope(ConstEnv *env, int *count) {
+    int start = env->scopeStart[env->depth - 1];
+    *count = env->count - start;
+    Symbol *copy = malloc(sizeof(Symbol) * (*count + 1));
+    memcpy(copy, env->entries + start, sizeof(Symbol) * *count);
+    return copy;
+}
+
+// ---------- ANALISI PRELIMINARI ----------
+
+static int containsCall(ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == AST_CALL) return 1;
+    for (int i = 0; i < node->childCount; i++) {
+        if (containsCall(node->children[i])) return 1;
+    }
+    return 0;
+}
+
+static void collectModified(ASTNode *node, int inFunction) {
+    if (!node) return;
+    if (node->type == AST_FUNCTION_DEF) inFunction = 1;
+    int symbol = assignedSymbol(node);
+    if (inFunction && symbol >= 0 && !modifiedByCalls[symbol]) {
+        modifiedByCalls[symbol] = 1;
+        modifiedList[modifiedCount++] = symbol;
+    }
+    for (int i = 0; i < node->childCount; i++) collectModified(node->children[i], inFunction);
+}
+
+// Variabili assegnate nel corpo di un LOOP: il back-edge invalida le loro costanti
+static void killAssigned(ConstEnv *env, ASTNode *node) {
+    if (!node || node->type == AST_FUNCTION_DEF) return;
+    int symbol = assignedSymbol(node);
+    if (symbol >= 0) killConst(env, symbol);
+    if (node->type == AST_CALL) killModifiedByCalls(env);
+    for (int i = 0; i < node->childCount; i++) killAssigned(env, node->children[i]);
+}
+
+// ---------- FOLDING DELLE ESPRESSIONI ----------
+
+static int evalBinary(const char *op, long long a, long long b, long long *result) {
+    unsigned long long ua = (unsigned long long) a, ub = (unsigned long long) b;
+    // Stessa semantica del codice generato: aritmetica a 64 bit con wrap-around
+    // e divisione con segno troncata verso zero (idiv)
+    if (strcmp(op, "+") == 0) *result = (long long) (ua + ub);
+    else if (strcmp(op, "-") == 0) *result = (long long) (ua - ub);
+    else if (strcmp(op, "*") == 0) *result = (long long) (ua * ub);
+    else if (strcmp(op, "/") == 0 || strcmp(op, "%") == 0) {
+        // Lo zero resta un errore a runtime; LLONG_MIN / -1 non è definito in C
+        if (b == 0 || (a == LLONG_MIN && b == -1)) return 0;
+        *result = op[0] == '/' ? a / b : a % b;
+    }
+    else if (strcmp(op, "==") == 0) *result = a == b;
+    else if (strcmp(op, "!=") == 0) *result = a != b;
+    else if (strcmp(op, "<") == 0)  *result = a < b;
+    else if (strcmp(op, "<=") == 0) *result = a <= b;
+    else if (strcmp(op, ">") == 0)  *result = a > b;
+    else if (strcmp(op, ">=") == 0) *result = a >= b;
+    else return 0;
+    return 1;
+}
+
+static int isComparisonOp(const char *op) {
+    return strcmp(op, "==") == 0 || strcmp(op, "!=") == 0 || strcmp(op, "<") == 0 ||
+           strcmp(op, "<=") == 0 || strcmp(op, ">") == 0 || strcmp(op, ">=") == 0;
+}
+
+static int isLogicOp(const char *op) {
+    return strcmp(op, "&&") == 0 || strcmp(op, "||") == 0;
+}
+
+// Espressione che vale già 0 o 1
+static int isBoolean(ASTNode *node) {
+    if (node->type != AST_BINARY_EXPR) return 0;
+    if (node->childCount == 1) return strcmp(node->text, "!") == 0;
+    return isComparisonOp(node->text) || isLogicOp(node->text);
+}
+
+static ASTNode* truthValue(ASTNode *node) {
+    if (isBoolean(node)) return node;
+    ASTNode *test = createTextNode(AST_BINARY_EXPR, "!=", 2, 2);
+    test->children[0] = node;
+    test->children[1] = createNumberNode(0);
+    return test;
+}
+
+// Il letterale che prende il posto di node e dei suoi operandi
+static ASTNode* replaceWithNumber(ASTNode *node, long long value) {
+    removedNodes += countNodes(node);
+    return createNumberNode(value);
+}
+
+// Resta solo l'operando kept: spariscono l'operatore e l'altro operando
+static ASTNode* keepOperand(ASTNode *node, ASTNode *kept) {
+    ASTNode *dropped = node->children[0] == kept ? node->children[1] : node->children[0];
+    removedNodes += 1 + countNodes(dropped);
+    return truthValue(kept);
+}
+
+// Senza chiamate né divisioni (che possono fallire): si può non valutarla
+static int isPure(ASTNode *node) {
+    if (node->type == AST_CALL) return 0;
+    if (node->type == AST_BINARY_EXPR && node->childCount == 2 &&
+        (strcmp(node->text, "/") == 0 || strcmp(node->text, "%") == 0)) return 0;
+    for (int i = 0; i < node->childCount; i++) {
+        if (!isPure(node->children[i])) return 0;
+    }
+    return 1;
+}
+
+// && e || con un operando noto. La destra può sparire perché non sarebbe
+// valutata; la sinistra si valuta sempre, quindi sparisce solo se è pura.
+static ASTNode* foldLogic(ASTNode *node) {
+    int isAnd = node->text[0] == '&';
+    ASTNode *left = node->children[0];
+    ASTNode *right = node->children[1];
+    if (isIntegerLiteral(left)) {
+        if ((left->number != 0) != isAnd) return replaceWithNumber(node, !isAnd);
+        return isIntegerLiteral(right) ? replaceWithNumber(node, right->number != 0) : keepOperand(node, right);
+    }
+    if (isIntegerLiteral(right)) {
+        if ((right->number != 0) == isAnd) return keepOperand(node, left);
+        if (isPure(left)) return replaceWithNumber(node, !isAnd);
+    }
+    return node;
+}
+
+// Restituisce il nodo che sostituisce l'espressione (eventualmente lo stesso).
+// Con una chiamata nell'espressione non si propagano le variabili che la
+// chiamata potrebbe modificare prima della lettura.
+static ASTNode* foldExpr(ASTNode *node, ConstEnv *env, int hasCall) {
+    if (!node) return NULL;
+    switch (node->type) {
+        case AST_IDENTIFIER: {
+            Symbol *b = findConst(env, node->symbol);
+            if (!b || (hasCall && modifiedByCalls[node->symbol])) return node;
+            return replaceWithNumber(node, b->value);
+        }
+        case AST_BINARY_EXPR: {
+            for (int i = 0; i < node->childCount; i++) {
+                node->children[i] = foldExpr(node->children[i], env, hasCall);
+            }
+            long long result;
+            if (node->childCount == 1 && strcmp(node->text, "-u") == 0) {
+                if (!isIntegerLiteral(node->children[0])) return node;
+                result = (long long) (0ULL - (unsigned long long) node->children[0]->number);
+            } else if (node->childCount == 1 && strcmp(node->text, "!") == 0) {
+                if (!isIntegerLiteral(node->children[0])) return node;
+                result = node->children[0]->number == 0;
+            } else if (node->childCount == 2 && isLogicOp(node->text)) {
+                return foldLogic(node);
+            } else if (node->childCount == 2 &&
+                       isIntegerLiteral(node->children[0]) && isIntegerLiteral(node->children[1])) {
+                if (!evalBinary(node->text, node->children[0]->number,
+                                node->children[1]->number, &result)) return node;
+            } else {
+                return node;
+            }
+            return replaceWithNumber(node, result);
+        }
+        default:
+            return node;
+    }
+}
+
+// ---------- PROPAGAZIONE NEGLI STATEMENT ----------
+
+static void foldAssignment(ASTNode *node, ConstEnv *env, int exprIndex) {
+    int symbol = assignedSymbol(node);
+    if (node->childCount <= exprIndex) {
+        bindConst(env, symbol, 0);
+        return;
+    }
+    ASTNode *expr = node->children[exprIndex];
+    int hasCall = containsCall(expr);
+    expr = foldExpr(expr, env, hasCall);
+    node->children[exprIndex] = expr;
+    if (hasCall) killModifiedByCalls(env);
+    if (isIntegerLiteral(expr)) bindConst(env, symbol, expr->number);
+    else killConst(env, symbol);
+}
+
+static ASTNode* foldIf(ASTNode *node, ConstEnv *env) {
+    int hasCall = containsCall(node->children[0]);
+    node->children[0] = foldExpr(node->children[0], env, hasCall);
+    if (hasCall) killModifiedByCalls(env);
+
+    ASTNode *cond = node->children[0];
+    if (isIntegerLiteral(cond)) {
+        // Condizione nota: resta solo il ramo eseguito
+        int taken = cond->number != 0 ? 1 : 2;
+        ASTNode *branch = taken < node->childCount ? node->children[taken] : NULL;
+        ASTNode *skipped = 3 - taken < node->childCount ? node->children[3 - taken] : NULL;
+        removedNodes += 1 + countNodes(cond) + countNodes(skipped);
+        if (!branch) branch = createASTNode(AST_BLOCK, 0);
+        return foldStatement(branch, env);
+    }
+
+    pushScope(env);
+    node->children[1] = foldStatement(node->children[1], env);
+    int thenCount;
+    Symbol *thenDefs = copyScope(env, &thenCount);
+    popScope(env);
+
+    pushScope(env);
+    if (node->childCount > 2) {
+        node->children[2] = foldStatement(node->children[2], env);
+    }
+    int elseCount;
+    Symbol *elseDefs = copyScope(env, &elseCount);
+
+    // Al punto di confluenza restano solo le costanti uguali su entrambi i
+    // rami. Con lo scope ELSE ancora aperto la lookup dà il valore del ramo
+    // ELSE (o quello di prima dell'IF); per un nome definito solo nell'ELSE il
+    // ramo THEN ha lasciato il valore esterno, che la definizione nasconde.
+    for (int i = 0; i < thenCount; i++) {
+        Symbol *other = findConst(env, thenDefs[i].symbol);
+        if (thenDefs[i].kind != SYM_CONST || !other || other->value != thenDefs[i].value) {
+            thenDefs[i].kind = SYM_UNKNOWN;
+        }
+    }
+    for (int i = 0; i < elseCount; i++) {
+        Symbol *outer = elseDefs[i].shadowed >= 0 ? &env->entries[elseDefs[i].shadowed] : NULL;
+        if (elseDefs[i].kind != SYM_CONST || !outer ||
+            outer->kind != SYM_CONST || outer->value != elseDefs[i].value) {
+            elseDefs[i].kind = SYM_UNKNOWN;
+        }
+    }
+    popScope(env);
+
+    // Prima l'ELSE: per i nomi definiti in entrambi i rami decide il THEN
+    for (int i = 0; i < elseCount; i++) {
+        if (elseDefs[i].kind != SYM_CONST) killConst(env, elseDefs[i].symbol);
+    }
+    for (int i = 0; i < thenCount; i++) {
+        if (thenDefs[i].kind == SYM_CONST) bindConst(env, thenDefs[i].symbol, thenDefs[i].value);
+        else killConst(env, thenDefs[i].symbol);
+    }
+    free(thenDefs);
+    free(elseDefs);
+    return node;
+}
+
+static ASTNode* foldLoop(ASTNode *node, ConstEnv *env) {
+    killAssigned(env, node);
+
+    int hasCall = containsCall(node->children[0]);
+    node->children[0] = foldExpr(node->children[0], env, hasCall);
+    if (hasCall) killModifiedByCalls(env);
+
+    ASTNode *cond = node->children[0];
+    if (isIntegerLiteral(cond) && cond->number == 0) {
+        // Il corpo non viene mai eseguito
+        removedNodes += countNodes(node);
+        return createASTNode(AST_BLOCK, 0);
+    }
+
+    pushScope(env);
+    node->children[1] = foldStatement(node->children[1], env);
+    popScope(env);
+    return node;
+}
+
+static ASTNode* foldStatement(ASTNode *node, ConstEnv *env) {
+    if (!node) return NULL;
+    switch (node->type) {
+        case AST_PROGRAM:
+        case AST_BLOCK:
+            for (int i = 0; i < node->childCount; i++) {
+                node->children[i] = foldStatement(node->children[i], env);
+            }
+            return node;
+        case AST_VAR_DECL:
+            foldAssignment(node, env, 0);
+            return node;
+        case AST_ASSIGNMENT:
+            foldAssignment(node, env, 1);
+            return node;
+        case AST_IF:
+            return foldIf(node, env);
+        case AST_LOOP:
+            return foldLoop(node, env);
+        case AST_FUNCTION_DEF: {
+            // Una funzione può essere chiamata in qualsiasi stato
+            ConstEnv fnEnv;
+            initSymbolTable(&fnEnv);
+            for (int i = 0; i < node->childCount; i++) {
+                node->children[i] = foldStatement(node->children[i], &fnEnv);
+            }
+            freeSymbolTable(&fnEnv);
+            return node;
+        }
+        case AST_RETURN:
+        case AST_PRINT:
+            if (node->childCount > 0) {
+                int hasCall = containsCall(node->children[0]);
+                node->children[0] = foldExpr(node->children[0], env, hasCall);
+                if (hasCall) killModifiedByCalls(env);
+            }
+            return node;
+        case AST_BREAK:
+            return node;
+        default: {
+            int hasCall = containsCall(node);
+            node = foldExpr(node, env, hasCall);
+            if (hasCall) killModifiedByCalls(env);
+            return node;
+        }
+    }
+}
+
+int foldConstants(ASTNode *root) {
+    removedNodes = 0;
+    modifiedByCalls = calloc(symbolCount() + 1, sizeof(char));
+    modifiedList = malloc(sizeof(int) * (symbolCount() + 1));
+    modifiedCount = 0;
+    collectModified(root, 0);
+
+    ConstEnv env;
+    initSymbolTable(&env);
+    foldStatement(root, &env);
+    freeSymbolTable(&env);
+    free(modifiedByCalls);
+    free(modifiedList);
+
+    return removedNodes;
+}
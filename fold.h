@@ -0,0 +1,13 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "ast.h"
+
+// Constant folding e propagazione delle costanti sull'AST.
+// Le costanti di una variabile valgono fino alla successiva ridefinizione,
+// a un back-edge di LOOP o a una chiamata che può modificarla.
+// Restituisce il numero di nodi rimossi dall'albero: quelli sostituiti da un
+// letterale e quelli dei rami e degli operandi scartati.
+int foldConstants(ASTNode *root);
+
+#endif // FOLD_H
@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+static _Thread_local char **names = NULL;         // per ID: copia del nome terminata da '\0'
+static _Thread_local unsigned *hashes = NULL;     // per ID: hash del nome
+static _Thread_local int count = 0, cap = 0;
+
+static _Thread_local int *slots = NULL;           // indirizzamento aperto: ID + 1, 0 se vuoto
+static _Thread_local int slotCap = 0;
+
+// FNV-1a a 32 bit
+static unsigned hashText(const char *text, int length) {
+    unsigned h = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        h ^= (unsigned char) text[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void growSlots() {
+    int newCap = slotCap ? slotCap * 2 : 256;
+    int *newSlots = calloc(newCap, sizeof(int));
+    for (int id = 0; id < count; id++) {
+        unsigned s = hashes[id] & (newCap - 1);
+        while (newSlots[s]) s = (s + 1) & (newCap - 1);
+        newSlots[s] = id + 1;
+    }
+    free(slots);
+    slots = newSlots;
+    slotCap = newCap;
+}
+
+int internSymbol(const char *text, int length) {
+    // Il carico resta sotto il 50%: le sequenze di probing sono brevi
+    if (2 * (count + 1) > slotCap) growSlots();
+
+    unsigned h = hashText(text, length);
+    unsigned s = h & (slotCap - 1);
+    while (slots[s]) {
+        int id = slots[s] - 1;
+        if (hashes[id] == h && strncmp(names[id], text, length) == 0 && names[id][length] == '\0') {
+            return id;
+        }
+        s = (s + 1) & (slotCap - 1);
+    }
+
+    if (count == cap) {
+        cap = cap ? cap * 2 : 256;
+        names = realloc(names, sizeof(char*) * cap);
+        hashes = realloc(hashes, sizeof(unsigned) * cap);
+    }
+    names[count] = malloc(length + 1);
+    memcpy(names[count], text, length);
+    names[count][length] = '\0';
+    hashes[count] = h;
+    slots[s] = count + 1;
+    return count++;
+}
+
+const char* symbolName(int id) {
+    return names[id];
+}
+
+int symbolCount() {
+    return count;
+}
+
+void freeSymbols() {
+    for (int id = 0; id < count; id++) free(names[id]);
+    free(names);
+    free(hashes);
+    free(slots);
+    names = NULL;
+    hashes = NULL;
+    slots = NULL;
+    count = cap = slotCap = 0;
+}
@@ -0,0 +1,12 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+// Tabella delle stringhe hash-consed: ogni nome distinto riceve un ID intero
+// stabile (0, 1, 2, ...), così i simboli si confrontano come interi.
+// Il testo passato non deve essere terminato da '\0'.
+int internSymbol(const char *text, int length);
+const char* symbolName(int id);
+int symbolCount();
+void freeSymbols();
+
+#endif // INTERN_H
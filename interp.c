@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "interp.h"
+
+// Con GCC e Clang ogni istruzione conserva l'indirizzo del proprio gestore
+// (goto calcolato) e ogni gestore salta direttamente al successivo; con gli
+// altri compilatori si usa uno switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define THREADED_DISPATCH 1
+#endif
+
+#define OUTPUT_BUFFER_SIZE 65536
+#define INITIAL_REGISTERS 4096
+#define INITIAL_FRAMES 256
+#define MAX_CALL_DEPTH (1 << 22)
+
+typedef struct {
+    int returnTo;           // istruzione successiva alla CALL
+    long long regs;         // inizio del frame del chiamante nello stack dei registri
+} Frame;
+
+static _Thread_local char outputBuffer[OUTPUT_BUFFER_SIZE];
+static _Thread_local int outputLength;
+static _Thread_local int lineBuffered;
+
+// ---------- USCITA ----------
+
+static void writeAll(const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(1, data, length);
+        if (written <= 0) return;
+        data += written;
+        length -= (size_t) written;
+    }
+}
+
+static void flushOutput() {
+    writeAll(outputBuffer, (size_t) outputLength);
+    outputLength = 0;
+}
+
+static void writeOutput(const char *data, int length) {
+    if (length > OUTPUT_BUFFER_SIZE - outputLength) {
+        flushOutput();
+        if (length > OUTPUT_BUFFER_SIZE) {
+            writeAll(data, (size_t) length);
+            return;
+        }
+    }
+    memcpy(outputBuffer + outputLength, data, (size_t) length);
+    outputLength += length;
+    if (lineBuffered && memchr(data, '\n', (size_t) length)) flushOutput();
+}
+
+static void printInt(long long value) {
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long) value : (unsigned long long) value;
+    do {
+        *--p = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) *--p = '-';
+    writeOutput(p, (int) (digits + sizeof(digits) - p));
+}
+
+// ---------- ARITMETICA ----------
+
+// Overflow modulare come nel codice nativo, senza comportamento indefinito
+static inline long long add(long long x, long long y) {
+    return (long long) ((unsigned long long) x + (unsigned long long) y);
+}
+
+static inline long long sub(long long x, long long y) {
+    return (long long) ((unsigned long long) x - (unsigned long long) y);
+}
+
+static inline long long mul(long long x, long long y) {
+    return (long long) ((unsigned long long) x * (unsigned long long) y);
+}
+
+static inline long long divide(long long x, long long d) {
+    return d == -1 ? sub(0, x) : x / d;
+}
+
+static inline long long modulo(long long x, long long d) {
+    return d == -1 ? 0 : x % d;
+}
+
+// ---------- ESECUZIONE ----------
+
+int runBytecode(BCProgram *program, int lineBufferedOutput) {
+    lineBuffered = lineBufferedOutput;
+    outputLength = 0;
+    // L'uscita del compilatore va prima di quella del programma
+    fflush(stdout);
+
+    BCInstr *code = program->code;
+    const BCFunction *functions = program->functions;
+    const long long *constants = program->constants;
+
+    long long *G = calloc((size_t) program->globalCount + 1, sizeof(long long));
+    size_t stackSize = INITIAL_REGISTERS;
+    while (stackSize < (size_t) functions[0].frameSize) stackSize *= 2;
+    long long *stack = malloc(sizeof(long long) * stackSize);
+    int frameCap = INITIAL_FRAMES;
+    Frame *frames = malloc(sizeof(Frame) * frameCap);
+    int depth = 0;
+
+    long long *R = stack;
+    BCInstr *pc = code + functions[0].entry;
+    long long result;
+    int status = 0;
+
+#ifdef THREADED_DISPATCH
+#define BC_LABEL(name) &&do_##name,
+    static const void *labels[] = { BC_OPCODES(BC_LABEL) };
+#undef BC_LABEL
+    for (int i = 0; i < program->codeCount; i++) code[i].handler = labels[code[i].op];
+#define CASE(name) do_##name:
+#define DISPATCH() goto *pc->handler
+#else
+#define CASE(name) case BC_##name:
+#define DISPATCH() goto dispatch
+#endif
+#define NEXT() do { pc++; DISPATCH(); } while (0)
+#define JUMP_IF(cond) do { pc = (cond) ? code + pc->b : pc + 1; DISPATCH(); } while (0)
+
+#define BINARY(name, F) \
+    CASE(name) R[pc->a] = F(R[pc->b], R[pc->c]); NEXT(); \
+    CASE(name##K) R[pc->a] = F(R[pc->b], (long long) pc->c); NEXT();
+#define COMPARE(name, OP) \
+    CASE(name) R[pc->a] = R[pc->b] OP R[pc->c]; NEXT(); \
+    CASE(name##K) R[pc->a] = R[pc->b] OP pc->c; NEXT();
+#define COMPARE_BRANCH(name, OP) \
+    CASE(name) JUMP_IF(R[pc->a] OP R[pc->c]); \
+    CASE(name##K) JUMP_IF(R[pc->a] OP pc->c); \
+    CASE(name##GK) JUMP_IF(G[pc->a] OP pc->c); \
+    CASE(name##GG) JUMP_IF(G[pc->a] OP G[pc->c]);
+
+#ifdef THREADED_DISPATCH
+    DISPATCH();
+#else
+dispatch:
+    switch (pc->op) {
+#endif
+    CASE(LOADK) R[pc->a] = pc->c; NEXT();
+    CASE(LOADKL) R[pc->a] = constants[pc->b]; NEXT();
+    CASE(LOADG) R[pc->a] = G[pc->b]; NEXT();
+    CASE(STOREG) G[pc->a] = R[pc->b]; NEXT();
+    CASE(SETGK) G[pc->a] = pc->c; NEXT();
+    CASE(ADDGK) G[pc->a] = add(G[pc->a], pc->c); NEXT();
+
+    BINARY(ADD, add)
+    BINARY(SUB, sub)
+    BINARY(MUL, mul)
+    CASE(DIV)
+        if (R[pc->c] == 0) goto divisionByZero;
+        R[pc->a] = divide(R[pc->b], R[pc->c]);
+        NEXT();
+    CASE(MOD)
+        if (R[pc->c] == 0) goto divisionByZero;
+        R[pc->a] = modulo(R[pc->b], R[pc->c]);
+        NEXT();
+    // Il divisore costante non è mai 0 (compileBytecode)
+    CASE(DIVK) R[pc->a] = divide(R[pc->b], pc->c); NEXT();
+    CASE(MODK) R[pc->a] = modulo(R[pc->b], pc->c); NEXT();
+    COMPARE(EQ, ==)
+    COMPARE(NE, !=)
+    COMPARE(LT, <)
+    COMPARE(LE, <=)
+    COMPARE(GT, >)
+    COMPARE(GE, >=)
+    CASE(NEG) R[pc->a] = sub(0, R[pc->b]); NEXT();
+
+    CASE(JMP) pc = code + pc->b; DISPATCH();
+    CASE(JZ) JUMP_IF(R[pc->a] == 0);
+    CASE(JNZ) JUMP_IF(R[pc->a] != 0);
+    COMPARE_BRANCH(JEQ, ==)
+    COMPARE_BRANCH(JNE, !=)
+    COMPARE_BRANCH(JLT, <)
+    COMPARE_BRANCH(JLE, <=)
+    COMPARE_BRANCH(JGT, >)
+    COMPARE_BRANCH(JGE, >=)
+
+    CASE(CALL) {
+        // Il frame del chiamato segue la destinazione: al ritorno il
+        // risultato va nel suo R[-1]
+        const BCFunction *callee = &functions[pc->b];
+        long long callerRegs = R - stack;
+        long long offset = callerRegs + pc->a + 1;
+        if ((size_t) (offset + callee->frameSize) > stackSize) {
+            while ((size_t) (offset + callee->frameSize) > stackSize) stackSize *= 2;
+            stack = realloc(stack, sizeof(long long) * stackSize);
+        }
+        if (depth == frameCap) {
+            if (depth == MAX_CALL_DEPTH) {
+                flushOutput();
+                fprintf(stderr, "Errore dell'interprete: troppe chiamate annidate\n");
+                status = -1;
+                goto done;
+            }
+            frameCap *= 2;
+            frames = realloc(frames, sizeof(Frame) * frameCap);
+        }
+        frames[depth].returnTo = (int) (pc + 1 - code);
+        frames[depth].regs = callerRegs;
+        depth++;
+        R = stack + offset;
+        pc = code + callee->entry;
+        DISPATCH();
+    }
+    CASE(RET) result = R[pc->a]; goto returnResult;
+    CASE(RET0) result = 0; goto returnResult;
+
+    CASE(PRINTI) printInt(R[pc->a]); NEXT();
+    CASE(PRINTS) writeOutput(program->strings[pc->b], program->stringLengths[pc->b]); NEXT();
+    CASE(HALT) goto done;
+#ifndef THREADED_DISPATCH
+        default:
+            goto done;
+    }
+#endif
+
+returnResult:
+    R[-1] = result;
+    depth--;
+    R = stack + frames[depth].regs;
+    pc = code + frames[depth].returnTo;
+    DISPATCH();
+
+divisionByZero: {
+        // L'uscita già accumulata va scritta prima del messaggio
+        static const char message[] = "Division by zero error\n";
+        flushOutput();
+        writeAll(message, sizeof(message) - 1);
+        status = 1;
+    }
+
+done:
+    flushOutput();
+    free(frames);
+    free(stack);
+    free(G);
+    return status;
+
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+#undef JUMP_IF
+#undef BINARY
+#undef COMPARE
+#undef COMPARE_BRANCH
+}
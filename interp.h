@@ -0,0 +1,15 @@
+#ifndef INTERP_H
+#define INTERP_H
+
+#include "bytecode.h"
+
+// Esecuzione del bytecode (--interp), senza generare codice macchina. Stessa
+// uscita e stesso codice di uscita del programma compilato: output in un
+// buffer da 64 KiB (svuotato a ogni a capo con lineBufferedOutput), divisione
+// per zero con messaggio su stdout e codice 1. Le operazioni sono a 64 bit
+// con overflow modulare; il minimo diviso -1 dà il minimo, dove l'idiv del
+// codice nativo solleverebbe SIGFPE. Restituisce il codice di uscita, -1 se
+// il programma supera il limite di chiamate annidate.
+int runBytecode(BCProgram *program, int lineBufferedOutput);
+
+#endif // INTERP_H
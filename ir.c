@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ir.h"
+#include "intern.h"
+
+// ---------- COSTRUZIONE ----------
+
+IRModule* createIRModule() {
+    IRModule *module = calloc(1, sizeof(IRModule));
+    return module;
+}
+
+static char* copyString(const char *s) {
+    char *copy = malloc(strlen(s) + 1);
+    strcpy(copy, s);
+    return copy;
+}
+
+IRFunction* addIRFunction(IRModule *module, const char *name) {
+    if (module->functionCount == module->functionCap) {
+        module->functionCap = module->functionCap ? module->functionCap * 2 : 8;
+        module->functions = realloc(module->functions, sizeof(IRFunction*) * module->functionCap);
+    }
+    IRFunction *fn = calloc(1, sizeof(IRFunction));
+    fn->name = copyString(name);
+    module->functions[module->functionCount++] = fn;
+    return fn;
+}
+
+// I nomi arrivano già deduplicati dagli ID dei simboli
+int addGlobal(IRModule *module, const char *name) {
+    if (module->globalCount == module->globalCap) {
+        module->globalCap = module->globalCap ? module->globalCap * 2 : 16;
+        module->globals = realloc(module->globals, sizeof(char*) * module->globalCap);
+    }
+    module->globals[module->globalCount] = copyString(name);
+    return module->globalCount++;
+}
+
+// Il testo passa dalla tabella di interning: stringhe uguali hanno lo stesso ID
+int internString(IRModule *module, const char *text) {
+    int id = internSymbol(text, (int) strlen(text));
+    if (id >= module->stringOfSymbolCap) {
+        int oldCap = module->stringOfSymbolCap;
+        module->stringOfSymbolCap = id * 2 + 16;
+        module->stringOfSymbol = realloc(module->stringOfSymbol, sizeof(int) * module->stringOfSymbolCap);
+        memset(module->stringOfSymbol + oldCap, -1, sizeof(int) * (module->stringOfSymbolCap - oldCap));
+    }
+    if (module->stringOfSymbol[id] >= 0) return module->stringOfSymbol[id];
+    module->stringOfSymbol[id] = module->stringCount;
+    if (module->stringCount == module->stringCap) {
+        module->stringCap = module->stringCap ? module->stringCap * 2 : 16;
+        module->strings = realloc(module->strings, sizeof(char*) * module->stringCap);
+    }
+    module->strings[module->stringCount] = copyString(text);
+    return module->stringCount++;
+}
+
+IRBlock* newIRBlock(IRFunction *fn) {
+    if (fn->blockCount == fn->blockCap) {
+        fn->blockCap = fn->blockCap ? fn->blockCap * 2 : 16;
+        fn->blocks = realloc(fn->blocks, sizeof(IRBlock*) * fn->blockCap);
+    }
+    IRBlock *block = calloc(1, sizeof(IRBlock));
+    block->id = fn->nextBlockId++;
+    block->rpoIndex = -1;
+    fn->blocks[fn->blockCount++] = block;
+    return block;
+}
+
+int newVreg(IRFunction *fn) {
+    return fn->vregCount++;
+}
+
+IRInstr* createIRInstr(IROp op) {
+    IRInstr *instr = calloc(1, sizeof(IRInstr));
+    instr->op = op;
+    instr->dst = -1;
+    instr->sym = -1;
+    instr->phiVar = -1;
+    return instr;
+}
+
+void appendIRInstr(IRBlock *block, IRInstr *instr) {
+    instr->block = block;
+    instr->prev = block->last;
+    instr->next = NULL;
+    if (block->last) block->last->next = instr;
+    else block->first = instr;
+    block->last = instr;
+}
+
+void insertIRInstrBefore(IRInstr *pos, IRInstr *instr) {
+    IRBlock *block = pos->block;
+    instr->block = block;
+    instr->next = pos;
+    instr->prev = pos->prev;
+    if (pos->prev) pos->prev->next = instr;
+    else block->first = instr;
+    pos->prev = instr;
+}
+
+void removeIRInstr(IRInstr *instr) {
+    IRBlock *block = instr->block;
+    if (instr->prev) instr->prev->next = instr->next;
+    else block->first = instr->next;
+    if (instr->next) instr->next->prev = instr->prev;
+    else block->last = instr->prev;
+    free(instr->phiArgs);
+    free(instr);
+}
+
+void moveIRInstrBefore(IRInstr *instr, IRInstr *pos) {
+    IRBlock *block = instr->block;
+    if (instr->prev) instr->prev->next = instr->next;
+    else block->first = instr->next;
+    if (instr->next) instr->next->prev = instr->prev;
+    else block->last = instr->prev;
+    insertIRInstrBefore(pos, instr);
+}
+
+static void addPred(IRBlock *block, IRBlock *pred) {
+    if (block->predCount == block->predCap) {
+        block->predCap = block->predCap ? block->predCap * 2 : 4;
+        block->preds = realloc(block->preds, sizeof(IRBlock*) * block->predCap);
+    }
+    block->preds[block->predCount++] = pred;
+}
+
+void addIREdge(IRBlock *from, IRBlock *to) {
+    from->succs[from->succCount++] = to;
+    addPred(to, from);
+}
+
+int isTerminator(IROp op) {
+    return op == IR_JMP || op == IR_BR || op == IR_RET;
+}
+
+IRValue irVreg(int vreg) {
+    IRValue v = { IRV_VREG, vreg };
+    return v;
+}
+
+IRValue irImm(long long value) {
+    IRValue v = { IRV_IMM, value };
+    return v;
+}
+
+int sameValue(IRValue a, IRValue b) {
+    return a.kind == b.kind && a.value == b.value;
+}
+
+// ---------- ANALISI DEL CFG ----------
+
+static void removePredAt(IRBlock *block, int index) {
+    for (IRInstr *in = block->first; in && in->op == IR_PHI; in = in->next) {
+        for (int i = index; i < block->predCount - 1; i++) {
+            in->phiArgs[i] = in->phiArgs[i + 1];
+        }
+    }
+    for (int i = index; i < block->predCount - 1; i++) {
+        block->preds[i] = block->preds[i + 1];
+    }
+    block->predCount--;
+}
+
+static void freeIRBlock(IRBlock *block) {
+    IRInstr *in = block->first;
+    while (in) {
+        IRInstr *next = in->next;
+        free(in->phiArgs);
+        free(in);
+        in = next;
+    }
+    free(block->preds);
+    free(block->domChildren);
+    free(block);
+}
+
+static void visitPostorder(IRBlock *block, IRBlock **order, int *count, char *visited) {
+    // Visita iterativa per non esaurire lo stack su CFG molto profondi
+    IRBlock **stack = malloc(sizeof(IRBlock*) * (*count + 1));
+    int *next = malloc(sizeof(int) * (*count + 1));
+    int top = 0;
+    int capacity = *count + 1;
+    *count = 0;
+    stack[0] = block;
+    next[0] = 0;
+    visited[block->id] = 1;
+    while (top >= 0) {
+        IRBlock *b = stack[top];
+        if (next[top] < b->succCount) {
+            // Successori in ordine inverso: in RPO il primo segue subito il blocco
+            IRBlock *s = b->succs[b->succCount - 1 - next[top]++];
+            if (!visited[s->id]) {
+                visited[s->id] = 1;
+                if (top + 1 >= capacity) {
+                    capacity *= 2;
+                    stack = realloc(stack, sizeof(IRBlock*) * capacity);
+                    next = realloc(next, sizeof(int) * capacity);
+                }
+                top++;
+                stack[top] = s;
+                next[top] = 0;
+            }
+        } else {
+            order[(*count)++] = b;
+            top--;
+        }
+    }
+    free(stack);
+    free(next);
+}
+
+void computeCFG(IRFunction *fn) {
+    char *visited = calloc(fn->nextBlockId, 1);
+    IRBlock **post = malloc(sizeof(IRBlock*) * fn->blockCount);
+    int count = fn->blockCount;
+    visitPostorder(fn->blocks[0], post, &count, visited);
+
+    // Scollega ed elimina i blocchi irraggiungibili
+    for (int i = 0; i < fn->blockCount; i++) {
+        IRBlock *b = fn->blocks[i];
+        if (visited[b->id]) continue;
+        for (int s = 0; s < b->succCount; s++) {
+            IRBlock *succ = b->succs[s];
+            for (int p = 0; p < succ->predCount; p++) {
+                if (succ->preds[p] == b) {
+                    removePredAt(succ, p);
+                    break;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < fn->blockCount; i++) {
+        if (!visited[fn->blocks[i]->id]) freeIRBlock(fn->blocks[i]);
+    }
+
+    fn->blockCount = count;
+    for (int i = 0; i < count; i++) {
+        fn->blocks[i] = post[count - 1 - i];
+        fn->blocks[i]->rpoIndex = i;
+    }
+    free(post);
+    free(visited);
+}
+
+static IRBlock* intersect(IRBlock *a, IRBlock *b) {
+    while (a != b) {
+        while (a->rpoIndex > b->rpoIndex) a = a->idom;
+        while (b->rpoIndex > a->rpoIndex) b = b->idom;
+    }
+    return a;
+}
+
+static void addDomChild(IRBlock *parent, IRBlock *child) {
+    if (parent->domChildCount == parent->domChildCap) {
+        parent->domChildCap = parent->domChildCap ? parent->domChildCap * 2 : 4;
+        parent->domChildren = realloc(parent->domChildren, sizeof(IRBlock*) * parent->domChildCap);
+    }
+    parent->domChildren[parent->domChildCount++] = child;
+}
+
+// Algoritmo iterativo di Cooper, Harvey e Kennedy sull'ordine RPO
+void computeDominators(IRFunction *fn) {
+    for (int i = 0; i < fn->blockCount; i++) {
+        fn->blocks[i]->idom = NULL;
+        fn->blocks[i]->domChildCount = 0;
+    }
+    IRBlock *entry = fn->blocks[0];
+    entry->idom = entry;
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < fn->blockCount; i++) {
+            IRBlock *b = fn->blocks[i];
+            IRBlock *newIdom = NULL;
+            for (int p = 0; p < b->predCount; p++) {
+                IRBlock *pred = b->preds[p];
+                if (!pred->idom) continue;
+                newIdom = newIdom ? intersect(pred, newIdom) : pred;
+            }
+            if (newIdom != b->idom) {
+                b->idom = newIdom;
+                changed = 1;
+            }
+        }
+    }
+
+    for (int i = 1; i < fn->blockCount; i++) {
+        addDomChild(fn->blocks[i]->idom, fn->blocks[i]);
+    }
+}
+
+int dominates(IRBlock *a, IRBlock *b) {
+    while (b->rpoIndex > a->rpoIndex) b = b->idom;
+    return a == b;
+}
+
+// Inserisce un blocco vuoto sull'arco from -> succs[succIndex]
+IRBlock* splitEdge(IRFunction *fn, IRBlock *from, int succIndex) {
+    IRBlock *to = from->succs[succIndex];
+    IRBlock *mid = newIRBlock(fn);
+    from->succs[succIndex] = mid;
+    for (int p = 0; p < to->predCount; p++) {
+        if (to->preds[p] == from) {
+            to->preds[p] = mid;
+            break;
+        }
+    }
+    mid->succs[0] = to;
+    mid->succCount = 1;
+    addPred(mid, from);
+    appendIRInstr(mid, createIRInstr(IR_JMP));
+    return mid;
+}
+
+// ---------- DUMP TESTUALE ----------
+
+static const char *opNames[] = {
+    "const", "copy", "load", "store", "add", "sub", "mul", "div", "mod",
+    "neg", "cmp", "phi", "call", "print", "print", "jmp", "br", "ret"
+};
+
+static const char *condNames[] = { "eq", "ne", "lt", "le", "gt", "ge" };
+
+// Le stringhe del modulo sono già decodificate: il dump le riporta con gli escape
+static void printString(const char *s, FILE *out) {
+    fputc('"', out);
+    for (; *s; s++) {
+        switch (*s) {
+            case '\n': fputs("\\n", out); break;
+            case '\t': fputs("\\t", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '"':  fputs("\\\"", out); break;
+            default:   fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void printValue(IRValue v, FILE *out) {
+    if (v.kind == IRV_VREG) fprintf(out, "v%lld", v.value);
+    else if (v.kind == IRV_IMM) fprintf(out, "%lld", v.value);
+}
+
+static void printInstr(IRModule *module, IRInstr *in, FILE *out) {
+    fprintf(out, "    ");
+    if (in->dst >= 0) fprintf(out, "v%d = ", in->dst);
+    fprintf(out, "%s", opNames[in->op]);
+    if (in->op == IR_CMP) fprintf(out, ".%s", condNames[in->cond]);
+
+    switch (in->op) {
+        case IR_LOAD:
+            fprintf(out, " %s", module->globals[in->sym]);
+            break;
+        case IR_STORE:
+            fprintf(out, " %s, ", module->globals[in->sym]);
+            printValue(in->a, out);
+            break;
+        case IR_CALL:
+            fprintf(out, " %s", module->functions[in->sym]->name);
+            break;
+        case IR_PRINT_STR:
+            fprintf(out, " ");
+            printString(module->strings[in->sym], out);
+            break;
+        case IR_PHI:
+            for (int i = 0; i < in->block->predCount; i++) {
+                fprintf(out, "%s [", i ? "," : "");
+                printValue(in->phiArgs[i], out);
+                fprintf(out, ", bb%d]", in->block->preds[i]->id);
+            }
+            break;
+        case IR_JMP:
+            fprintf(out, " bb%d", in->block->succs[0]->id);
+            break;
+        case IR_BR:
+            fprintf(out, " ");
+            printValue(in->a, out);
+            fprintf(out, ", bb%d, bb%d", in->block->succs[0]->id, in->block->succs[1]->id);
+            break;
+        default:
+            if (in->a.kind != IRV_NONE) {
+                fprintf(out, " ");
+                printValue(in->a, out);
+            }
+            if (in->b.kind != IRV_NONE) {
+                fprintf(out, ", ");
+                printValue(in->b, out);
+            }
+            break;
+    }
+    fprintf(out, "\n");
+}
+
+void printIR(IRModule *module, FILE *out) {
+    for (int f = 0; f < module->functionCount; f++) {
+        IRFunction *fn = module->functions[f];
+        fprintf(out, "%sfunction %s\n", f ? "\n" : "", fn->name);
+        for (int i = 0; i < fn->blockCount; i++) {
+            IRBlock *b = fn->blocks[i];
+            fprintf(out, "bb%d:", b->id);
+            if (b->predCount > 0) {
+                fprintf(out, "  ; preds:");
+                for (int p = 0; p < b->predCount; p++) fprintf(out, " bb%d", b->preds[p]->id);
+            }
+            if (b->idom && b->idom != b) fprintf(out, "  idom: bb%d", b->idom->id);
+            fprintf(out, "\n");
+            for (IRInstr *in = b->first; in; in = in->next) printInstr(module, in, out);
+        }
+    }
+}
+
+void freeIRModule(IRModule *module) {
+    if (!module) return;
+    for (int f = 0; f < module->functionCount; f++) {
+        IRFunction *fn = module->functions[f];
+        for (int i = 0; i < fn->blockCount; i++) freeIRBlock(fn->blocks[i]);
+        free(fn->blocks);
+        free(fn->intervals);
+        free(fn->name);
+        free(fn);
+    }
+    for (int i = 0; i < module->globalCount; i++) free(module->globals[i]);
+    for (int i = 0; i < module->stringCount; i++) free(module->strings[i]);
+    free(module->functions);
+    free(module->globals);
+    free(module->strings);
+    free(module->stringOfSymbol);
+    free(module);
+}
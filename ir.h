@@ -0,0 +1,132 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+#include "ast.h"
+#include "regalloc.h"
+
+// Rappresentazione intermedia a tre indirizzi: ogni funzione è un grafo di
+// blocchi base (CFG) che contengono istruzioni su registri virtuali (vreg).
+
+typedef enum {
+    IR_CONST,       // dst = imm
+    IR_COPY,        // dst = a
+    IR_LOAD,        // dst = [globale]
+    IR_STORE,       // [globale] = a
+    IR_ADD,         // dst = a + b
+    IR_SUB,         // dst = a - b
+    IR_MUL,         // dst = a * b
+    IR_DIV,         // dst = a / b (con segno, troncata verso zero)
+    IR_MOD,         // dst = a % b (segno del dividendo)
+    IR_NEG,         // dst = -a
+    IR_CMP,         // dst = a <cond> b
+    IR_PHI,         // dst = phi(un argomento per predecessore)
+    IR_CALL,        // dst = call funzione
+    IR_PRINT_INT,   // print a
+    IR_PRINT_STR,   // print stringa
+    // Terminatori
+    IR_JMP,         // jmp succs[0]
+    IR_BR,          // if a != 0 goto succs[0] else succs[1]
+    IR_RET          // ret [a]
+} IROp;
+
+typedef enum {
+    CC_EQ, CC_NE, CC_LT, CC_LE, CC_GT, CC_GE
+} IRCond;
+
+typedef enum {
+    IRV_NONE,
+    IRV_VREG,
+    IRV_IMM
+} IRValueKind;
+
+typedef struct {
+    IRValueKind kind;
+    long long value;    // numero del vreg o valore immediato
+} IRValue;
+
+struct IRBlock;
+
+typedef struct IRInstr {
+    IROp op;
+    int dst;            // vreg definito, -1 se nessuno
+    IRValue a, b;
+    IRCond cond;
+    int sym;            // globale (LOAD/STORE), funzione (CALL), stringa (PRINT_STR)
+    int phiVar;         // variabile originale di un phi
+    IRValue *phiArgs;   // stesso ordine di block->preds
+    struct IRInstr *prev, *next;
+    struct IRBlock *block;
+} IRInstr;
+
+typedef struct IRBlock {
+    int id;
+    IRInstr *first, *last;
+    struct IRBlock *succs[2];
+    int succCount;
+    struct IRBlock **preds;
+    int predCount, predCap;
+
+    // Analisi (computeCFG / computeDominators)
+    int rpoIndex;                   // -1 se irraggiungibile
+    struct IRBlock *idom;
+    struct IRBlock **domChildren;
+    int domChildCount, domChildCap;
+} IRBlock;
+
+typedef struct IRFunction {
+    char *name;
+    int isMain;
+    ASTNode *body;
+    IRBlock **blocks;               // blocks[0] è l'entry; ordine RPO dopo computeCFG
+    int blockCount, blockCap;
+    int nextBlockId;
+    int vregCount;
+
+    // Allocazione dei registri (allocateRegisters): un intervallo per vreg
+    LiveInterval *intervals;
+    int spillSlots;
+} IRFunction;
+
+typedef struct {
+    IRFunction **functions;         // functions[0] è il programma principale
+    int functionCount, functionCap;
+    char **globals;
+    int globalCount, globalCap;
+    char **strings;
+    int stringCount, stringCap;
+    int *stringOfSymbol;            // indice in strings per ID interned, -1 se assente
+    int stringOfSymbolCap;
+} IRModule;
+
+// Costruzione
+IRModule* createIRModule();
+IRFunction* addIRFunction(IRModule *module, const char *name);
+int addGlobal(IRModule *module, const char *name);
+int internString(IRModule *module, const char *text);
+IRBlock* newIRBlock(IRFunction *fn);
+int newVreg(IRFunction *fn);
+IRInstr* createIRInstr(IROp op);
+void appendIRInstr(IRBlock *block, IRInstr *instr);
+void insertIRInstrBefore(IRInstr *pos, IRInstr *instr);
+void removeIRInstr(IRInstr *instr);
+void moveIRInstrBefore(IRInstr *instr, IRInstr *pos);   // anche in un altro blocco
+void addIREdge(IRBlock *from, IRBlock *to);
+int isTerminator(IROp op);
+
+IRValue irVreg(int vreg);
+IRValue irImm(long long value);
+int sameValue(IRValue a, IRValue b);
+
+// Analisi del CFG
+void computeCFG(IRFunction *fn);            // elimina i blocchi irraggiungibili e ordina in RPO
+void computeDominators(IRFunction *fn);
+int dominates(IRBlock *a, IRBlock *b);
+IRBlock* splitEdge(IRFunction *fn, IRBlock *from, int succIndex);
+
+// Dump testuale (--emit-ir)
+void printIR(IRModule *module, FILE *out);
+
+void freeIRModule(IRModule *module);
+
+#endif // IR_H
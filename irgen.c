@@ -0,0 +1,531 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "irgen.h"
+#include "intern.h"
+#include "context.h"
+
+// Le variabili del linguaggio sono globali. Dentro ogni funzione vengono
+// promosse a vreg: si caricano all'ingresso, si salvano in memoria prima
+// delle chiamate che potrebbero leggerle o scriverle e prima dei RETURN,
+// e si ricaricano dopo le chiamate che potrebbero modificarle.
+
+typedef struct {
+    char *ref;      // globali lette o scritte dal corpo
+    char *mod;      // globali scritte dal corpo
+    char *calls;    // funzioni chiamate dal corpo
+    char *refAll;   // chiusura transitiva sulle chiamate
+    char *modAll;
+} FunctionInfo;
+
+static _Thread_local IRModule *module;
+static _Thread_local FunctionInfo *infos;
+static _Thread_local IRFunction *fn;
+static _Thread_local int fnIndex;
+static _Thread_local IRBlock *cur;
+static _Thread_local int *varVreg;
+
+// Indice della globale e della funzione per ogni ID di simbolo (-1 se assente)
+static _Thread_local int *globalOfSymbol;
+static _Thread_local int *functionOfSymbol;
+
+static _Thread_local IRBlock **breakTargets = NULL;
+static _Thread_local int breakDepth = 0, breakCap = 0;
+
+static void lowerStatement(ASTNode *node);
+static IRValue lowerExpr(ASTNode *node);
+
+static void lowerError(const char *msg, const char *detail) {
+    sourceError(0, 0, "Errore: %s '%s'", msg, detail);
+}
+
+// \n \t \r \\ \" diventano il byte corrispondente; gli altri escape restano
+// invariati. Il risultato non è mai più lungo dell'originale.
+static void decodeEscapes(const char *raw, char *out) {
+    while (*raw) {
+        if (*raw != '\\' || !raw[1]) {
+            *out++ = *raw++;
+            continue;
+        }
+        switch (raw[1]) {
+            case 'n':  *out++ = '\n'; break;
+            case 't':  *out++ = '\t'; break;
+            case 'r':  *out++ = '\r'; break;
+            case '\\': *out++ = '\\'; break;
+            case '"':  *out++ = '"'; break;
+            default:
+                *out++ = raw[0];
+                *out++ = raw[1];
+        }
+        raw += 2;
+    }
+    *out = '\0';
+}
+
+static int fitsImm32(long long v) {
+    return v >= -2147483648LL && v <= 2147483647LL;
+}
+
+// ---------- RACCOLTA DI FUNZIONI, GLOBALI ED EFFETTI ----------
+
+static void collectFunctions(ASTNode *node) {
+    if (!node) return;
+    if (node->type == AST_FUNCTION_DEF) {
+        if (functionOfSymbol[node->symbol] >= 0) {
+            lowerError("funzione definita più volte", symbolName(node->symbol));
+        }
+        functionOfSymbol[node->symbol] = module->functionCount;
+        IRFunction *f = addIRFunction(module, symbolName(node->symbol));
+        f->body = node;
+    }
+    for (int i = 0; i < node->childCount; i++) collectFunctions(node->children[i]);
+}
+
+static void collectGlobals(ASTNode *node) {
+    if (!node) return;
+    if ((node->type == AST_VAR_DECL || node->type == AST_IDENTIFIER) &&
+        globalOfSymbol[node->symbol] < 0) {
+        globalOfSymbol[node->symbol] = addGlobal(module, symbolName(node->symbol));
+    }
+    for (int i = 0; i < node->childCount; i++) collectGlobals(node->children[i]);
+}
+
+// Effetti diretti del corpo di una funzione (le DEFINE annidate sono escluse)
+static void collectEffects(FunctionInfo *info, ASTNode *node, int isRoot) {
+    if (!node) return;
+    if (node->type == AST_FUNCTION_DEF && !isRoot) return;
+    switch (node->type) {
+        case AST_VAR_DECL: {
+            int g = globalOfSymbol[node->symbol];
+            info->ref[g] = info->mod[g] = 1;
+            break;
+        }
+        case AST_ASSIGNMENT: {
+            int g = globalOfSymbol[node->children[0]->symbol];
+            info->ref[g] = info->mod[g] = 1;
+            break;
+        }
+        case AST_IDENTIFIER:
+            info->ref[globalOfSymbol[node->symbol]] = 1;
+            break;
+        case AST_CALL: {
+            int callee = functionOfSymbol[node->symbol];
+            if (callee < 0) lowerError("funzione non definita", symbolName(node->symbol));
+            info->calls[callee] = 1;
+            break;
+        }
+        default:
+            break;
+    }
+    for (int i = 0; i < node->childCount; i++) collectEffects(info, node->children[i], 0);
+}
+
+static void computeEffects() {
+    int n = module->functionCount;
+    int g = module->globalCount;
+    infos = calloc(n, sizeof(FunctionInfo));
+    for (int f = 0; f < n; f++) {
+        infos[f].ref = calloc(g + 1, 1);
+        infos[f].mod = calloc(g + 1, 1);
+        infos[f].calls = calloc(n, 1);
+        collectEffects(&infos[f], module->functions[f]->body, 1);
+        infos[f].refAll = malloc(g + 1);
+        infos[f].modAll = malloc(g + 1);
+        memcpy(infos[f].refAll, infos[f].ref, g + 1);
+        memcpy(infos[f].modAll, infos[f].mod, g + 1);
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int f = 0; f < n; f++) {
+            for (int c = 0; c < n; c++) {
+                if (!infos[f].calls[c]) continue;
+                for (int v = 0; v < g; v++) {
+                    if (infos[c].refAll[v] && !infos[f].refAll[v]) { infos[f].refAll[v] = 1; changed = 1; }
+                    if (infos[c].modAll[v] && !infos[f].modAll[v]) { infos[f].modAll[v] = 1; changed = 1; }
+                }
+            }
+        }
+    }
+}
+
+static void freeEffects() {
+    for (int f = 0; f < module->functionCount; f++) {
+        free(infos[f].ref);
+        free(infos[f].mod);
+        free(infos[f].calls);
+        free(infos[f].refAll);
+        free(infos[f].modAll);
+    }
+    free(infos);
+    infos = NULL;
+}
+
+// ---------- EMISSIONE ----------
+
+static IRInstr* emit(IROp op, int dst, IRValue a, IRValue b) {
+    IRInstr *in = createIRInstr(op);
+    in->dst = dst;
+    in->a = a;
+    in->b = b;
+    appendIRInstr(cur, in);
+    return in;
+}
+
+static IRValue none() {
+    IRValue v = { IRV_NONE, 0 };
+    return v;
+}
+
+static int isTerminated() {
+    return cur->last && isTerminator(cur->last->op);
+}
+
+static void jumpTo(IRBlock *target) {
+    emit(IR_JMP, -1, none(), none());
+    addIREdge(cur, target);
+}
+
+static void branch(IRValue cond, IRBlock *ifTrue, IRBlock *ifFalse) {
+    if (cond.kind == IRV_IMM) {
+        jumpTo(cond.value ? ifTrue : ifFalse);
+        return;
+    }
+    emit(IR_BR, -1, cond, none());
+    addIREdge(cur, ifTrue);
+    addIREdge(cur, ifFalse);
+}
+
+static IRValue asVreg(IRValue v) {
+    if (v.kind == IRV_VREG) return v;
+    int t = newVreg(fn);
+    emit(IR_CONST, t, v, none());
+    return irVreg(t);
+}
+
+static void storeVar(int g) {
+    IRInstr *in = emit(IR_STORE, -1, irVreg(varVreg[g]), none());
+    in->sym = g;
+}
+
+static void loadVar(int g) {
+    IRInstr *in = emit(IR_LOAD, varVreg[g], none(), none());
+    in->sym = g;
+}
+
+static void emitReturn(IRValue value) {
+    if (!fn->isMain) {
+        for (int g = 0; g < module->globalCount; g++) {
+            if (infos[fnIndex].mod[g]) storeVar(g);
+        }
+    }
+    emit(IR_RET, -1, value, none());
+}
+
+// ---------- ESPRESSIONI ----------
+
+static int hasCall(ASTNode *n) {
+    if (n->type == AST_CALL) return 1;
+    for (int i = 0; i < n->childCount; i++) {
+        if (hasCall(n->children[i])) return 1;
+    }
+    return 0;
+}
+
+// Numerazione di Sethi-Ullman: il figlio più esigente viene valutato per primo
+static int suNumber(ASTNode *n, int isRight) {
+    if (n->type == AST_BINARY_EXPR && n->childCount == 1) return suNumber(n->children[0], 0);
+    if (n->type != AST_BINARY_EXPR || n->childCount < 2) return isRight ? 0 : 1;
+    int l = suNumber(n->children[0], 0);
+    int r = suNumber(n->children[1], 1);
+    if (l == r) return l + 1;
+    return l > r ? l : r;
+}
+
+static int binaryOp(const char *op, IRCond *cond) {
+    if (strcmp(op, "+") == 0) return IR_ADD;
+    if (strcmp(op, "-") == 0) return IR_SUB;
+    if (strcmp(op, "*") == 0) return IR_MUL;
+    if (strcmp(op, "/") == 0) return IR_DIV;
+    if (strcmp(op, "%") == 0) return IR_MOD;
+    if (strcmp(op, "==") == 0) { *cond = CC_EQ; return IR_CMP; }
+    if (strcmp(op, "!=") == 0) { *cond = CC_NE; return IR_CMP; }
+    if (strcmp(op, "<") == 0)  { *cond = CC_LT; return IR_CMP; }
+    if (strcmp(op, "<=") == 0) { *cond = CC_LE; return IR_CMP; }
+    if (strcmp(op, ">") == 0)  { *cond = CC_GT; return IR_CMP; }
+    if (strcmp(op, ">=") == 0) { *cond = CC_GE; return IR_CMP; }
+    return -1;
+}
+
+static IRValue lowerCall(ASTNode *node) {
+    int callee = functionOfSymbol[node->symbol];
+    FunctionInfo *self = &infos[fnIndex];
+    FunctionInfo *target = &infos[callee];
+
+    for (int g = 0; g < module->globalCount; g++) {
+        if (self->mod[g] && (target->refAll[g] || target->modAll[g])) storeVar(g);
+    }
+    int dst = newVreg(fn);
+    IRInstr *call = emit(IR_CALL, dst, none(), none());
+    call->sym = callee;
+    for (int g = 0; g < module->globalCount; g++) {
+        if (varVreg[g] >= 0 && target->modAll[g]) loadVar(g);
+    }
+    return irVreg(dst);
+}
+
+static int isLogicNode(ASTNode *node) {
+    if (node->type != AST_BINARY_EXPR) return 0;
+    if (node->childCount == 1) return strcmp(node->text, "!") == 0;
+    return strcmp(node->text, "&&") == 0 || strcmp(node->text, "||") == 0;
+}
+
+// Condizione come flusso di controllo: && e || diventano catene di BR, ogni
+// confronto resta subito prima del proprio BR (fuso con il cmp dal codegen)
+// e la destra si valuta solo sul cammino in cui serve.
+static void lowerCondition(ASTNode *node, IRBlock *ifTrue, IRBlock *ifFalse) {
+    if (!isLogicNode(node)) {
+        branch(lowerExpr(node), ifTrue, ifFalse);
+        return;
+    }
+    if (node->childCount == 1) {
+        lowerCondition(node->children[0], ifFalse, ifTrue);
+        return;
+    }
+    IRBlock *right = newIRBlock(fn);
+    if (node->text[0] == '&') lowerCondition(node->children[0], right, ifFalse);
+    else lowerCondition(node->children[0], ifTrue, right);
+    cur = right;
+    lowerCondition(node->children[1], ifTrue, ifFalse);
+}
+
+// && || ! come valore 0/1: un vreg definito su entrambi i rami, unito da
+// un phi nella costruzione SSA
+static IRValue lowerLogicValue(ASTNode *node) {
+    if (node->childCount == 1) {
+        IRValue a = asVreg(lowerExpr(node->children[0]));
+        int dst = newVreg(fn);
+        IRInstr *in = emit(IR_CMP, dst, a, irImm(0));
+        in->cond = CC_EQ;
+        return irVreg(dst);
+    }
+    IRBlock *ifTrue = newIRBlock(fn);
+    IRBlock *ifFalse = newIRBlock(fn);
+    IRBlock *join = newIRBlock(fn);
+    int result = newVreg(fn);
+    lowerCondition(node, ifTrue, ifFalse);
+    cur = ifTrue;
+    emit(IR_CONST, result, irImm(1), none());
+    jumpTo(join);
+    cur = ifFalse;
+    emit(IR_CONST, result, irImm(0), none());
+    jumpTo(join);
+    cur = join;
+    return irVreg(result);
+}
+
+static IRValue lowerExpr(ASTNode *node) {
+    switch (node->type) {
+        case AST_LITERAL:
+            return irImm(node->number);
+        case AST_STRING:
+            // Le stringhe in un'espressione valgono 0
+            return irImm(0);
+        case AST_IDENTIFIER: {
+            // Copia della variabile: la rinomina SSA la elimina
+            int t = newVreg(fn);
+            emit(IR_COPY, t, irVreg(varVreg[globalOfSymbol[node->symbol]]), none());
+            return irVreg(t);
+        }
+        case AST_CALL:
+            return lowerCall(node);
+        case AST_BINARY_EXPR: {
+            int dst;
+            if (isLogicNode(node)) return lowerLogicValue(node);
+            if (node->childCount == 1) {
+                IRValue a = asVreg(lowerExpr(node->children[0]));
+                dst = newVreg(fn);
+                emit(IR_NEG, dst, a, none());
+                return irVreg(dst);
+            }
+            IRCond cond = CC_EQ;
+            int op = binaryOp(node->text, &cond);
+            if (op < 0) lowerError("operatore non supportato", node->text);
+
+            ASTNode *left = node->children[0];
+            ASTNode *right = node->children[1];
+            IRValue a, b;
+            if (!hasCall(node) && suNumber(right, 1) > suNumber(left, 0)) {
+                b = lowerExpr(right);
+                a = asVreg(lowerExpr(left));
+            } else {
+                a = asVreg(lowerExpr(left));
+                b = lowerExpr(right);
+            }
+            // Gli immediati come secondo operando devono stare in 32 bit
+            if (b.kind == IRV_IMM && !fitsImm32(b.value)) b = asVreg(b);
+
+            dst = newVreg(fn);
+            IRInstr *in = emit((IROp) op, dst, a, b);
+            in->cond = cond;
+            return irVreg(dst);
+        }
+        default:
+            lowerError("espressione non valida", "");
+            return none();
+    }
+}
+
+// ---------- STATEMENT ----------
+
+static void assignVar(int symbol, ASTNode *expr) {
+    IRValue v = lowerExpr(expr);
+    emit(IR_COPY, varVreg[globalOfSymbol[symbol]], v, none());
+}
+
+static void lowerIf(ASTNode *node) {
+    IRBlock *thenBlock = newIRBlock(fn);
+    IRBlock *elseBlock = node->childCount > 2 ? newIRBlock(fn) : NULL;
+    IRBlock *join = newIRBlock(fn);
+
+    lowerCondition(node->children[0], thenBlock, elseBlock ? elseBlock : join);
+    cur = thenBlock;
+    lowerStatement(node->children[1]);
+    if (!isTerminated()) jumpTo(join);
+    if (elseBlock) {
+        cur = elseBlock;
+        lowerStatement(node->children[2]);
+        if (!isTerminated()) jumpTo(join);
+    }
+    cur = join;
+}
+
+// Il ciclo viene ruotato in un do-while protetto: la condizione si valuta una
+// volta prima di entrare e poi in fondo al corpo, così ogni iterazione paga un
+// solo salto condizionato all'indietro invece di jcc in testa + jmp in coda.
+static void lowerLoop(ASTNode *node) {
+    IRBlock *body = newIRBlock(fn);
+    IRBlock *exitBlock = newIRBlock(fn);
+
+    lowerCondition(node->children[0], body, exitBlock);
+
+    if (breakDepth == breakCap) {
+        breakCap = breakCap ? breakCap * 2 : 8;
+        breakTargets = realloc(breakTargets, sizeof(IRBlock*) * breakCap);
+    }
+    breakTargets[breakDepth++] = exitBlock;
+    cur = body;
+    lowerStatement(node->children[1]);
+    if (!isTerminated()) lowerCondition(node->children[0], body, exitBlock);
+    breakDepth--;
+    cur = exitBlock;
+}
+
+static void lowerStatement(ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+        case AST_PROGRAM:
+        case AST_BLOCK:
+            for (int i = 0; i < node->childCount; i++) lowerStatement(node->children[i]);
+            break;
+        case AST_VAR_DECL:
+            if (node->childCount > 0) {
+                assignVar(node->symbol, node->children[0]);
+            } else {
+                emit(IR_COPY, varVreg[globalOfSymbol[node->symbol]], irImm(0), none());
+            }
+            break;
+        case AST_ASSIGNMENT:
+            assignVar(node->children[0]->symbol, node->children[1]);
+            break;
+        case AST_IF:
+            lowerIf(node);
+            break;
+        case AST_LOOP:
+            lowerLoop(node);
+            break;
+        case AST_BREAK:
+            if (breakDepth == 0) lowerError("BREAK fuori da un LOOP in", fn->name);
+            jumpTo(breakTargets[breakDepth - 1]);
+            cur = newIRBlock(fn);
+            break;
+        case AST_RETURN:
+            emitReturn(node->childCount > 0 ? lowerExpr(node->children[0]) : none());
+            cur = newIRBlock(fn);
+            break;
+        case AST_PRINT: {
+            if (node->childCount == 0) break;
+            ASTNode *arg = node->children[0];
+            if (arg->type == AST_STRING) {
+                char *text = malloc(strlen(arg->text) + 1);
+                decodeEscapes(arg->text, text);
+                IRInstr *in = emit(IR_PRINT_STR, -1, none(), none());
+                in->sym = internString(module, text);
+                free(text);
+            } else {
+                emit(IR_PRINT_INT, -1, lowerExpr(arg), none());
+            }
+            break;
+        }
+        case AST_FUNCTION_DEF:
+            // Le funzioni vengono tradotte separatamente
+            break;
+        default:
+            lowerExpr(node);
+            break;
+    }
+}
+
+static void lowerFunction(int index) {
+    fn = module->functions[index];
+    fnIndex = index;
+    breakDepth = 0;
+
+    // Un vreg per ogni globale usata dal corpo
+    for (int g = 0; g < module->globalCount; g++) {
+        varVreg[g] = infos[index].ref[g] ? newVreg(fn) : -1;
+    }
+
+    cur = newIRBlock(fn);
+    for (int g = 0; g < module->globalCount; g++) {
+        if (varVreg[g] < 0) continue;
+        // All'avvio del programma la memoria delle globali è azzerata
+        if (fn->isMain) emit(IR_CONST, varVreg[g], irImm(0), none());
+        else loadVar(g);
+    }
+
+    ASTNode *body = fn->body;
+    if (body->type == AST_FUNCTION_DEF) {
+        for (int i = 0; i < body->childCount; i++) lowerStatement(body->children[i]);
+    } else {
+        lowerStatement(body);
+    }
+    if (!isTerminated()) emitReturn(none());
+
+    computeCFG(fn);
+}
+
+IRModule* lowerProgram(ASTNode *root) {
+    module = createIRModule();
+    IRFunction *main = addIRFunction(module, "_start");
+    main->isMain = 1;
+    main->body = root;
+
+    globalOfSymbol = malloc(sizeof(int) * (symbolCount() + 1));
+    functionOfSymbol = malloc(sizeof(int) * (symbolCount() + 1));
+    for (int i = 0; i < symbolCount(); i++) globalOfSymbol[i] = functionOfSymbol[i] = -1;
+
+    collectFunctions(root);
+    collectGlobals(root);
+    computeEffects();
+
+    varVreg = malloc(sizeof(int) * (module->globalCount + 1));
+    for (int f = 0; f < module->functionCount; f++) lowerFunction(f);
+
+    free(varVreg);
+    free(globalOfSymbol);
+    free(functionOfSymbol);
+    freeEffects();
+    return module;
+}
@@ -0,0 +1,11 @@
+#ifndef IRGEN_H
+#define IRGEN_H
+
+#include "ast.h"
+#include "ir.h"
+
+// Traduce l'AST nel modulo IR: una funzione per ogni DEFINE FUNCTION più
+// il programma principale (_start)
+IRModule* lowerProgram(ASTNode *root);
+
+#endif // IRGEN_H
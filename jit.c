@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "jit.h"
+
+int runMachineCode(MachineCode *code) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t textSize = alignUp((size_t) code->textSize, page);
+    size_t dataSize = alignUp((size_t) code->dataSize, 16);
+    size_t total = textSize + alignUp(dataSize + (size_t) code->bssSize, page);
+
+    // MAP_32BIT: la regione sta nei primi 2 GiB, come l'eseguibile a 0x400000
+    unsigned char *region = mmap(NULL, total, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (region == MAP_FAILED) {
+        perror("Errore nell'allocare la memoria per l'esecuzione");
+        return -1;
+    }
+
+    unsigned long long address[SEG_COUNT];
+    address[SEG_TEXT] = (unsigned long long) (size_t) region;
+    address[SEG_DATA] = address[SEG_TEXT] + textSize;
+    address[SEG_BSS] = address[SEG_DATA] + dataSize;
+    if (!relocateMachineCode(code, address)) {
+        fprintf(stderr, "Errore: indirizzo non rappresentabile in 32 bit\n");
+        munmap(region, total);
+        return -1;
+    }
+    memcpy(region, code->text, code->textSize);
+    memcpy(region + textSize, code->data, code->dataSize);
+
+    // Mai scrivibile ed eseguibile insieme
+    if (mprotect(region, textSize, PROT_READ | PROT_EXEC) != 0) {
+        perror("Errore nel rendere eseguibile il codice");
+        munmap(region, total);
+        return -1;
+    }
+
+    // Il programma scrive direttamente sul descrittore 1
+    fflush(stdout);
+    int (*entry)(void) = (int (*)(void)) (void*) (region + code->entry);
+    int status = entry();
+
+    munmap(region, total);
+    return status;
+}
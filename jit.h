@@ -0,0 +1,13 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "x86.h"
+
+// Esecuzione nel processo del compilatore (--run): il codice va in una regione
+// mmap sotto i 2 GiB (gli indirizzi assoluti sono a 32 bit), scritta RW e poi
+// resa RX; .data e .bss la seguono, RW. Il codice deve essere generato con
+// hostedProgram (codegen.h). Restituisce il codice di uscita del programma,
+// -1 se non è stato possibile eseguirlo.
+int runMachineCode(MachineCode *code);
+
+#endif // JIT_H
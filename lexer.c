@@ -1,9 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdbool.h>
 #include "lexer.h"
+#include "intern.h"
+#include "scan.h"
 
 const char *tokenNames[] = {
     "VAR", "INT", "FLOAT", "STRING", "BOOL",
@@ -16,120 +17,224 @@ const char *tokenNames[] = {
     "UNKNOWN", "ERROR", "EOF"
 };
 
-Token tokens[MAX_TOKENS];
-int tokenCount = 0;
-int currentLine = 1;
-int currentPos = 1;
+static _Thread_local const char *source = NULL;
+static _Thread_local const char *cursor = NULL;      // prossimo carattere da analizzare
+static _Thread_local int currentLine = 1;
+static _Thread_local int currentPos = 1;
 
-static bool isValidIdentifierStart(char c) {
-    return (isalpha(c) || c == '_');
+// Buffer circolare dei token già prodotti ma non ancora consumati
+static _Thread_local Token window[TOKEN_WINDOW];
+static _Thread_local int windowHead = 0;
+static _Thread_local int windowFilled = 0;
+static _Thread_local int tokenCount = 0;          // token prodotti da initLexer()
+static _Thread_local Token *target = NULL;           // token che addToken() deve riempire
+
+// ---------- CLASSI DI CARATTERI ----------
+
+// Una tabella di 256 voci sostituisce isalpha/isdigit: niente dipendenza dal
+// locale e un solo accesso per carattere. Spazi, identificatori e stringhe
+// si attraversano con le funzioni di scan.h.
+enum {
+    CH_ALPHA   = 1,     // lettere ASCII e '_'
+    CH_DIGIT   = 2,
+    CH_OP      = 4,     // caratteri che iniziano un operatore o un simbolo
+};
+
+static _Thread_local unsigned char charClass[256];
+
+static void initCharClasses() {
+    if (charClass['a']) return;
+    initScan();
+    for (int c = 'a'; c <= 'z'; c++) charClass[c] = CH_ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++) charClass[c] = CH_ALPHA;
+    charClass['_'] = CH_ALPHA;
+    for (int c = '0'; c <= '9'; c++) charClass[c] = CH_DIGIT;
+    for (const char *op = "=<>!+-*/%;()&|"; *op; op++) charClass[(unsigned char) *op] = CH_OP;
 }
 
-static bool isValidIdentifierChar(char c) {
-    return (isalnum(c) || c == '_');
+static inline int classOf(char c) {
+    return charClass[(unsigned char) c];
 }
 
-static void addToken(TokenType type, const char *value) {
-    if (tokenCount < MAX_TOKENS) {
-        tokens[tokenCount].type = type;
-        strncpy(tokens[tokenCount].value, value, MAX_TOKEN_LENGTH);
-        tokens[tokenCount].line = currentLine;
-        tokens[tokenCount].position = currentPos;
-        tokenCount++;
-        currentPos += strlen(value);
-    }
+static void addToken(TokenType type, const char *start, int length) {
+    target->type = type;
+    target->offset = (int) (start - source);
+    target->length = length;
+    target->symbol = type == TOKEN_IDENTIFIER ? internSymbol(start, length) : -1;
+    target->line = currentLine;
+    target->position = currentPos;
+    currentPos += length;
 }
 
-static TokenType getKeywordToken(const char *str) {
-    if (strcmp(str, "VAR") == 0) return TOKEN_VAR;
-    if (strcmp(str, "IF") == 0) return TOKEN_IF;
-    if (strcmp(str, "ELSE") == 0) return TOKEN_ELSE;
-    if (strcmp(str, "THEN") == 0) return TOKEN_THEN;
-    if (strcmp(str, "ENDIF") == 0) return TOKEN_ENDIF;
-    if (strcmp(str, "LOOP") == 0) return TOKEN_LOOP;
-    if (strcmp(str, "NEXT") == 0) return TOKEN_NEXT;
-    if (strcmp(str, "DEFINE") == 0) return TOKEN_DEFINE;
-    if (strcmp(str, "FUNCTION") == 0) return TOKEN_FUNCTION;
-    if (strcmp(str, "RETURN") == 0) return TOKEN_RETURN;
-    if (strcmp(str, "ENDDEF") == 0) return TOKEN_ENDDEF;
-    if (strcmp(str, "PRINT") == 0) return TOKEN_PRINT;
-    if (strcmp(str, "BREAK") == 0) return TOKEN_BREAK;
+// ---------- KEYWORD ----------
+
+// Hash perfetto sulle 13 keyword: primo carattere, ultimo carattere e
+// lunghezza le separano tutte in 32 slot. Un identificatore costa un calcolo
+// dell'hash e al più un confronto.
+#define KEYWORD_HASH(s, len) (((unsigned char) (s)[0] + 5 * (unsigned char) (s)[(len) - 1] + 7 * (len)) & 31)
+
+typedef struct {
+    const char *text;
+    int length;
+    TokenType type;
+} Keyword;
+
+static const Keyword keywordTable[32] = {
+    [2]  = { "RETURN",   6, TOKEN_RETURN },
+    [4]  = { "FUNCTION", 8, TOKEN_FUNCTION },
+    [5]  = { "VAR",      3, TOKEN_VAR },
+    [6]  = { "ENDIF",    5, TOKEN_ENDIF },
+    [7]  = { "DEFINE",   6, TOKEN_DEFINE },
+    [13] = { "ENDDEF",   6, TOKEN_ENDDEF },
+    [14] = { "NEXT",     4, TOKEN_NEXT },
+    [21] = { "IF",       2, TOKEN_IF },
+    [22] = { "THEN",     4, TOKEN_THEN },
+    [23] = { "PRINT",    5, TOKEN_PRINT },
+    [24] = { "LOOP",     4, TOKEN_LOOP },
+    [26] = { "ELSE",     4, TOKEN_ELSE },
+    [28] = { "BREAK",    5, TOKEN_BREAK },
+};
+
+static TokenType getKeywordToken(const char *start, int length) {
+    const Keyword *k = &keywordTable[KEYWORD_HASH(start, length)];
+    if (k->length == length && memcmp(start, k->text, length) == 0) return k->type;
     return TOKEN_IDENTIFIER;
 }
 
 static void parseIdentifierOrKeyword(const char **code) {
-    char buffer[MAX_TOKEN_LENGTH] = {0};
-    int i = 0;
-    while (isValidIdentifierChar(**code)) {
-        buffer[i++] = **code;
-        (*code)++;
-    }
-    buffer[i] = '\0';
-    TokenType type = getKeywordToken(buffer);
-    addToken(type, buffer);
+    const char *start = *code;
+    *code = skipIdentChars(*code);
+    int length = (int) (*code - start);
+    addToken(getKeywordToken(start, length), start, length);
 }
 
 static void parseNumber(const char **code) {
-    char buffer[MAX_TOKEN_LENGTH] = {0};
-    int i = 0;
+    const char *start = *code;
     bool isFloat = false;
-    while (isdigit(**code) || (**code == '.' && !isFloat)) {
+    while ((classOf(**code) & CH_DIGIT) || (**code == '.' && !isFloat)) {
         if (**code == '.') isFloat = true;
-        buffer[i++] = **code;
         (*code)++;
     }
-    addToken(isFloat ? TOKEN_FLOAT_NUMBER : TOKEN_INT_NUMBER, buffer);
+    addToken(isFloat ? TOKEN_FLOAT_NUMBER : TOKEN_INT_NUMBER, start, (int) (*code - start));
 }
 
+// Il token copre il contenuto tra le virgolette, escape compresi
 static void parseStringLiteral(const char **code) {
-    char buffer[MAX_TOKEN_LENGTH] = {0};
-    int i = 0;
     (*code)++;
-    while (**code && **code != '"') {
-        buffer[i++] = **code;
+    currentPos++;
+    const char *start = *code;
+    for (;;) {
+        *code = skipStringChars(*code);
+        if (**code != '\\') break;
+        // \" non chiude la stringa: le sequenze di escape restano nel testo del
+        // token e vengono decodificate quando la stringa entra nel modulo IR
+        *code += (*code)[1] ? 2 : 1;
+    }
+    addToken(TOKEN_STRING_LITERAL, start, (int) (*code - start));
+    if (**code == '"') {
         (*code)++;
+        currentPos++;
     }
-    if (**code == '"') (*code)++;
-    addToken(TOKEN_STRING_LITERAL, buffer);
 }
 
-void tokenize(const char *code) {
-    tokenCount = 0;
+// Operatori e simboli: il secondo carattere serve solo per == != <= >= && ||
+static void parseOperator(const char **code) {
+    const char *start = *code;
+    char c = *(*code)++;
+    TokenType type = TOKEN_UNKNOWN;
+    switch (c) {
+        case '=': case '<': case '>': case '!':
+            if (**code == '=') {
+                (*code)++;
+                type = TOKEN_COMPARE_OP;
+            } else if (c == '=') {
+                type = TOKEN_ASSIGN;
+            } else if (c == '!') {
+                type = TOKEN_LOGIC_OP;
+            } else {
+                type = TOKEN_COMPARE_OP;
+            }
+            break;
+        case '&': case '|':
+            // & e | da soli non sono operatori
+            if (**code == c) {
+                (*code)++;
+                type = TOKEN_LOGIC_OP;
+            }
+            break;
+        case '+': case '-': case '*': case '/': case '%':
+            type = TOKEN_ARITH_OP;
+            break;
+        case ';': type = TOKEN_SEMICOLON; break;
+        case '(': type = TOKEN_LPAREN; break;
+        case ')': type = TOKEN_RPAREN; break;
+    }
+    addToken(type, start, (int) (*code - start));
+}
+
+// Produce in *t il prossimo token; a fine sorgente restituisce sempre EOF.
+// La classe del primo carattere significativo sceglie lo stato del DFA.
+static void scanToken(Token *t) {
+    target = t;
+    const char *code = skipSpaces(cursor, &currentLine, &currentPos);
+
+    int cls = classOf(*code);
+    if (cls & CH_ALPHA) {
+        parseIdentifierOrKeyword(&code);
+    } else if (cls & CH_DIGIT) {
+        parseNumber(&code);
+    } else if (cls & CH_OP) {
+        parseOperator(&code);
+    } else if (*code == '"') {
+        parseStringLiteral(&code);
+    } else if (!*code) {
+        addToken(TOKEN_EOF, code, 0);
+    } else {
+        addToken(TOKEN_UNKNOWN, code, 1);
+        code++;
+    }
+    cursor = code;
+}
+
+void initLexer(const char *code) {
+    initCharClasses();
+    source = cursor = code;
     currentLine = 1;
     currentPos = 1;
+    windowHead = windowFilled = 0;
+    tokenCount = 0;
+}
 
-    while (*code) {
-        if (isspace(*code)) {
-            if (*code == '\n') {
-                currentLine++;
-                currentPos = 1;
-            } else currentPos++;
-            code++;
-        } else if (isValidIdentifierStart(*code)) {
-            parseIdentifierOrKeyword(&code);
-        } else if (isdigit(*code)) {
-            parseNumber(&code);
-        } else if (*code == '"') {
-            parseStringLiteral(&code);
-        } else {
-            char op[3] = {0};
-            op[0] = *code++;
-            op[1] = (*code && strchr("=<>!", op[0]) && *code == '=') ? *code++ : '\0';
-            TokenType type = TOKEN_UNKNOWN;
-            if (strcmp(op, "=") == 0) type = TOKEN_ASSIGN;
-            else if (strchr("+-*/%", op[0])) type = TOKEN_ARITH_OP;
-            else if (strchr("<>", op[0])) type = TOKEN_COMPARE_OP;
-            else if (strchr(";()", op[0])) type = (op[0] == ';') ? TOKEN_SEMICOLON : ((op[0] == '(') ? TOKEN_LPAREN : TOKEN_RPAREN);
-            else if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0 || strcmp(op, "<=") == 0 || strcmp(op, ">=") == 0) type = TOKEN_COMPARE_OP;
-            else type = TOKEN_UNKNOWN;
-            addToken(type, op);
-        }
+const Token* peekToken(int k) {
+    while (windowFilled <= k) {
+        scanToken(&window[(windowHead + windowFilled) & (TOKEN_WINDOW - 1)]);
+        windowFilled++;
+        tokenCount++;
     }
-    addToken(TOKEN_EOF, "");
+    return &window[(windowHead + k) & (TOKEN_WINDOW - 1)];
+}
+
+void nextToken() {
+    if (windowFilled == 0) peekToken(0);
+    windowHead = (windowHead + 1) & (TOKEN_WINDOW - 1);
+    windowFilled--;
+}
+
+int scannedTokenCount() {
+    return tokenCount;
+}
+
+const char* tokenText(const Token *t) {
+    return source + t->offset;
 }
 
-void printTokens() {
-    for (int i = 0; i < tokenCount; i++) {
-        printf("[Line %d, Pos %d] %-15s '%s'\n", tokens[i].line, tokens[i].position, tokenNames[tokens[i].type], tokens[i].value);
+void printTokens(FILE *out) {
+    for (;;) {
+        const Token *t = peekToken(0);
+        fprintf(out, "[Line %d, Pos %d] %-15s '%.*s'\n", t->line, t->position,
+               tokenNames[t->type], t->length, tokenText(t));
+        if (t->type == TOKEN_EOF) break;
+        nextToken();
     }
-}
\ No newline at end of file
+    initLexer(source);
+}
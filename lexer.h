@@ -1,10 +1,12 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stdio.h>
 #include <stdbool.h>
 
-#define MAX_TOKENS 1000
-#define MAX_TOKEN_LENGTH 100
+// Finestra di lookahead del parser: i token vengono prodotti su richiesta e
+// solo gli ultimi TOKEN_WINDOW restano in memoria (potenza di 2)
+#define TOKEN_WINDOW 4
 
 typedef enum {
     // Keywords
@@ -22,7 +24,7 @@ typedef enum {
     TOKEN_ASSIGN,         // =
     TOKEN_ARITH_OP,       // + - * /
     TOKEN_COMPARE_OP,     // == != < > <= >=
-    TOKEN_LOGIC_OP,       // && ||
+    TOKEN_LOGIC_OP,       // && || !
     TOKEN_LPAREN,         // (
     TOKEN_RPAREN,         // )
     TOKEN_COMMA,          // ,
@@ -36,20 +38,25 @@ typedef enum {
 
 extern const char *tokenNames[];
 
+// Il testo del token non viene copiato: è il tratto [offset, offset + length)
+// del sorgente passato a initLexer(), che deve restare valido.
 typedef struct {
     TokenType type;
-    char value[MAX_TOKEN_LENGTH];
+    int offset;
+    int length;
+    int symbol;     // ID interned degli identificatori, -1 per gli altri token
     int line;
     int position;
 } Token;
 
-extern Token tokens[MAX_TOKENS];
-extern int tokenCount;
-extern int currentLine;
-extern int currentPos;
-
 // Funzioni pubbliche
-void tokenize(const char *code);
-void printTokens();
+void initLexer(const char *code);
+// Il token k posizioni avanti (0 = corrente), con k < TOKEN_WINDOW. Il
+// puntatore resta valido solo fino alla prossima nextToken().
+const Token* peekToken(int k);
+void nextToken();
+void printTokens(FILE *out);    // stampa tutto lo stream e lo riavvolge
+const char* tokenText(const Token *t);     // inizio del testo (non terminato)
+int scannedTokenCount();    // token prodotti dall'ultima initLexer(), EOF compreso
 
 #endif // LEXER_H
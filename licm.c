@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "licm.h"
+
+static _Thread_local IRFunction *fn;
+static _Thread_local IRInstr **defOf;         // per vreg: l'unica definizione (SSA)
+static _Thread_local char *inLoop;            // per id di blocco
+static _Thread_local char *invariant;         // per vreg, nel ciclo corrente
+static _Thread_local IRBlock **loopBlocks;
+static _Thread_local int loopBlockCount;
+static _Thread_local IRBlock *header, *preheader;
+static _Thread_local int loopHasCall;
+static _Thread_local int *loopStores;         // globali scritte nel ciclo
+static _Thread_local int loopStoreCount;
+static _Thread_local int vregCapacity;        // di defOf e invariant
+static _Thread_local int hoisted;
+static _Thread_local int reduced;
+
+static int isBackEdge(IRBlock *pred, IRBlock *block) {
+    return dominates(block, pred);
+}
+
+static int hasBackEdge(IRBlock *block) {
+    for (int p = 0; p < block->predCount; p++) {
+        if (isBackEdge(block->preds[p], block)) return 1;
+    }
+    return 0;
+}
+
+// L'unico predecessore fuori dal ciclo, NULL se sono più d'uno (un || nella
+// condizione di guardia entra nel corpo da due blocchi)
+static IRBlock* outsidePredecessor(IRBlock *block) {
+    IRBlock *outside = NULL;
+    for (int p = 0; p < block->predCount; p++) {
+        if (isBackEdge(block->preds[p], block)) continue;
+        if (outside) return NULL;
+        outside = block->preds[p];
+    }
+    return outside;
+}
+
+// Dopo la rotazione la guardia ha due successori: l'arco verso il corpo va
+// spezzato per avere un blocco dove mettere il codice spostato
+static int createPreheaders() {
+    int split = 0;
+    int count = fn->blockCount;
+    for (int i = 0; i < count; i++) {
+        IRBlock *block = fn->blocks[i];
+        if (!hasBackEdge(block)) continue;
+        IRBlock *outside = outsidePredecessor(block);
+        if (!outside || outside->succCount == 1) continue;
+        splitEdge(fn, outside, outside->succs[0] == block ? 0 : 1);
+        split = 1;
+    }
+    return split;
+}
+
+static int byRPO(const void *a, const void *b) {
+    return (*(IRBlock* const*) a)->rpoIndex - (*(IRBlock* const*) b)->rpoIndex;
+}
+
+// Il ciclo naturale di header: i blocchi da cui si risale ai back-edge
+static void collectLoop() {
+    memset(inLoop, 0, fn->nextBlockId);
+    loopBlockCount = 0;
+    inLoop[header->id] = 1;
+    loopBlocks[loopBlockCount++] = header;
+    for (int scan = 0; scan < loopBlockCount; scan++) {
+        IRBlock *block = loopBlocks[scan];
+        for (int p = 0; p < block->predCount; p++) {
+            IRBlock *pred = block->preds[p];
+            if (inLoop[pred->id] || (block == header && !isBackEdge(pred, header))) continue;
+            inLoop[pred->id] = 1;
+            loopBlocks[loopBlockCount++] = pred;
+        }
+    }
+    qsort(loopBlocks, loopBlockCount, sizeof(IRBlock*), byRPO);
+
+    loopHasCall = 0;
+    loopStoreCount = 0;
+    for (int i = 0; i < loopBlockCount; i++) {
+        for (IRInstr *in = loopBlocks[i]->first; in; in = in->next) {
+            if (in->op == IR_CALL) loopHasCall = 1;
+            if (in->op == IR_STORE) loopStores[loopStoreCount++] = in->sym;
+        }
+    }
+}
+
+static int definedInLoop(IRValue value) {
+    return value.kind == IRV_VREG && defOf[value.value] && inLoop[defOf[value.value]->block->id];
+}
+
+static int invariantValue(IRValue value) {
+    return !definedInLoop(value) || invariant[value.value];
+}
+
+// Una chiamata può scrivere qualunque globale
+static int globalWritten(int sym) {
+    if (loopHasCall) return 1;
+    for (int i = 0; i < loopStoreCount; i++) {
+        if (loopStores[i] == sym) return 1;
+    }
+    return 0;
+}
+
+static int isInvariant(IRInstr *in) {
+    switch (in->op) {
+        case IR_CONST:
+            return 1;
+        case IR_LOAD:
+            return !globalWritten(in->sym);
+        case IR_COPY: case IR_NEG:
+            return invariantValue(in->a);
+        case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD: case IR_CMP:
+            return invariantValue(in->a) && invariantValue(in->b);
+        default:
+            return 0;
+    }
+}
+
+// Costanti e copie da sole non valgono un registro occupato per tutto il
+// ciclo: si spostano solo insieme a un calcolo che le usa. Un confronto che
+// decide il salto seguente resta dov'è perché il codegen lo fonde col jcc.
+static int worthHoisting(IRInstr *in) {
+    switch (in->op) {
+        case IR_ADD: case IR_SUB: case IR_MUL: case IR_NEG:
+        case IR_DIV: case IR_MOD: case IR_LOAD:
+            return 1;
+        case IR_CMP:
+            return !(in->next && in->next->op == IR_BR && in->next->a.kind == IRV_VREG && in->next->a.value == in->dst);
+        default:
+            return 0;
+    }
+}
+
+// Una divisione può fermare il programma: anticiparla è lecito se il divisore
+// è una costante che non fa scattare l'errore, oppure se sta in testa al ciclo
+// prima di qualunque effetto visibile, e quindi si eseguirebbe comunque per
+// prima al primo giro (BREAK e RETURN non possono saltarla).
+static int cannotFail(IRInstr *in) {
+    if (in->op != IR_DIV && in->op != IR_MOD) return 1;
+    if (in->b.kind == IRV_IMM && in->b.value != 0 && in->b.value != -1) return 1;
+    if (in->block != header) return 0;
+    for (IRInstr *before = header->first; before != in; before = before->next) {
+        switch (before->op) {
+            case IR_PHI: case IR_CONST: case IR_COPY: case IR_LOAD:
+            case IR_ADD: case IR_SUB: case IR_MUL: case IR_NEG: case IR_CMP:
+                break;
+            default:
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static int canHoist(IRInstr *in) {
+    if (!inLoop[in->block->id]) return 1;
+    if (!cannotFail(in)) return 0;
+    if (definedInLoop(in->a) && !canHoist(defOf[in->a.value])) return 0;
+    if (definedInLoop(in->b) && !canHoist(defOf[in->b.value])) return 0;
+    return 1;
+}
+
+// Gli operandi definiti nel ciclo (invarianti) lo precedono nel preheader
+static void hoist(IRInstr *in) {
+    if (!inLoop[in->block->id]) return;
+    if (definedInLoop(in->a)) hoist(defOf[in->a.value]);
+    if (definedInLoop(in->b)) hoist(defOf[in->b.value]);
+    moveIRInstrBefore(in, preheader->last);
+    hoisted++;
+}
+
+static void replaceValue(IRValue *value, const int *replacement) {
+    if (value->kind == IRV_VREG && replacement[value->value] >= 0) value->value = replacement[value->value];
+}
+
+static void replaceOperands(IRInstr *in, const int *replacement) {
+    replaceValue(&in->a, replacement);
+    replaceValue(&in->b, replacement);
+    if (in->op == IR_PHI) {
+        for (int i = 0; i < in->block->predCount; i++) replaceValue(&in->phiArgs[i], replacement);
+    }
+}
+
+// Un calcolo già presente nel preheader con gli stessi operandi, che lo domina
+static IRInstr* sameComputation(IRInstr *in) {
+    if (in->op == IR_LOAD || !worthHoisting(in)) return NULL;
+    for (IRInstr *other = preheader->first; other && other != in; other = other->next) {
+        if (other->op == in->op && other->cond == in->cond &&
+            sameValue(other->a, in->a) && sameValue(other->b, in->b)) return other;
+    }
+    return NULL;
+}
+
+// Le copie di un corpo srotolato ripetono gli stessi calcoli invarianti: il
+// primo sale nel preheader, gli altri ne riusano il valore. Serve anche alle
+// divisioni che cannotFail() tiene nel ciclo perché non sono in testa.
+static void mergeDuplicates() {
+    int *replacement = malloc(sizeof(int) * fn->vregCount);
+    memset(replacement, -1, sizeof(int) * fn->vregCount);
+    int merged = 0;
+    for (int i = -1; i < loopBlockCount; i++) {
+        IRInstr *in = i < 0 ? preheader->first : loopBlocks[i]->first;
+        while (in) {
+            IRInstr *next = in->next;
+            replaceOperands(in, replacement);
+            IRInstr *other = in->dst >= 0 ? sameComputation(in) : NULL;
+            if (other) {
+                replacement[in->dst] = other->dst;
+                removeIRInstr(in);
+                merged++;
+            }
+            in = next;
+        }
+    }
+    // Anche dopo l'uscita dal ciclo
+    if (merged) {
+        for (int i = 0; i < fn->blockCount; i++) {
+            for (IRInstr *in = fn->blocks[i]->first; in; in = in->next) replaceOperands(in, replacement);
+        }
+    }
+    free(replacement);
+}
+
+static void hoistFromLoop() {
+    memset(invariant, 0, fn->vregCount);
+    for (int i = 0; i < loopBlockCount; i++) {
+        for (IRInstr *in = loopBlocks[i]->first; in; in = in->next) {
+            if (in->dst >= 0) invariant[in->dst] = isInvariant(in);
+        }
+    }
+
+    for (int i = 0; i < loopBlockCount; i++) {
+        IRInstr *in = loopBlocks[i]->first;
+        while (in) {
+            IRInstr *next = in->next;
+            // Gli operandi precedono in, quindi hoist() non sposta mai next
+            if (in->dst >= 0 && invariant[in->dst] && worthHoisting(in) && canHoist(in)) hoist(in);
+            in = next;
+        }
+    }
+    mergeDuplicates();
+}
+
+// ---------- RIDUZIONE DI FORZA ----------
+
+// Un nuovo vreg definito da in: le tabelle per vreg crescono con lui
+static int defineVreg(IRInstr *in) {
+    int vreg = newVreg(fn);
+    if (vreg >= vregCapacity) {
+        vregCapacity = vregCapacity * 2 + 16;
+        defOf = realloc(defOf, sizeof(IRInstr*) * vregCapacity);
+        invariant = realloc(invariant, vregCapacity);
+    }
+    defOf[vreg] = in;
+    invariant[vreg] = 0;
+    in->dst = vreg;
+    return vreg;
+}
+
+// Valore invariante calcolato nel preheader (op a, b), o l'immediato se
+// entrambi gli operandi lo sono
+static IRValue preheaderValue(IROp op, IRValue a, IRValue b) {
+    if (a.kind == IRV_IMM && b.kind == IRV_IMM) {
+        unsigned long long ua = (unsigned long long) a.value, ub = (unsigned long long) b.value;
+        return irImm((long long) (op == IR_MUL ? ua * ub : ua + ub));
+    }
+    IRInstr *in = createIRInstr(op);
+    in->a = a;
+    in->b = b;
+    insertIRInstrBefore(preheader->last, in);
+    return irVreg(defineVreg(in));
+}
+
+// Forma affine base + offset di un valore del ciclo, con base un phi della
+// testa (una variabile di induzione candidata); base -1 se non lo è
+typedef struct {
+    int base;
+    long long offset;
+} Affine;
+
+static Affine affineOf(Affine *forms, IRValue value) {
+    Affine none = { -1, 0 };
+    if (value.kind != IRV_VREG || !definedInLoop(value)) return none;
+    return forms[value.value];
+}
+
+static void computeAffine(Affine *forms, const char *isInduction) {
+    for (int i = 0; i < loopBlockCount; i++) {
+        for (IRInstr *in = loopBlocks[i]->first; in; in = in->next) {
+            if (in->dst < 0) continue;
+            Affine form = { -1, 0 };
+            if (in->op == IR_PHI) {
+                if (in->block == header && isInduction[in->dst]) form.base = in->dst;
+            } else if (in->op == IR_COPY) {
+                form = affineOf(forms, in->a);
+            } else if ((in->op == IR_ADD || in->op == IR_SUB) && in->b.kind == IRV_IMM) {
+                form = affineOf(forms, in->a);
+                unsigned long long delta = (unsigned long long) in->b.value;
+                form.offset = (long long) ((unsigned long long) form.offset + (in->op == IR_ADD ? delta : 0 - delta));
+            } else if (in->op == IR_ADD && in->a.kind == IRV_IMM) {
+                form = affineOf(forms, in->b);
+                form.offset = (long long) ((unsigned long long) form.offset + (unsigned long long) in->a.value);
+            }
+            forms[in->dst] = form;
+        }
+    }
+}
+
+// Una variabile di induzione moltiplicata per un invariante
+typedef struct {
+    int base;
+    IRValue factor;
+    int product;        // phi che vale base * factor a ogni giro
+} ReducedProduct;
+
+#define MAX_REDUCED_PRODUCTS 4      // ogni prodotto occupa un registro per tutto il ciclo
+
+// i * c con i = phi(init, i + step) diventa un phi p = phi(init * c, p + step * c)
+static int reducedProduct(ReducedProduct *products, int *count, IRInstr *phi, IRValue factor,
+                          int preheaderIndex, long long step) {
+    for (int i = 0; i < *count; i++) {
+        if (products[i].base == phi->dst && sameValue(products[i].factor, factor)) return products[i].product;
+    }
+    if (*count == MAX_REDUCED_PRODUCTS) return -1;
+
+    IRValue start = preheaderValue(IR_MUL, phi->phiArgs[preheaderIndex], factor);
+    IRValue stride = preheaderValue(IR_MUL, factor, irImm(step));
+    IRInstr *product = createIRInstr(IR_PHI);
+    product->phiArgs = malloc(sizeof(IRValue) * 2);
+    insertIRInstrBefore(header->first, product);
+    defineVreg(product);
+
+    // L'incremento va prima del confronto che chiude il giro, per non
+    // separarlo dal salto con cui il codegen lo fonde
+    IRBlock *latch = header->preds[1 - preheaderIndex];
+    IRInstr *pos = latch->last;
+    if (pos->op == IR_BR && pos->prev && pos->prev->op == IR_CMP &&
+        pos->a.kind == IRV_VREG && pos->a.value == pos->prev->dst) pos = pos->prev;
+    IRInstr *next = createIRInstr(IR_ADD);
+    next->a = irVreg(product->dst);
+    next->b = stride;
+    insertIRInstrBefore(pos, next);
+    defineVreg(next);
+
+    product->phiArgs[preheaderIndex] = start;
+    product->phiArgs[1 - preheaderIndex] = irVreg(next->dst);
+    products[*count].base = phi->dst;
+    products[*count].factor = factor;
+    products[*count].product = product->dst;
+    (*count)++;
+    return product->dst;
+}
+
+static void reduceLoop() {
+    if (header->predCount != 2) return;
+    int preheaderIndex = header->preds[0] == preheader ? 0 : 1;
+
+    // Prima ogni phi della testa è candidato; restano le variabili di
+    // induzione, quelle che il back-edge riporta a sé stesse più un passo
+    int vregs = fn->vregCount;
+    Affine *forms = malloc(sizeof(Affine) * vregs);
+    char *isInduction = calloc(vregs, 1);
+    long long *steps = calloc(vregs, sizeof(long long));
+    memset(isInduction, 1, vregs);
+    computeAffine(forms, isInduction);
+    memset(isInduction, 0, vregs);
+    for (IRInstr *in = header->first; in && in->op == IR_PHI; in = in->next) {
+        Affine next = affineOf(forms, in->phiArgs[1 - preheaderIndex]);
+        if (next.base == in->dst && next.offset != 0) {
+            isInduction[in->dst] = 1;
+            steps[in->dst] = next.offset;
+        }
+    }
+    computeAffine(forms, isInduction);
+
+    ReducedProduct products[MAX_REDUCED_PRODUCTS];
+    int productCount = 0;
+    for (int i = 0; i < loopBlockCount; i++) {
+        for (IRInstr *in = loopBlocks[i]->first; in; in = in->next) {
+            if (in->op != IR_MUL || in->dst >= vregs) continue;
+            // (base + offset) * c = base * c + offset * c, anche con il wrap-around
+            Affine form = affineOf(forms, in->a);
+            IRValue factor = in->b;
+            if (form.base < 0) {
+                form = affineOf(forms, in->b);
+                factor = in->a;
+            }
+            if (form.base < 0 || definedInLoop(factor)) continue;
+            int product = reducedProduct(products, &productCount, defOf[form.base], factor,
+                                         preheaderIndex, steps[form.base]);
+            if (product < 0) continue;
+            IRValue offset = preheaderValue(IR_MUL, factor, irImm(form.offset));
+            if (offset.kind == IRV_IMM && offset.value == 0) {
+                in->op = IR_COPY;
+                in->b.kind = IRV_NONE;
+            } else {
+                in->op = IR_ADD;
+                in->b = offset;
+            }
+            in->a = irVreg(product);
+            reduced++;
+        }
+    }
+    free(forms);
+    free(isInduction);
+    free(steps);
+}
+
+// ---------- VISITA DEI CICLI ----------
+
+static void forEachLoop(IRFunction *function, void (*visit)()) {
+    fn = function;
+    computeDominators(fn);
+    if (createPreheaders()) {
+        computeCFG(fn);
+        computeDominators(fn);
+    }
+
+    vregCapacity = fn->vregCount;
+    defOf = calloc(vregCapacity + 1, sizeof(IRInstr*));
+    int instrCount = 0;
+    for (int i = 0; i < fn->blockCount; i++) {
+        for (IRInstr *in = fn->blocks[i]->first; in; in = in->next) {
+            if (in->dst >= 0) defOf[in->dst] = in;
+            instrCount++;
+        }
+    }
+    inLoop = malloc(fn->nextBlockId);
+    invariant = calloc(vregCapacity + 1, 1);
+    loopBlocks = malloc(sizeof(IRBlock*) * fn->blockCount);
+    loopStores = malloc(sizeof(int) * instrCount);
+
+    // In RPO un ciclo interno segue la testa di quello che lo contiene: dal
+    // fondo, il codice uscito da un ciclo interno può uscire anche dall'esterno
+    for (int i = fn->blockCount - 1; i >= 0; i--) {
+        if (!hasBackEdge(fn->blocks[i])) continue;
+        header = fn->blocks[i];
+        preheader = outsidePredecessor(header);
+        if (!preheader || preheader->succCount != 1) continue;
+        collectLoop();
+        visit();
+    }
+
+    free(defOf);
+    free(inLoop);
+    free(invariant);
+    free(loopBlocks);
+    free(loopStores);
+}
+
+int hoistLoopInvariants(IRFunction *function) {
+    hoisted = 0;
+    forEachLoop(function, hoistFromLoop);
+    return hoisted;
+}
+
+int reduceInductionStrength(IRFunction *function) {
+    reduced = 0;
+    forEachLoop(function, reduceLoop);
+    return reduced;
+}
@@ -0,0 +1,18 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include "ir.h"
+
+// Ottimizzazioni dei cicli sull'IR in forma SSA.
+
+// Spostamento del codice invariante (LICM): i calcoli che dipendono solo da
+// valori definiti prima del ciclo vanno nel preheader e si eseguono una volta
+// per ingresso. Restituisce il numero di istruzioni spostate.
+int hoistLoopInvariants(IRFunction *fn);
+
+// Riduzione di forza: una moltiplicazione (i + k) * c, con i variabile di
+// induzione e c invariante, diventa una somma su un nuovo phi che avanza di
+// passo * c a ogni giro. Restituisce il numero di moltiplicazioni ridotte.
+int reduceInductionStrength(IRFunction *fn);
+
+#endif // LICM_H
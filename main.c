@@ -1,70 +1,116 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include "lexer.h"
-#include "parser.h"
-#include "ast.h"
-#include "codegen.h"
-#include "symbol_table.h"
+#include <string.h>
+#include "context.h"
+#include "scan.h"
+#include "cache.h"
 
-char *readFile(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        perror("Errore nell'aprire il file sorgente");
-        return NULL;
-    }
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    rewind(file);
-
-    char *buffer = (char*) malloc((length + 1) * sizeof(char));
-    if (!buffer) {
-        fclose(file);
-        return NULL;
-    }
-
-    fread(buffer, sizeof(char), length, file);
-    buffer[length] = '\0';
-    fclose(file);
-    return buffer;
+static void usage(const char *program) {
+    fprintf(stderr, "Uso: %s [-o <file>] [--run] [--interp] [--emit-bytecode] [--emit-asm] [--emit-ir] [--dump-tokens] [--dump-ast] "
+                    "[--stats] [--stats=json] [--time-report] [--no-peephole] [--unroll <n>] [--line-buffered] [--scan=scalar|sse2|avx2] [--cache <dir>] [--cache-size <MB>] <inputfile>\n"
+                    "     %s [--jobs <n>] [--emit-asm] [--no-peephole] [--unroll <n>] [--line-buffered] [--cache <dir>] [--cache-size <MB>] [--stats] <inputfile>...\n", program, program);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Uso: %s <inputfile>\n", argv[0]);
-        return 1;
+    CompilerContext options;
+    initCompilerContext(&options);
+    const char **inputs = malloc(sizeof(char*) * argc);
+    int inputCount = 0;
+    int jobs = 0;
+    int textOutput = 0;     // dump che stampano su stdout
+    const char *cacheDirectory = NULL;
+    long long cacheMegabytes = 256;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            if (jobs < 1) {
+                fprintf(stderr, "Numero di thread non valido: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--unroll") == 0 && i + 1 < argc) {
+            options.unroll = atoi(argv[++i]);
+            if (options.unroll < 1) {
+                fprintf(stderr, "Fattore di srotolamento non valido: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            cacheMegabytes = atoll(argv[++i]);
+            if (cacheMegabytes < 1) {
+                fprintf(stderr, "Dimensione della cache non valida: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--emit-asm") == 0) {
+            options.output = OUTPUT_ASM;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            options.output = OUTPUT_RUN;
+        } else if (strcmp(argv[i], "--interp") == 0) {
+            options.output = OUTPUT_INTERP;
+        } else if (strcmp(argv[i], "--emit-bytecode") == 0) {
+            options.output = OUTPUT_BYTECODE;
+        } else if (strcmp(argv[i], "--emit-ir") == 0) {
+            options.output = OUTPUT_IR;
+        } else if (strcmp(argv[i], "--dump-tokens") == 0) {
+            options.dumpTokens = textOutput = 1;
+        } else if (strcmp(argv[i], "--dump-ast") == 0) {
+            options.dumpAST = textOutput = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = 1;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            options.report = REPORT_JSON;
+        } else if (strcmp(argv[i], "--time-report") == 0) {
+            options.report = REPORT_TEXT;
+        } else if (strcmp(argv[i], "--no-peephole") == 0) {
+            options.peephole = 0;
+        } else if (strcmp(argv[i], "--line-buffered") == 0) {
+            options.lineBuffered = 1;
+        } else if (strncmp(argv[i], "--scan=", 7) == 0) {
+            // Forza un percorso del lexer (per confrontarli), di norma si sceglie in base alla CPU
+            const char *name = argv[i] + 7;
+            ScanPath path = strcmp(name, "scalar") == 0 ? SCAN_SCALAR :
+                            strcmp(name, "sse2") == 0 ? SCAN_SSE2 : SCAN_AVX2;
+            if ((path == SCAN_AVX2 && strcmp(name, "avx2") != 0) || !setScanPath(path)) {
+                fprintf(stderr, "Percorso di scansione non supportato: %s\n", name);
+                return 1;
+            }
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            inputs[inputCount++] = argv[i];
+        }
     }
-
-    char *sourceCode = readFile(argv[1]);
-    if (!sourceCode) {
-        fprintf(stderr, "Impossibile leggere il file sorgente.\n");
+    if (inputCount == 0) {
+        usage(argv[0]);
         return 1;
     }
 
-    printf("=== SOURCE CODE ===\n%s\n", sourceCode);
+    // Una cartella inutilizzabile disattiva la cache senza fermare la compilazione
+    if (cacheDirectory) initCache(cacheDirectory, cacheMegabytes * 1024 * 1024);
 
-    printf("\n=== LEXER PHASE ===\n");
-    tokenize(sourceCode);
-    printTokens();
-
-    printf("\n=== PARSER PHASE ===\n");
-    ASTNode* root = parseProgram();
-    printf("AST generato:\n");
-    printAST(root, 0);
-
-    FILE *outputFile = freopen("output.asm", "w", stdout);
-    if (!outputFile) {
-        perror("Errore nell'aprire il file");
-        free(sourceCode);
-        freeAST(root);
-        return 1;
+    int status;
+    if (inputCount == 1 && jobs == 0) {
+        options.inputPath = inputs[0];
+        status = compileFile(&options);
+    } else {
+        // Batch: ogni sorgente produce il proprio file, niente uscita su stdout
+        int producesFile = options.output == OUTPUT_ELF || options.output == OUTPUT_ASM;
+        if (!producesFile || textOutput || options.report != REPORT_NONE ||
+            (options.stats && !cacheEnabled()) || options.outputPath) {
+            fprintf(stderr, "Con più sorgenti o --jobs si possono generare solo eseguibili o --emit-asm, senza -o\n");
+            return 1;
+        }
+        // Con --stats si stampa solo il riepilogo della cache: le statistiche
+        // delle fasi dei vari file si mescolerebbero
+        int stats = options.stats;
+        options.stats = 0;
+        status = compileBatch(&options, inputs, inputCount, jobs ? jobs : 1) ? 1 : 0;
+        options.stats = stats;
     }
-
-    generateCode(root);
-
-    fclose(outputFile);
-    freopen("/dev/tty", "w", stdout);
-
-    freeAST(root);
-    free(sourceCode);
-    return 0;
+    if (options.stats && cacheEnabled()) printCacheStats(stdout);
+    free(inputs);
+    return status;
 }
@@ -3,34 +3,35 @@
 #include <string.h>
 #include "parser.h"
 #include "lexer.h"
+#include "context.h"
 
 // Funzione di supporto: verifica se il token corrente è uno dei token terminatori
-static int isStopToken(Token t, TokenType stopTokens[], int stopCount) {
+static int isStopToken(const Token *t, TokenType stopTokens[], int stopCount) {
     for (int i = 0; i < stopCount; i++) {
-        if (t.type == stopTokens[i]) return 1;
+        if (t->type == stopTokens[i]) return 1;
     }
     return 0;
 }
 
-// Per scorrere i token
-static int currentIndex = 0;
-
-static Token getCurrentToken() {
-    return tokens[currentIndex];
+// I token arrivano dallo stream del lexer: il puntatore restituito vale fino
+// al prossimo advance(), i token che servono dopo vanno copiati
+static const Token* currentToken() {
+    return peekToken(0);
 }
 
 static void advance() {
-    currentIndex++;
+    nextToken();
 }
 
 static bool match(TokenType t) {
-    return (getCurrentToken().type == t);
+    return currentToken()->type == t;
 }
 
 static void expect(TokenType t, const char* errMsg) {
     if (!match(t)) {
-        printf("Errore di parsing: %s (trovato '%s')\n", errMsg, getCurrentToken().value);
-        exit(1);
+        const Token *t = currentToken();
+        sourceError(t->line, t->position, "Errore di parsing: %s (trovato '%.*s')",
+                    errMsg, t->length, tokenText(t));
     }
     advance();
 }
@@ -47,39 +48,71 @@ static ASTNode* parseFunctionDef();
 static ASTNode* parseReturnStatement();
 static ASTNode* parsePrintStatement();
 
+// Statement dei blocchi in costruzione: ogni blocco annidato impila i propri
+// sopra quelli del blocco esterno e alla chiusura li copia nel suo span
+static _Thread_local ASTNode **pending = NULL;
+static _Thread_local int pendingCount = 0, pendingCap = 0;
+
+// Nodo con un nome (variabile o funzione): il simbolo interned del token
+static ASTNode* createNameNode(ASTNodeType type, const Token *t, int childCount) {
+    ASTNode *node = createASTNode(type, childCount);
+    node->symbol = t->symbol;
+    return node;
+}
+
+// Nodo il cui valore è il testo del token (stringhe, float e operatori)
+static ASTNode* createTokenNode(ASTNodeType type, const Token *t, int childCount) {
+    return createTextNode(type, tokenText(t), t->length, childCount);
+}
+
 // ---------- PARSER ENTRY POINT ----------
 ASTNode* parseProgram() {
-    currentIndex = 0;
-    ASTNode* programNode = createASTNode(AST_PROGRAM, "");
     // Per il programma, il blocco termina solo con EOF
     TokenType stops[] = { TOKEN_EOF };
+    pendingCount = 0;  // un errore può aver interrotto la compilazione precedente
     ASTNode* statements = parseStatementList(stops, 1);
-    addChild(programNode, statements);
     expect(TOKEN_EOF, "Atteso EOF alla fine del programma");
+    ASTNode* programNode = createASTNode(AST_PROGRAM, 1);
+    programNode->children[0] = statements;
+
+    free(pending);
+    pending = NULL;
+    pendingCap = 0;
     return programNode;
 }
 
 // ---------- STATEMENTS ----------
 // La funzione parseStatementList accetta un array di token terminatori e si ferma se ne incontra uno.
 static ASTNode* parseStatementList(TokenType stopTokens[], int stopCount) {
-    ASTNode* blockNode = createASTNode(AST_BLOCK, "");
-    while (!isStopToken(getCurrentToken(), stopTokens, stopCount)) {
+    int base = pendingCount;
+    while (!isStopToken(currentToken(), stopTokens, stopCount)) {
+        // Lo stream restituisce EOF all'infinito: un blocco non chiuso è un errore
+        if (match(TOKEN_EOF)) {
+            const Token *t = currentToken();
+            sourceError(t->line, t->position, "Errore di parsing: fine del file prima della chiusura del blocco");
+        }
         ASTNode* st = parseStatement();
         if (st) {
-            addChild(blockNode, st);
+            if (pendingCount == pendingCap) {
+                pendingCap = pendingCap ? pendingCap * 2 : 64;
+                pending = realloc(pending, sizeof(ASTNode*) * pendingCap);
+            }
+            pending[pendingCount++] = st;
         }
     }
+    ASTNode* blockNode = createASTNode(AST_BLOCK, pendingCount - base);
+    memcpy(blockNode->children, pending + base, sizeof(ASTNode*) * (pendingCount - base));
+    pendingCount = base;
     return blockNode;
 }
 
 static ASTNode* parseBreakStatement() {
     expect(TOKEN_BREAK, "Atteso 'BREAK'");
-    return createASTNode(AST_BREAK, "");
+    return createASTNode(AST_BREAK, 0);
 }
 
 static ASTNode* parseStatement() {
-    Token t = getCurrentToken();
-    switch (t.type) {
+    switch (currentToken()->type) {
         case TOKEN_VAR:
             return parseVarDecl();
         case TOKEN_IF:
@@ -94,10 +127,10 @@ static ASTNode* parseStatement() {
             return parsePrintStatement();
         case TOKEN_BREAK:  // Aggiunto qui
             advance();
-            return createASTNode(AST_BREAK, "");
+            return createASTNode(AST_BREAK, 0);
         case TOKEN_IDENTIFIER: {
             // Potrebbe essere un assignment o un'espressione, verifichiamo se c'è un '=' dopo
-            if (tokens[currentIndex+1].type == TOKEN_ASSIGN) {
+            if (peekToken(1)->type == TOKEN_ASSIGN) {
                 return parseAssignment();
             } else {
                 ASTNode* expr = parseExpression();
@@ -114,26 +147,23 @@ static ASTNode* parseStatement() {
 // ---------- VAR DECL:  VAR IDENTIFIER = expression ----------
 static ASTNode* parseVarDecl() {
     expect(TOKEN_VAR, "Atteso 'VAR'");
-    Token ident = getCurrentToken();
+    Token ident = *currentToken();
     expect(TOKEN_IDENTIFIER, "Atteso identificatore dopo VAR");
 
-    ASTNode* varNode = createASTNode(AST_VAR_DECL, ident.value);
+    ASTNode* varNode = createNameNode(AST_VAR_DECL, &ident, 1);
     expect(TOKEN_ASSIGN, "Atteso '=' dopo identificatore in dichiarazione");
-    ASTNode* expr = parseExpression();
-    addChild(varNode, expr);
+    varNode->children[0] = parseExpression();
     return varNode;
 }
 
 // ---------- ASSIGNMENT:  IDENTIFIER = expression ----------
 static ASTNode* parseAssignment() {
-    Token ident = getCurrentToken();
+    Token ident = *currentToken();
     expect(TOKEN_IDENTIFIER, "Atteso identificatore");
     expect(TOKEN_ASSIGN, "Atteso '=' per assignment");
-    ASTNode* assignNode = createASTNode(AST_ASSIGNMENT, "");
-    ASTNode* idNode = createASTNode(AST_IDENTIFIER, ident.value);
-    addChild(assignNode, idNode);
-    ASTNode* expr = parseExpression();
-    addChild(assignNode, expr);
+    ASTNode* assignNode = createASTNode(AST_ASSIGNMENT, 2);
+    assignNode->children[0] = createNameNode(AST_IDENTIFIER, &ident, 0);
+    assignNode->children[1] = parseExpression();
     return assignNode;
 }
 
@@ -155,11 +185,11 @@ static ASTNode* parseIfStatement() {
         elseBlock = parseStatementList(elseStops, 1);
     }
     expect(TOKEN_ENDIF, "Atteso 'ENDIF'");
-    ASTNode* ifNode = createASTNode(AST_IF, "");
-    addChild(ifNode, cond);
-    addChild(ifNode, thenBlock);
+    ASTNode* ifNode = createASTNode(AST_IF, elseBlock ? 3 : 2);
+    ifNode->children[0] = cond;
+    ifNode->children[1] = thenBlock;
     if (elseBlock) {
-        addChild(ifNode, elseBlock);
+        ifNode->children[2] = elseBlock;
     }
     return ifNode;
 }
@@ -167,16 +197,14 @@ static ASTNode* parseIfStatement() {
 static ASTNode* parseLoopStatement() {
     expect(TOKEN_LOOP, "Atteso 'LOOP'");
     
-    ASTNode* loopNode = createASTNode(AST_LOOP, "");
+    ASTNode* loopNode = createASTNode(AST_LOOP, 2);
     
     // Gestione opzionale della condizione
-    ASTNode* condition = parseExpression();
-    addChild(loopNode, condition);
+    loopNode->children[0] = parseExpression();
 
     // Corpo del loop, fermarsi a NEXT
     TokenType loopStops[] = { TOKEN_NEXT };
-    ASTNode* loopBlock = parseStatementList(loopStops, 1);
-    addChild(loopNode, loopBlock);
+    loopNode->children[1] = parseStatementList(loopStops, 1);
 
     expect(TOKEN_NEXT, "Atteso 'NEXT' al termine del loop");
     return loopNode;
@@ -188,7 +216,7 @@ static ASTNode* parseLoopStatement() {
 static ASTNode* parseFunctionDef() {
     expect(TOKEN_DEFINE, "Atteso 'DEFINE'");
     expect(TOKEN_FUNCTION, "Atteso 'FUNCTION'");
-    Token funcName = getCurrentToken();
+    Token funcName = *currentToken();
     expect(TOKEN_IDENTIFIER, "Atteso identificatore (nome funzione)");
 
     // Ignoriamo i parametri per ora
@@ -200,42 +228,85 @@ static ASTNode* parseFunctionDef() {
     ASTNode* body = parseStatementList(funcStops, 1);
     expect(TOKEN_ENDDEF, "Atteso 'ENDDEF' al termine della funzione");
 
-    ASTNode* funcNode = createASTNode(AST_FUNCTION_DEF, funcName.value);
-    addChild(funcNode, body);
+    ASTNode* funcNode = createNameNode(AST_FUNCTION_DEF, &funcName, 1);
+    funcNode->children[0] = body;
     return funcNode;
 }
 
-// ---------- RETURN STATEMENT: RETURN expression ----------
+// Verifica se il token corrente può iniziare un'espressione (un identificatore
+// seguito da '=' è invece l'inizio di un assignment)
+static bool startsExpression() {
+    const Token *t = currentToken();
+    switch (t->type) {
+        case TOKEN_INT_NUMBER:
+        case TOKEN_FLOAT_NUMBER:
+        case TOKEN_STRING_LITERAL:
+        case TOKEN_LPAREN:
+            return true;
+        case TOKEN_IDENTIFIER:
+            return peekToken(1)->type != TOKEN_ASSIGN;
+        case TOKEN_ARITH_OP:
+            return tokenText(t)[0] == '-';
+        case TOKEN_LOGIC_OP:
+            return tokenText(t)[0] == '!';
+        default:
+            return false;
+    }
+}
+
+// ---------- RETURN STATEMENT: RETURN [expression] ----------
 static ASTNode* parseReturnStatement() {
     expect(TOKEN_RETURN, "Atteso 'RETURN'");
-    ASTNode* retNode = createASTNode(AST_RETURN, "");
-    ASTNode* expr = parseExpression();
-    addChild(retNode, expr);
+    ASTNode* expr = startsExpression() ? parseExpression() : NULL;
+    ASTNode* retNode = createASTNode(AST_RETURN, expr ? 1 : 0);
+    if (expr) {
+        retNode->children[0] = expr;
+    }
     return retNode;
 }
 
 // ---------- PRINT STATEMENT: PRINT expression ----------
 static ASTNode* parsePrintStatement() {
     expect(TOKEN_PRINT, "Atteso 'PRINT'");
-    ASTNode* printNode = createASTNode(AST_PRINT, "");
-    ASTNode* expr = parseExpression();
-    addChild(printNode, expr);
+    ASTNode* printNode = createASTNode(AST_PRINT, 1);
+    printNode->children[0] = parseExpression();
     return printNode;
 }
 
 // ---------- EXPRESSION PARSING SEMPLIFICATO ----------
 
-// Per semplicità, gestiamo le espressioni in modo approssimativo
-static ASTNode* parseComparison();
+// expression -> and ( || and )*
+// and -> comparison ( && comparison )*
+// && e || valutano la destra solo se il risultato non è già deciso
+static bool matchLogic(char op) {
+    return match(TOKEN_LOGIC_OP) && currentToken()->length == 2 && tokenText(currentToken())[0] == op;
+}
+
+static ASTNode* parseAnd();
 static ASTNode* parseExpression() {
+    ASTNode* left = parseAnd();
+    while (matchLogic('|')) {
+        Token op = *currentToken();
+        advance();
+        ASTNode* right = parseAnd();
+        ASTNode* binOp = createTokenNode(AST_BINARY_EXPR, &op, 2);
+        binOp->children[0] = left;
+        binOp->children[1] = right;
+        left = binOp;
+    }
+    return left;
+}
+
+static ASTNode* parseComparison();
+static ASTNode* parseAnd() {
     ASTNode* left = parseComparison();
-    while (match(TOKEN_LOGIC_OP)) {
-        Token op = getCurrentToken();
+    while (matchLogic('&')) {
+        Token op = *currentToken();
         advance();
         ASTNode* right = parseComparison();
-        ASTNode* binOp = createASTNode(AST_BINARY_EXPR, op.value);
-        addChild(binOp, left);
-        addChild(binOp, right);
+        ASTNode* binOp = createTokenNode(AST_BINARY_EXPR, &op, 2);
+        binOp->children[0] = left;
+        binOp->children[1] = right;
         left = binOp;
     }
     return left;
@@ -246,12 +317,12 @@ static ASTNode* parseTerm();
 static ASTNode* parseComparison() {
     ASTNode* left = parseTerm();
     while (match(TOKEN_COMPARE_OP)) {
-        Token op = getCurrentToken();
+        Token op = *currentToken();
         advance();
         ASTNode* right = parseTerm();
-        ASTNode* binOp = createASTNode(AST_BINARY_EXPR, op.value);
-        addChild(binOp, left);
-        addChild(binOp, right);
+        ASTNode* binOp = createTokenNode(AST_BINARY_EXPR, &op, 2);
+        binOp->children[0] = left;
+        binOp->children[1] = right;
         left = binOp;
     }
     return left;
@@ -262,14 +333,14 @@ static ASTNode* parseFactor();
 static ASTNode* parseTerm() {
     ASTNode* left = parseFactor();
     while (match(TOKEN_ARITH_OP)) {
-        char c = getCurrentToken().value[0];
+        char c = tokenText(currentToken())[0];
         if (c == '+' || c == '-') {
-            Token op = getCurrentToken();
+            Token op = *currentToken();
             advance();
             ASTNode* right = parseFactor();
-            ASTNode* binOp = createASTNode(AST_BINARY_EXPR, op.value);
-            addChild(binOp, left);
-            addChild(binOp, right);
+            ASTNode* binOp = createTokenNode(AST_BINARY_EXPR, &op, 2);
+            binOp->children[0] = left;
+            binOp->children[1] = right;
             left = binOp;
         } else {
             break;
@@ -283,14 +354,14 @@ static ASTNode* parseUnary();
 static ASTNode* parseFactor() {
     ASTNode* left = parseUnary();
     while (match(TOKEN_ARITH_OP)) {
-        char c = getCurrentToken().value[0];
+        char c = tokenText(currentToken())[0];
         if (c == '*' || c == '/' || c == '%') {
-            Token op = getCurrentToken();
+            Token op = *currentToken();
             advance();
             ASTNode* right = parseUnary();
-            ASTNode* binOp = createASTNode(AST_BINARY_EXPR, op.value);
-            addChild(binOp, left);
-            addChild(binOp, right);
+            ASTNode* binOp = createTokenNode(AST_BINARY_EXPR, &op, 2);
+            binOp->children[0] = left;
+            binOp->children[1] = right;
             left = binOp;
         } else {
             break;
@@ -299,38 +370,50 @@ static ASTNode* parseFactor() {
     return left;
 }
 
-// unary -> ( - unary ) | primary
+// unary -> ( - unary ) | ( ! unary ) | primary
 static ASTNode* parsePrimary();
 static ASTNode* parseUnary() {
-    if (match(TOKEN_ARITH_OP) && getCurrentToken().value[0] == '-') {
+    if (match(TOKEN_ARITH_OP) && tokenText(currentToken())[0] == '-') {
         advance();
-        ASTNode* node = createASTNode(AST_BINARY_EXPR, "-u"); // unary minus
-        ASTNode* expr = parseUnary();
-        addChild(node, expr);
+        ASTNode* node = createTextNode(AST_BINARY_EXPR, "-u", 2, 1); // unary minus
+        node->children[0] = parseUnary();
+        return node;
+    }
+    if (match(TOKEN_LOGIC_OP) && tokenText(currentToken())[0] == '!') {
+        advance();
+        ASTNode* node = createTextNode(AST_BINARY_EXPR, "!", 1, 1);
+        node->children[0] = parseUnary();
         return node;
     }
     return parsePrimary();
 }
 
-// primary -> INT_NUMBER | FLOAT_NUMBER | STRING_LITERAL | IDENTIFIER | '(' expression ')'
+// primary -> INT_NUMBER | FLOAT_NUMBER | STRING_LITERAL | IDENTIFIER | IDENTIFIER '(' ')' | '(' expression ')'
 static ASTNode* parsePrimary() {
-    Token t = getCurrentToken();
-    if (t.type == TOKEN_INT_NUMBER || t.type == TOKEN_FLOAT_NUMBER) {
+    Token t = *currentToken();
+    if (t.type == TOKEN_INT_NUMBER) {
         advance();
-        return createASTNode(AST_LITERAL, t.value);
-    } else if (t.type == TOKEN_STRING_LITERAL) {
+        // Come l'aritmetica a 64 bit: i valori oltre LLONG_MAX si riavvolgono
+        return createNumberNode((long long) strtoull(tokenText(&t), NULL, 10));
+    } else if (t.type == TOKEN_FLOAT_NUMBER || t.type == TOKEN_STRING_LITERAL) {
         advance();
-        return createASTNode(AST_LITERAL, t.value);
+        return createTokenNode(AST_STRING, &t, 0);
     } else if (t.type == TOKEN_IDENTIFIER) {
         advance();
-        return createASTNode(AST_IDENTIFIER, t.value);
+        if (match(TOKEN_LPAREN)) {
+            // Chiamata di funzione (senza parametri)
+            advance();
+            expect(TOKEN_RPAREN, "Atteso ')' nella chiamata di funzione");
+            return createNameNode(AST_CALL, &t, 0);
+        }
+        return createNameNode(AST_IDENTIFIER, &t, 0);
     } else if (t.type == TOKEN_LPAREN) {
         advance();
         ASTNode* expr = parseExpression();
         expect(TOKEN_RPAREN, "Atteso ')' in espressione parentetica");
         return expr;
     } else {
-        printf("Errore di parsing: token inaspettato '%s'\n", t.value);
-        exit(1);
+        sourceError(t.line, t.position, "Errore di parsing: token inaspettato '%.*s'",
+                    t.length, tokenText(&t));
     }
 }
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "peephole.h"
+
+// Il codice generato non tiene mai i flag vivi attraverso un'etichetta,
+// un salto, una chiamata o un ret: l'analisi dei flag si ferma lì.
+
+typedef struct {
+    const char *name;
+    int (*apply)(AsmProgram *program, AsmLine *line);
+    int hits;
+} PeepholeRule;
+
+static _Thread_local int instrBefore = 0, instrAfter = 0;
+
+// ---------- REGISTRI ----------
+
+#define NUM_X86_REGS 16
+#define REG_FAMILY_RSP 7
+
+static const char *regs64[NUM_X86_REGS] = {
+    "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+static const char *regs32[NUM_X86_REGS] = {
+    "eax", "ebx", "ecx", "edx", "esi", "edi", "ebp", "esp",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+static const char *regs16[NUM_X86_REGS] = {
+    "ax", "bx", "cx", "dx", "si", "di", "bp", "sp",
+    "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"
+};
+static const char *regs8[NUM_X86_REGS] = {
+    "al", "bl", "cl", "dl", "sil", "dil", "bpl", "spl",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+
+// Registro a 64 bit che contiene il nome dato (a qualsiasi ampiezza), -1 se nessuno
+static int regFamily(const char *name) {
+    for (int i = 0; i < NUM_X86_REGS; i++) {
+        if (strcmp(name, regs64[i]) == 0 || strcmp(name, regs32[i]) == 0 ||
+            strcmp(name, regs16[i]) == 0 || strcmp(name, regs8[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static int isReg64(const char *name) {
+    for (int i = 0; i < NUM_X86_REGS; i++) {
+        if (strcmp(name, regs64[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int isRegister(const char *operand) {
+    return regFamily(operand) >= 0;
+}
+
+// L'operando nomina il registro, anche dentro un indirizzo ([rsp + 8])
+static int mentionsReg(const char *operand, int family) {
+    char word[MAX_ASM_OPERAND];
+    const char *p = operand;
+    while (*p) {
+        if (!isalnum((unsigned char) *p)) {
+            p++;
+            continue;
+        }
+        int len = 0;
+        while (isalnum((unsigned char) *p) && len < MAX_ASM_OPERAND - 1) word[len++] = *p++;
+        word[len] = '\0';
+        if (regFamily(word) == family) return 1;
+    }
+    return 0;
+}
+
+// ---------- ISTRUZIONI ----------
+
+static int isInstr(AsmLine *line, const char *mnemonic) {
+    return line && line->kind == ASM_INSTR && strcmp(line->mnemonic, mnemonic) == 0;
+}
+
+static int isJump(AsmLine *line) {
+    return line && line->kind == ASM_INSTR && line->mnemonic[0] == 'j';
+}
+
+static int isCondJump(AsmLine *line) {
+    return isJump(line) && strcmp(line->mnemonic, "jmp") != 0;
+}
+
+static int isSetcc(AsmLine *line) {
+    return line && line->kind == ASM_INSTR && strncmp(line->mnemonic, "set", 3) == 0;
+}
+
+// Condizione opposta (suffisso di jcc/setcc), NULL se sconosciuta
+static const char* negateCondition(const char *cc) {
+    static const char *pairs[][2] = {
+        { "e", "ne" }, { "z", "nz" }, { "l", "ge" }, { "le", "g" },
+        { "b", "ae" }, { "be", "a" }, { "s", "ns" }, { "o", "no" }
+    };
+    for (int i = 0; i < (int) (sizeof(pairs) / sizeof(pairs[0])); i++) {
+        if (strcmp(cc, pairs[i][0]) == 0) return pairs[i][1];
+        if (strcmp(cc, pairs[i][1]) == 0) return pairs[i][0];
+    }
+    return NULL;
+}
+
+static int writesReg(AsmLine *line, int family) {
+    if (isInstr(line, "cmp") || isInstr(line, "test") || isInstr(line, "push")) return 0;
+    return line->operandCount > 0 && regFamily(line->operands[0]) == family;
+}
+
+// Istruzioni che non toccano i flag (o li modificano solo in parte)
+static int keepsFlags(AsmLine *line) {
+    static const char *mnemonics[] = {
+        "mov", "movzx", "movsx", "movsxd", "lea", "push", "pop", "inc", "dec", "cqo", "nop", "rep"
+    };
+    for (int i = 0; i < (int) (sizeof(mnemonics) / sizeof(mnemonics[0])); i++) {
+        if (strcmp(line->mnemonic, mnemonics[i]) == 0) return 1;
+    }
+    return isSetcc(line);
+}
+
+// Oltre FLAGS_SCAN_LIMIT istruzioni i flag si considerano vivi: lunghe sequenze
+// di mov (es. i salvataggi delle globali) renderebbero la scansione quadratica
+#define FLAGS_SCAN_LIMIT 32
+
+static int flagsLiveAfter(AsmLine *line) {
+    int scanned = 0;
+    for (AsmLine *l = line->next; l; l = l->next) {
+        if (++scanned > FLAGS_SCAN_LIMIT) return 1;
+        if (l->kind != ASM_INSTR) return 0;
+        if (isCondJump(l) || isSetcc(l) || strncmp(l->mnemonic, "cmov", 4) == 0 ||
+            isInstr(l, "adc") || isInstr(l, "sbb")) return 1;
+        if (isJump(l) || isInstr(l, "call") || isInstr(l, "ret") || isInstr(l, "syscall")) return 0;
+        if (!keepsFlags(l)) return 0;
+    }
+    return 0;
+}
+
+static int isAlign(AsmLine *line) {
+    return line->kind == ASM_DIRECTIVE && strncmp(line->text, "align", 5) == 0;
+}
+
+// Etichetta raggiungibile scendendo da line senza eseguire istruzioni (il
+// riempitivo di un align non conta)
+static int fallsIntoLabel(AsmLine *line, const char *label) {
+    for (AsmLine *l = line->next; l && (l->kind == ASM_LABEL || isAlign(l)); l = l->next) {
+        if (strcmp(l->text, label) == 0) return 1;
+    }
+    return 0;
+}
+
+// ---------- REGOLE ----------
+
+// mov rax, rax
+static int ruleMovSelf(AsmProgram *program, AsmLine *line) {
+    if (!isInstr(line, "mov") || line->operandCount != 2) return 0;
+    if (!isReg64(line->operands[0]) || strcmp(line->operands[0], line->operands[1]) != 0) return 0;
+    removeAsmLine(program, line);
+    return 1;
+}
+
+// mov a, b / mov b, a: la seconda copia è già vera
+static int ruleMovBack(AsmProgram *program, AsmLine *line) {
+    AsmLine *next = line->next;
+    if (!isInstr(line, "mov") || !isInstr(next, "mov")) return 0;
+    if (line->operandCount != 2 || next->operandCount != 2) return 0;
+    if (strcmp(line->operands[0], next->operands[1]) != 0 ||
+        strcmp(line->operands[1], next->operands[0]) != 0) return 0;
+    // mov rax, [rax] cambia l'indirizzo da cui si rilegge
+    int family = regFamily(line->operands[0]);
+    if (family >= 0 && mentionsReg(line->operands[1], family)) return 0;
+    removeAsmLine(program, next);
+    return 1;
+}
+
+// push a / pop b adiacenti
+static int rulePushPop(AsmProgram *program, AsmLine *line) {
+    AsmLine *next = line->next;
+    if (!isInstr(line, "push") || !isInstr(next, "pop")) return 0;
+    if (strcmp(line->operands[0], next->operands[0]) == 0) {
+        removeAsmLine(program, next);
+        removeAsmLine(program, line);
+        return 1;
+    }
+    if (!isRegister(next->operands[0])) return 0;
+    char src[MAX_ASM_OPERAND];
+    strcpy(src, line->operands[0]);
+    setAsmInstr(line, "mov", next->operands[0], src);
+    removeAsmLine(program, next);
+    return 1;
+}
+
+// push r ... pop r quando in mezzo nessuno scrive r né usa lo stack
+static int rulePushPopDead(AsmProgram *program, AsmLine *line) {
+    if (!isInstr(line, "push") || !isReg64(line->operands[0])) return 0;
+    int family = regFamily(line->operands[0]);
+    static const char *barriers[] = {
+        "call", "syscall", "ret", "push", "div", "idiv", "mul", "cqo", "xchg", "leave",
+        "rep", "repe", "repne"
+    };
+
+    AsmLine *l = line->next;
+    for (int window = 0; l && window < 8; window++, l = l->next) {
+        if (l->kind != ASM_INSTR || isJump(l)) return 0;
+        if (isInstr(l, "pop")) {
+            if (strcmp(l->operands[0], line->operands[0]) != 0) return 0;
+            removeAsmLine(program, l);
+            removeAsmLine(program, line);
+            return 1;
+        }
+        for (int i = 0; i < (int) (sizeof(barriers) / sizeof(barriers[0])); i++) {
+            if (isInstr(l, barriers[i])) return 0;
+        }
+        // imul a un operando scrive anche rdx:rax
+        if (isInstr(l, "imul") && l->operandCount == 1) return 0;
+        for (int i = 0; i < l->operandCount; i++) {
+            // Gli indirizzi relativi a rsp contano anche la push
+            if (mentionsReg(l->operands[i], REG_FAMILY_RSP)) return 0;
+        }
+        if (writesReg(l, family)) return 0;
+    }
+    return 0;
+}
+
+// setcc al / movzx rax, al / [mov m, rax] / cmp rax, 0 / je L
+// diventa un salto sui flag del confronto originale
+static int ruleCmpBranch(AsmProgram *program, AsmLine *line) {
+    AsmLine *zext = line->next;
+    if (!isSetcc(line) || !isInstr(zext, "movzx")) return 0;
+    if (strcmp(zext->operands[1], line->operands[0]) != 0) return 0;
+    const char *value = zext->operands[0];
+    const char *copy = NULL;
+
+    AsmLine *cmp = zext->next;
+    if (isInstr(cmp, "mov") && cmp->operandCount == 2 && strcmp(cmp->operands[1], value) == 0) {
+        copy = cmp->operands[0];
+        cmp = cmp->next;
+    }
+    if (!isInstr(cmp, "cmp") || strcmp(cmp->operands[1], "0") != 0) return 0;
+    if (strcmp(cmp->operands[0], value) != 0 && (!copy || strcmp(cmp->operands[0], copy) != 0)) return 0;
+
+    AsmLine *jump = cmp->next;
+    const char *cc = line->mnemonic + 3;
+    char mnemonic[MAX_ASM_MNEMONIC];
+    if (isInstr(jump, "jne")) {
+        snprintf(mnemonic, sizeof(mnemonic), "j%s", cc);
+    } else if (isInstr(jump, "je")) {
+        const char *negated = negateCondition(cc);
+        if (!negated) return 0;
+        snprintf(mnemonic, sizeof(mnemonic), "j%s", negated);
+    } else {
+        return 0;
+    }
+    strcpy(jump->mnemonic, mnemonic);
+    removeAsmLine(program, cmp);
+    return 1;
+}
+
+// mov reg, 0 -> xor reg32, reg32 (azzera anche la parte alta)
+static int ruleMovZero(AsmProgram *program, AsmLine *line) {
+    (void) program;
+    if (!isInstr(line, "mov") || line->operandCount != 2) return 0;
+    if (!isReg64(line->operands[0]) || strcmp(line->operands[1], "0") != 0) return 0;
+    if (flagsLiveAfter(line)) return 0;
+    const char *reg32 = regs32[regFamily(line->operands[0])];
+    setAsmInstr(line, "xor", reg32, reg32);
+    return 1;
+}
+
+// jmp L / L:
+static int ruleJmpNext(AsmProgram *program, AsmLine *line) {
+    if (!isInstr(line, "jmp") || !fallsIntoLabel(line, line->operands[0])) return 0;
+    removeAsmLine(program, line);
+    return 1;
+}
+
+// jcc A / jmp B / A: -> jncc B
+static int ruleJccOverJmp(AsmProgram *program, AsmLine *line) {
+    AsmLine *next = line->next;
+    if (!isCondJump(line) || !isInstr(next, "jmp")) return 0;
+    if (!fallsIntoLabel(next, line->operands[0])) return 0;
+    const char *negated = negateCondition(line->mnemonic + 1);
+    if (!negated) return 0;
+    char mnemonic[MAX_ASM_MNEMONIC];
+    snprintf(mnemonic, sizeof(mnemonic), "j%s", negated);
+    setAsmInstr(line, mnemonic, next->operands[0], NULL);
+    removeAsmLine(program, next);
+    return 1;
+}
+
+static _Thread_local PeepholeRule rules[] = {
+    { "mov-self",      ruleMovSelf,      0 },
+    { "mov-back",      ruleMovBack,      0 },
+    { "push-pop",      rulePushPop,      0 },
+    { "push-pop-dead", rulePushPopDead,  0 },
+    { "cmp-branch",    ruleCmpBranch,    0 },
+    { "jmp-next",      ruleJmpNext,      0 },
+    { "jcc-over-jmp",  ruleJccOverJmp,   0 },
+    { "mov-zero-xor",  ruleMovZero,      0 },
+};
+
+#define NUM_RULES ((int) (sizeof(rules) / sizeof(rules[0])))
+
+void optimizePeephole(AsmProgram *program) {
+    for (int r = 0; r < NUM_RULES; r++) rules[r].hits = 0;
+    instrBefore = program->instrCount;
+
+    AsmLine *line = program->first;
+    while (line) {
+        int applied = 0;
+        for (int r = 0; r < NUM_RULES && !applied; r++) {
+            // Le regole toccano solo line e le righe successive
+            AsmLine *resume = line->prev;
+            if (rules[r].apply(program, line)) {
+                rules[r].hits++;
+                applied = 1;
+                line = resume ? resume : program->first;
+            }
+        }
+        if (!applied) line = line->next;
+    }
+
+    instrAfter = program->instrCount;
+}
+
+void printPeepholeStats(FILE *out) {
+    for (int r = 0; r < NUM_RULES; r++) {
+        fprintf(out, "%-14s %d\n", rules[r].name, rules[r].hits);
+    }
+    fprintf(out, "Istruzioni: %d -> %d\n", instrBefore, instrAfter);
+}
+
+void printPeepholeStatsJSON(FILE *out) {
+    fputs("{\"rules\": {", out);
+    for (int r = 0; r < NUM_RULES; r++) {
+        fprintf(out, "%s\"%s\": %d", r ? ", " : "", rules[r].name, rules[r].hits);
+    }
+    fprintf(out, "}, \"instructions_before\": %d, \"instructions_after\": %d}", instrBefore, instrAfter);
+}
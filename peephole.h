@@ -0,0 +1,16 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <stdio.h>
+#include "asm.h"
+
+// Ottimizzazione a finestra sul programma assembly in memoria. Le regole sono
+// in una tabella e vengono riapplicate finché qualcuna scatta.
+void optimizePeephole(AsmProgram *program);
+
+// Quante volte è scattata ogni regola nell'ultima esecuzione
+void printPeepholeStats(FILE *out);
+// Le stesse statistiche come oggetto JSON
+void printPeepholeStatsJSON(FILE *out);
+
+#endif // PEEPHOLE_H
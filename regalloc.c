@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "regalloc.h"
+#include "ir.h"
+
+static const char *regNames64[NUM_ALLOC_REGS] = {
+    "rax", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10"
+};
+
+static const char *regNames8[NUM_ALLOC_REGS] = {
+    "al", "cl", "dl", "sil", "dil", "r8b", "r9b", "r10b"
+};
+
+const char* regName(int reg) {
+    return (reg >= 0 && reg < NUM_ALLOC_REGS) ? regNames64[reg] : REG_SCRATCH;
+}
+
+const char* regName8(int reg) {
+    return (reg >= 0 && reg < NUM_ALLOC_REGS) ? regNames8[reg] : "r11b";
+}
+
+static _Thread_local LiveInterval *sortBase;
+
+static int compareStart(const void *a, const void *b) {
+    const LiveInterval *x = &sortBase[*(const int*)a];
+    const LiveInterval *y = &sortBase[*(const int*)b];
+    if (x->start != y->start) return x->start - y->start;
+    return *(const int*)a - *(const int*)b;
+}
+
+static int assignSlot(int *slotEnd, int *slotCount, int start, int end) {
+    for (int s = 0; s < *slotCount; s++) {
+        if (slotEnd[s] < start) {
+            slotEnd[s] = end;
+            return s;
+        }
+    }
+    slotEnd[*slotCount] = end;
+    return (*slotCount)++;
+}
+
+int linearScan(LiveInterval *intervals, int count, int numRegs) {
+    if (count <= 0) return 0;
+    if (numRegs > NUM_ALLOC_REGS) numRegs = NUM_ALLOC_REGS;
+
+    int *order = malloc(sizeof(int) * count);
+    int *active = malloc(sizeof(int) * (numRegs + 1));
+    int *slotEnd = malloc(sizeof(int) * count);
+    int freeRegs[NUM_ALLOC_REGS];
+    int activeCount = 0, slotCount = 0;
+
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+        intervals[i].reg = REG_NONE;
+        intervals[i].spillSlot = -1;
+    }
+    for (int r = 0; r < numRegs; r++) freeRegs[r] = 1;
+    sortBase = intervals;
+    qsort(order, count, sizeof(int), compareStart);
+
+    for (int k = 0; k < count; k++) {
+        LiveInterval *cur = &intervals[order[k]];
+        if (cur->start > cur->end) continue;
+
+        // Libera i registri degli intervalli già terminati
+        int kept = 0;
+        for (int a = 0; a < activeCount; a++) {
+            LiveInterval *iv = &intervals[active[a]];
+            if (iv->end < cur->start) freeRegs[iv->reg] = 1;
+            else active[kept++] = active[a];
+        }
+        activeCount = kept;
+
+        int reg = REG_NONE;
+        if (cur->hint >= 0) {
+            int wanted = intervals[cur->hint].reg;
+            if (wanted != REG_NONE && wanted < numRegs && freeRegs[wanted]) reg = wanted;
+        }
+        for (int r = 0; r < numRegs && reg == REG_NONE; r++) {
+            if (freeRegs[r]) reg = r;
+        }
+
+        if (reg == REG_NONE) {
+            // Nessun registro libero: va in spill chi termina più tardi
+            int victim = 0;
+            for (int a = 1; a < activeCount; a++) {
+                if (intervals[active[a]].end > intervals[active[victim]].end) victim = a;
+            }
+            LiveInterval *v = &intervals[active[victim]];
+            if (v->end > cur->end) {
+                cur->reg = v->reg;
+                v->reg = REG_NONE;
+                v->spillSlot = assignSlot(slotEnd, &slotCount, v->start, v->end);
+                active[victim] = order[k];
+            } else {
+                cur->spillSlot = assignSlot(slotEnd, &slotCount, cur->start, cur->end);
+            }
+            continue;
+        }
+
+        freeRegs[reg] = 0;
+        cur->reg = reg;
+        active[activeCount++] = order[k];
+    }
+
+    free(order);
+    free(active);
+    free(slotEnd);
+    return slotCount;
+}
+
+// ---------- ALLOCAZIONE SULL'IR ----------
+
+typedef struct {
+    uint64_t *liveIn, *liveOut, *use, *def;
+} BlockLiveness;
+
+static _Thread_local int words;
+
+static int testBit(uint64_t *set, int v) {
+    return (set[v >> 6] >> (v & 63)) & 1;
+}
+
+static void setBit(uint64_t *set, int v) {
+    set[v >> 6] |= (uint64_t) 1 << (v & 63);
+}
+
+static void clearBit(uint64_t *set, int v) {
+    set[v >> 6] &= ~((uint64_t) 1 << (v & 63));
+}
+
+static void extend(LiveInterval *iv, int pos) {
+    if (pos < iv->start) iv->start = pos;
+    if (pos > iv->end) iv->end = pos;
+}
+
+static void addUse(BlockLiveness *bl, IRValue v) {
+    if (v.kind == IRV_VREG && !testBit(bl->def, (int) v.value)) setBit(bl->use, (int) v.value);
+}
+
+void allocateRegisters(IRFunction *fn) {
+    int n = fn->vregCount;
+    words = (n + 63) / 64 + 1;
+    BlockLiveness *live = calloc(fn->blockCount, sizeof(BlockLiveness));
+    int *firstIndex = malloc(sizeof(int) * (fn->blockCount + 1));
+
+    int index = 0;
+    for (int i = 0; i < fn->blockCount; i++) {
+        BlockLiveness *bl = &live[i];
+        bl->liveIn = calloc(words, sizeof(uint64_t));
+        bl->liveOut = calloc(words, sizeof(uint64_t));
+        bl->use = calloc(words, sizeof(uint64_t));
+        bl->def = calloc(words, sizeof(uint64_t));
+        firstIndex[i] = index;
+        for (IRInstr *in = fn->blocks[i]->first; in; in = in->next) {
+            addUse(bl, in->a);
+            addUse(bl, in->b);
+            if (in->dst >= 0) setBit(bl->def, in->dst);
+            index++;
+        }
+    }
+    firstIndex[fn->blockCount] = index;
+
+    // Liveness all'indietro fino al punto fisso
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = fn->blockCount - 1; i >= 0; i--) {
+            IRBlock *b = fn->blocks[i];
+            BlockLiveness *bl = &live[i];
+            for (int w = 0; w < words; w++) {
+                uint64_t out = 0;
+                for (int s = 0; s < b->succCount; s++) out |= live[b->succs[s]->rpoIndex].liveIn[w];
+                uint64_t in = bl->use[w] | (out & ~bl->def[w]);
+                if (out != bl->liveOut[w] || in != bl->liveIn[w]) changed = 1;
+                bl->liveOut[w] = out;
+                bl->liveIn[w] = in;
+            }
+        }
+    }
+
+    LiveInterval *intervals = malloc(sizeof(LiveInterval) * (n + 1));
+    for (int v = 0; v < n; v++) {
+        intervals[v].start = INT_MAX;
+        intervals[v].end = -1;
+        intervals[v].hint = -1;
+    }
+
+    uint64_t *current = malloc(sizeof(uint64_t) * words);
+    for (int i = 0; i < fn->blockCount; i++) {
+        BlockLiveness *bl = &live[i];
+        int blockStart = 2 * firstIndex[i];
+        int blockEnd = 2 * firstIndex[i + 1] - 1;
+        memcpy(current, bl->liveOut, sizeof(uint64_t) * words);
+        for (int v = 0; v < n; v++) {
+            if (testBit(current, v)) extend(&intervals[v], blockEnd);
+        }
+
+        int pos = firstIndex[i + 1] - 1;
+        for (IRInstr *in = fn->blocks[i]->last; in; in = in->prev, pos--) {
+            if (in->dst >= 0) {
+                extend(&intervals[in->dst], 2 * pos + 1);
+                clearBit(current, in->dst);
+                // Istruzioni a due indirizzi: conviene riusare il registro di a
+                if (in->a.kind == IRV_VREG && in->op != IR_CMP) intervals[in->dst].hint = (int) in->a.value;
+            }
+            IRValue ops[2] = { in->a, in->b };
+            for (int k = 0; k < 2; k++) {
+                if (ops[k].kind != IRV_VREG) continue;
+                extend(&intervals[ops[k].value], 2 * pos);
+                setBit(current, (int) ops[k].value);
+            }
+        }
+
+        for (int v = 0; v < n; v++) {
+            if (testBit(bl->liveIn, v)) extend(&intervals[v], blockStart);
+        }
+    }
+
+    fn->spillSlots = linearScan(intervals, n, NUM_ALLOC_REGS);
+    free(fn->intervals);
+    fn->intervals = intervals;
+
+    for (int i = 0; i < fn->blockCount; i++) {
+        free(live[i].liveIn);
+        free(live[i].liveOut);
+        free(live[i].use);
+        free(live[i].def);
+    }
+    free(live);
+    free(firstIndex);
+    free(current);
+}
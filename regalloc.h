@@ -0,0 +1,39 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+// Registri general-purpose caller-saved assegnabili ai temporanei.
+// r11 resta fuori dal pool: fa da scratch per gli operandi finiti in spill.
+typedef enum {
+    REG_RAX, REG_RCX, REG_RDX, REG_RSI, REG_RDI,
+    REG_R8, REG_R9, REG_R10,
+    NUM_ALLOC_REGS
+} AllocReg;
+
+#define REG_NONE    -1
+#define REG_SCRATCH "r11"
+
+typedef struct {
+    int start;      // posizione della definizione
+    int end;        // posizione dell'ultimo uso
+    int reg;        // registro assegnato, REG_NONE se in spill
+    int spillSlot;  // slot sullo stack (in qword), -1 se in registro
+    int hint;       // intervallo di cui riusare il registro se libero, -1 se nessuno
+} LiveInterval;
+
+struct IRFunction;
+
+const char* regName(int reg);
+const char* regName8(int reg);
+
+// Linear scan (Poletto-Sarkar): assegna un registro a ogni intervallo,
+// mandando in spill quello che termina più tardi quando i registri finiscono.
+// Restituisce il numero di slot di spill necessari.
+// Gli intervalli vuoti (start > end) vengono ignorati.
+int linearScan(LiveInterval *intervals, int count, int numRegs);
+
+// Calcola la liveness della funzione (già uscita dalla forma SSA), costruisce
+// un intervallo per vreg e li alloca. Ogni istruzione k usa gli operandi
+// alla posizione 2k e definisce il risultato alla posizione 2k+1.
+void allocateRegisters(struct IRFunction *fn);
+
+#endif // REGALLOC_H
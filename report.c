@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include "report.h"
+
+static double nowMilliseconds() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+void initReport(CompileReport *report) {
+    memset(report, 0, sizeof(CompileReport));
+    report->started = nowMilliseconds();
+}
+
+PhaseReport* endPhase(CompileReport *report, const char *name) {
+    if (!report) return NULL;
+    double now = nowMilliseconds();
+    // Oltre il limite l'ultima fase accumula le successive
+    PhaseReport *phase = &report->phases[report->phaseCount < MAX_PHASES ? report->phaseCount++ : MAX_PHASES - 1];
+    phase->name = name;
+    phase->milliseconds = now - report->started;
+    phase->counterCount = 0;
+
+    // mallinfo2 scorre le arene di glibc: il costo resta fuori dalla fase
+    struct mallinfo2 heap = mallinfo2();
+    phase->heapBytes = (long long) (heap.uordblks + heap.hblkhd);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    phase->peakResidentBytes = (long long) usage.ru_maxrss * 1024;
+    report->started = nowMilliseconds();
+    return phase;
+}
+
+void addPhaseCounter(PhaseReport *phase, const char *name, long long value) {
+    if (!phase || phase->counterCount == MAX_PHASE_COUNTERS) return;
+    phase->counters[phase->counterCount].name = name;
+    phase->counters[phase->counterCount].value = value;
+    phase->counterCount++;
+}
+
+double totalMilliseconds(const CompileReport *report) {
+    double total = 0;
+    for (int i = 0; i < report->phaseCount; i++) total += report->phases[i].milliseconds;
+    return total;
+}
+
+void printReport(const CompileReport *report, FILE *out) {
+    fprintf(out, "%-14s %10s %10s %10s  %s\n", "Fase", "ms", "heap KiB", "RSS KiB", "contatori");
+    for (int i = 0; i < report->phaseCount; i++) {
+        const PhaseReport *phase = &report->phases[i];
+        fprintf(out, "%-14s %10.3f %10lld %10lld ", phase->name, phase->milliseconds,
+                phase->heapBytes / 1024, phase->peakResidentBytes / 1024);
+        for (int c = 0; c < phase->counterCount; c++) {
+            fprintf(out, " %s=%lld", phase->counters[c].name, phase->counters[c].value);
+        }
+        fputc('\n', out);
+    }
+    fprintf(out, "%-14s %10.3f\n", "Totale", totalMilliseconds(report));
+}
+
+void printJSONString(const char *text, FILE *out) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char*) text; *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf(out, "\\%c", *p);
+        else if (*p < 0x20) fprintf(out, "\\u%04x", *p);
+        else fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+void printReportPhasesJSON(const CompileReport *report, FILE *out) {
+    fputc('[', out);
+    for (int i = 0; i < report->phaseCount; i++) {
+        const PhaseReport *phase = &report->phases[i];
+        fprintf(out, "%s{\"name\": ", i ? ", " : "");
+        printJSONString(phase->name, out);
+        fprintf(out, ", \"ms\": %.3f, \"heap_bytes\": %lld, \"peak_rss_bytes\": %lld",
+                phase->milliseconds, phase->heapBytes, phase->peakResidentBytes);
+        for (int c = 0; c < phase->counterCount; c++) {
+            fprintf(out, ", \"%s\": %lld", phase->counters[c].name, phase->counters[c].value);
+        }
+        fputc('}', out);
+    }
+    fputc(']', out);
+}
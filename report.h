@@ -0,0 +1,48 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdio.h>
+
+// Tempi e contatori delle fasi di una compilazione (--time-report,
+// --stats=json). Per ogni fase: tempo reale, fino a tre contatori (token,
+// nodi, istruzioni, byte...), heap allocato alla fine della fase e picco
+// della memoria residente del processo fino a quel momento. Lo heap è
+// misurato su tutto il processo: il report ha senso con un solo sorgente.
+
+#define MAX_PHASES 16
+#define MAX_PHASE_COUNTERS 3
+
+typedef struct {
+    const char *name;
+    long long value;
+} PhaseCounter;
+
+typedef struct {
+    const char *name;
+    double milliseconds;
+    PhaseCounter counters[MAX_PHASE_COUNTERS];
+    int counterCount;
+    long long heapBytes;
+    long long peakResidentBytes;
+} PhaseReport;
+
+typedef struct {
+    PhaseReport phases[MAX_PHASES];
+    int phaseCount;
+    double started;             // inizio della fase corrente
+} CompileReport;
+
+void initReport(CompileReport *report);
+// Chiude la fase iniziata alla chiusura della precedente (o a initReport).
+// Con report NULL non misura nulla e restituisce NULL, che addPhaseCounter
+// ignora: le fasi si annotano senza controllare se il report è richiesto.
+PhaseReport* endPhase(CompileReport *report, const char *name);
+void addPhaseCounter(PhaseReport *phase, const char *name, long long value);
+double totalMilliseconds(const CompileReport *report);
+
+void printReport(const CompileReport *report, FILE *out);
+// Solo l'array delle fasi: il chiamante compone l'oggetto JSON completo
+void printReportPhasesJSON(const CompileReport *report, FILE *out);
+void printJSONString(const char *text, FILE *out);
+
+#endif // REPORT_H
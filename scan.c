@@ -0,0 +1,251 @@
+#include <stdint.h>
+#include "scan.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// I blocchi si leggono solo a indirizzi allineati alla loro dimensione: un
+// blocco non attraversa mai il confine di una pagina, quindi i byte letti
+// oltre il '\0' finale non possono causare fault. I bit dei byte che
+// precedono il puntatore vengono scartati con uno shift.
+
+// ---------- SCALARE ----------
+
+static int isIdentByte(unsigned char c) {
+    return (unsigned char) ((c | 0x20) - 'a') < 26 || (unsigned char) (c - '0') < 10 || c == '_';
+}
+
+static int isSpaceByte(unsigned char c) {
+    return c == ' ' || (unsigned char) (c - '\t') < 5;     // \t \n \v \f \r
+}
+
+static const char* skipIdentScalar(const char *p) {
+    while (isIdentByte(*p)) p++;
+    return p;
+}
+
+static const char* skipStringScalar(const char *p) {
+    while (*p && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+static const char* skipSpacesScalar(const char *p, int *line, int *pos) {
+    while (isSpaceByte(*p)) {
+        if (*p == '\n') {
+            (*line)++;
+            *pos = 1;
+        } else (*pos)++;
+        p++;
+    }
+    return p;
+}
+
+#ifdef SCAN_X86
+
+// Avanza sugli spazi di un blocco di width byte a partire da *p. stop ha un
+// bit per ogni byte che non è spazio, newline per ogni '\n'. Restituisce 1
+// se la sequenza di spazi finisce nel blocco.
+static inline int consumeSpaces(const char **p, uint32_t stop, uint32_t newline, int width,
+                                int *line, int *pos) {
+    int run = stop ? __builtin_ctz(stop) : width;
+    uint32_t inRun = run >= 32 ? newline : newline & ((1u << run) - 1);
+    if (inRun) {
+        int last = 31 - __builtin_clz(inRun);
+        *line += __builtin_popcount(inRun);
+        *pos = run - last;
+    } else {
+        *pos += run;
+    }
+    *p += run;
+    return stop != 0;
+}
+
+// ---------- SSE2 ----------
+
+// Confronto senza segno a < b sui byte, con i confronti con segno di SSE2
+static inline __m128i lessThanSSE2(__m128i a, char b) {
+    __m128i bias = _mm_set1_epi8((char) 0x80);
+    return _mm_cmplt_epi8(_mm_xor_si128(a, bias), _mm_set1_epi8((char) (b ^ 0x80)));
+}
+
+static inline uint32_t identMaskSSE2(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = lessThanSSE2(_mm_sub_epi8(lower, _mm_set1_epi8('a')), 26);
+    __m128i digit = lessThanSSE2(_mm_sub_epi8(v, _mm_set1_epi8('0')), 10);
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+
+static inline uint32_t stringStopMaskSSE2(__m128i v) {
+    __m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+    __m128i slash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+    __m128i end = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, slash), end));
+}
+
+static inline uint32_t spaceMaskSSE2(__m128i v) {
+    __m128i ctrl = lessThanSSE2(_mm_sub_epi8(v, _mm_set1_epi8('\t')), 5);
+    __m128i blank = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    return _mm_movemask_epi8(_mm_or_si128(ctrl, blank));
+}
+
+static const char* skipIdentSSE2(const char *p) {
+    int offset = (int) ((uintptr_t) p & 15);
+    const char *block = p - offset;
+    uint32_t stop = (~identMaskSSE2(_mm_load_si128((const __m128i*) block)) & 0xFFFF) >> offset;
+    if (stop) return p + __builtin_ctz(stop);
+    for (;;) {
+        block += 16;
+        stop = ~identMaskSSE2(_mm_load_si128((const __m128i*) block)) & 0xFFFF;
+        if (stop) return block + __builtin_ctz(stop);
+    }
+}
+
+static const char* skipStringSSE2(const char *p) {
+    int offset = (int) ((uintptr_t) p & 15);
+    const char *block = p - offset;
+    uint32_t stop = stringStopMaskSSE2(_mm_load_si128((const __m128i*) block)) >> offset;
+    if (stop) return p + __builtin_ctz(stop);
+    for (;;) {
+        block += 16;
+        stop = stringStopMaskSSE2(_mm_load_si128((const __m128i*) block));
+        if (stop) return block + __builtin_ctz(stop);
+    }
+}
+
+static const char* skipSpacesSSE2(const char *p, int *line, int *pos) {
+    int offset = (int) ((uintptr_t) p & 15);
+    const char *block = p - offset;
+    __m128i v = _mm_load_si128((const __m128i*) block);
+    uint32_t stop = (~spaceMaskSSE2(v) & 0xFFFF) >> offset;
+    uint32_t newline = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))) >> offset;
+    if (consumeSpaces(&p, stop, newline, 16 - offset, line, pos)) return p;
+    for (;;) {
+        v = _mm_load_si128((const __m128i*) p);
+        stop = ~spaceMaskSSE2(v) & 0xFFFF;
+        newline = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if (consumeSpaces(&p, stop, newline, 16, line, pos)) return p;
+    }
+}
+
+// ---------- AVX2 ----------
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i lessThanAVX2(__m256i a, char b) {
+    __m256i bias = _mm256_set1_epi8((char) 0x80);
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (b ^ 0x80)), _mm256_xor_si256(a, bias));
+}
+
+AVX2 static inline uint32_t identMaskAVX2(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = lessThanAVX2(_mm256_sub_epi8(lower, _mm256_set1_epi8('a')), 26);
+    __m256i digit = lessThanAVX2(_mm256_sub_epi8(v, _mm256_set1_epi8('0')), 10);
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+}
+
+AVX2 static inline uint32_t stringStopMaskAVX2(__m256i v) {
+    __m256i quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+    __m256i slash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+    __m256i end = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+    return (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(quote, slash), end));
+}
+
+AVX2 static inline uint32_t spaceMaskAVX2(__m256i v) {
+    __m256i ctrl = lessThanAVX2(_mm256_sub_epi8(v, _mm256_set1_epi8('\t')), 5);
+    __m256i blank = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    return (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(ctrl, blank));
+}
+
+AVX2 static const char* skipIdentAVX2(const char *p) {
+    int offset = (int) ((uintptr_t) p & 31);
+    const char *block = p - offset;
+    uint32_t stop = ~identMaskAVX2(_mm256_load_si256((const __m256i*) block)) >> offset;
+    if (stop) return p + __builtin_ctz(stop);
+    for (;;) {
+        block += 32;
+        stop = ~identMaskAVX2(_mm256_load_si256((const __m256i*) block));
+        if (stop) return block + __builtin_ctz(stop);
+    }
+}
+
+AVX2 static const char* skipStringAVX2(const char *p) {
+    int offset = (int) ((uintptr_t) p & 31);
+    const char *block = p - offset;
+    uint32_t stop = stringStopMaskAVX2(_mm256_load_si256((const __m256i*) block)) >> offset;
+    if (stop) return p + __builtin_ctz(stop);
+    for (;;) {
+        block += 32;
+        stop = stringStopMaskAVX2(_mm256_load_si256((const __m256i*) block));
+        if (stop) return block + __builtin_ctz(stop);
+    }
+}
+
+AVX2 static const char* skipSpacesAVX2(const char *p, int *line, int *pos) {
+    int offset = (int) ((uintptr_t) p & 31);
+    const char *block = p - offset;
+    __m256i v = _mm256_load_si256((const __m256i*) block);
+    uint32_t stop = ~spaceMaskAVX2(v) >> offset;
+    uint32_t newline = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))) >> offset;
+    if (consumeSpaces(&p, stop, newline, 32 - offset, line, pos)) return p;
+    for (;;) {
+        v = _mm256_load_si256((const __m256i*) p);
+        stop = ~spaceMaskAVX2(v);
+        newline = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        if (consumeSpaces(&p, stop, newline, 32, line, pos)) return p;
+    }
+}
+
+#endif // SCAN_X86
+
+// ---------- DISPATCH ----------
+
+const char* (*skipIdentChars)(const char *p) = skipIdentScalar;
+const char* (*skipStringChars)(const char *p) = skipStringScalar;
+const char* (*skipSpaces)(const char *p, int *line, int *pos) = skipSpacesScalar;
+
+static ScanPath currentPath = SCAN_SCALAR;
+static int pathChosen = 0;
+
+int setScanPath(ScanPath path) {
+    switch (path) {
+        case SCAN_SCALAR:
+            skipIdentChars = skipIdentScalar;
+            skipStringChars = skipStringScalar;
+            skipSpaces = skipSpacesScalar;
+            break;
+#ifdef SCAN_X86
+        case SCAN_SSE2:
+            // SSE2 fa parte dell'ABI x86-64
+            skipIdentChars = skipIdentSSE2;
+            skipStringChars = skipStringSSE2;
+            skipSpaces = skipSpacesSSE2;
+            break;
+        case SCAN_AVX2:
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("avx2")) return 0;
+            skipIdentChars = skipIdentAVX2;
+            skipStringChars = skipStringAVX2;
+            skipSpaces = skipSpacesAVX2;
+            break;
+#endif
+        default:
+            return 0;
+    }
+    currentPath = path;
+    pathChosen = 1;
+    return 1;
+}
+
+void initScan() {
+    if (pathChosen) return;
+    if (!setScanPath(SCAN_AVX2) && !setScanPath(SCAN_SSE2)) setScanPath(SCAN_SCALAR);
+}
+
+const char* scanPathName() {
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    return names[currentPath];
+}
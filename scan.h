@@ -0,0 +1,24 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+// Scansione di sequenze di caratteri per il lexer, 16 o 32 byte alla volta
+// dove la CPU lo consente. Tutti i percorsi danno lo stesso risultato.
+
+typedef enum {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+} ScanPath;
+
+void initScan();                    // sceglie il percorso migliore per la CPU
+int setScanPath(ScanPath path);     // 0 se la CPU non lo supporta
+const char* scanPathName();
+
+// Primo carattere che non è [A-Za-z0-9_]
+extern const char* (*skipIdentChars)(const char *p);
+// Primo '"', '\\' o fine del sorgente
+extern const char* (*skipStringChars)(const char *p);
+// Primo carattere che non è spazio; aggiorna riga e colonna
+extern const char* (*skipSpaces)(const char *p, int *line, int *pos);
+
+#endif // SCAN_H
@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ssa.h"
+
+typedef struct {
+    int *items;
+    int count, cap;
+} IntList;
+
+static void pushInt(IntList *list, int v) {
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 4;
+        list->items = realloc(list->items, sizeof(int) * list->cap);
+    }
+    list->items[list->count++] = v;
+}
+
+// ---------- COSTRUZIONE ----------
+
+static _Thread_local IRFunction *fn;
+static _Thread_local IntList *frontiers;      // per rpoIndex: frontiera di dominanza
+static _Thread_local IntList *stacks;         // per vreg: nomi correnti durante la rinomina
+static _Thread_local char *isVariable;        // vreg con più definizioni
+static _Thread_local int originalCount;       // vreg esistenti prima della rinomina
+
+static void computeFrontiers() {
+    frontiers = calloc(fn->blockCount, sizeof(IntList));
+    for (int i = 0; i < fn->blockCount; i++) {
+        IRBlock *b = fn->blocks[i];
+        if (b->predCount < 2) continue;
+        for (int p = 0; p < b->predCount; p++) {
+            IRBlock *runner = b->preds[p];
+            while (runner != b->idom) {
+                IntList *df = &frontiers[runner->rpoIndex];
+                if (df->count == 0 || df->items[df->count - 1] != i) pushInt(df, i);
+                runner = runner->idom;
+            }
+        }
+    }
+}
+
+static void insertPhis() {
+    int varCount = fn->vregCount;
+    IntList *defBlocks = calloc(varCount, sizeof(IntList));
+    int *defCount = calloc(varCount, sizeof(int));
+
+    for (int i = 0; i < fn->blockCount; i++) {
+        for (IRInstr *in = fn->blocks[i]->first; in; in = in->next) {
+            if (in->dst < 0) continue;
+            defCount[in->dst]++;
+            IntList *l = &defBlocks[in->dst];
+            if (l->count == 0 || l->items[l->count - 1] != i) pushInt(l, i);
+        }
+    }
+
+    isVariable = calloc(varCount, 1);
+    int *hasPhi = malloc(sizeof(int) * fn->blockCount);
+    int *onList = malloc(sizeof(int) * fn->blockCount);
+    for (int i = 0; i < fn->blockCount; i++) hasPhi[i] = onList[i] = -1;
+
+    for (int v = 0; v < varCount; v++) {
+        if (defCount[v] < 2) continue;
+        isVariable[v] = 1;
+
+        IntList work = { NULL, 0, 0 };
+        for (int k = 0; k < defBlocks[v].count; k++) {
+            pushInt(&work, defBlocks[v].items[k]);
+            onList[defBlocks[v].items[k]] = v;
+        }
+        while (work.count > 0) {
+            int b = work.items[--work.count];
+            IntList *df = &frontiers[b];
+            for (int k = 0; k < df->count; k++) {
+                int d = df->items[k];
+                if (hasPhi[d] == v) continue;
+                hasPhi[d] = v;
+
+                IRBlock *block = fn->blocks[d];
+                IRInstr *phi = createIRInstr(IR_PHI);
+                phi->dst = v;
+                phi->phiVar = v;
+                phi->phiArgs = calloc(block->predCount, sizeof(IRValue));
+                if (block->first) insertIRInstrBefore(block->first, phi);
+                else appendIRInstr(block, phi);
+
+                if (onList[d] != v) {
+                    onList[d] = v;
+                    pushInt(&work, d);
+                }
+            }
+        }
+        free(work.items);
+    }
+
+    for (int v = 0; v < varCount; v++) free(defBlocks[v].items);
+    free(defBlocks);
+    free(defCount);
+    free(hasPhi);
+    free(onList);
+}
+
+static int currentName(int v) {
+    if (v < originalCount && stacks[v].count > 0) return stacks[v].items[stacks[v].count - 1];
+    return v;
+}
+
+static void renameUse(IRValue *value) {
+    if (value->kind == IRV_VREG) value->value = currentName((int) value->value);
+}
+
+static void renameBlock(IRBlock *block) {
+    IntList pushed = { NULL, 0, 0 };
+
+    IRInstr *in = block->first;
+    while (in) {
+        IRInstr *next = in->next;
+        if (in->op != IR_PHI) {
+            renameUse(&in->a);
+            renameUse(&in->b);
+        }
+        if (in->dst >= 0) {
+            int v = in->dst;
+            if (in->op == IR_COPY && in->a.kind == IRV_VREG) {
+                // Copia eliminata: il nome corrente diventa la sorgente
+                pushInt(&stacks[v], (int) in->a.value);
+                pushInt(&pushed, v);
+                removeIRInstr(in);
+                in = next;
+                continue;
+            }
+            if (in->op == IR_COPY) in->op = IR_CONST;
+            if (isVariable[v]) {
+                in->dst = newVreg(fn);
+                pushInt(&stacks[v], in->dst);
+                pushInt(&pushed, v);
+            }
+        }
+        in = next;
+    }
+
+    for (int s = 0; s < block->succCount; s++) {
+        IRBlock *succ = block->succs[s];
+        for (int p = 0; p < succ->predCount; p++) {
+            if (succ->preds[p] != block) continue;
+            for (IRInstr *phi = succ->first; phi && phi->op == IR_PHI; phi = phi->next) {
+                IntList *st = &stacks[phi->phiVar];
+                // Variabile non definita su questo cammino
+                phi->phiArgs[p] = st->count > 0 ? irVreg(st->items[st->count - 1]) : irImm(0);
+            }
+        }
+    }
+
+    for (int c = 0; c < block->domChildCount; c++) {
+        renameBlock(block->domChildren[c]);
+    }
+
+    for (int i = pushed.count - 1; i >= 0; i--) stacks[pushed.items[i]].count--;
+    free(pushed.items);
+}
+
+static IRValue resolve(IRValue *replace, IRValue v) {
+    while (v.kind == IRV_VREG && !sameValue(replace[v.value], v)) v = replace[v.value];
+    return v;
+}
+
+// Elimina i phi banali (un solo valore oltre a se stessi) e quelli inutilizzati
+static void simplifyPhis() {
+    int n = fn->vregCount;
+    IRValue *replace = malloc(sizeof(IRValue) * n);
+    for (int v = 0; v < n; v++) replace[v] = irVreg(v);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        int *uses = calloc(n, sizeof(int));
+        for (int i = 0; i < fn->blockCount; i++) {
+            for (IRInstr *in = fn->blocks[i]->first; in; in = in->next) {
+                if (in->a.kind == IRV_VREG) uses[in->a.value]++;
+                if (in->b.kind == IRV_VREG) uses[in->b.value]++;
+                if (in->op != IR_PHI) continue;
+                for (int p = 0; p < in->block->predCount; p++) {
+                    if (in->phiArgs[p].kind == IRV_VREG && in->phiArgs[p].value != in->dst) {
+                        uses[in->phiArgs[p].value]++;
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < fn->blockCount; i++) {
+            IRInstr *in = fn->blocks[i]->first;
+            while (in && in->op == IR_PHI) {
+                IRInstr *next = in->next;
+                IRValue unique = { IRV_NONE, 0 };
+                int trivial = 1;
+                for (int p = 0; p < in->block->predCount; p++) {
+                    IRValue arg = in->phiArgs[p];
+                    if (arg.kind == IRV_VREG && arg.value == in->dst) continue;
+                    if (unique.kind == IRV_NONE) unique = arg;
+                    else if (!sameValue(unique, arg)) trivial = 0;
+                }
+                if (trivial && unique.kind == IRV_VREG) {
+                    unique = resolve(replace, unique);
+                    if (unique.kind == IRV_VREG && unique.value == in->dst) trivial = 0;
+                }
+                if (uses[in->dst] == 0 || (trivial && unique.kind == IRV_VREG)) {
+                    if (uses[in->dst] > 0) replace[in->dst] = unique;
+                    removeIRInstr(in);
+                    changed = 1;
+                }
+                in = next;
+            }
+        }
+        free(uses);
+
+        // Propaga le sostituzioni (anche a catena)
+        for (int i = 0; i < fn->blockCount; i++) {
+            for (IRInstr *in = fn->blocks[i]->first; in; in = in->next) {
+                in->a = resolve(replace, in->a);
+                in->b = resolve(replace, in->b);
+                if (in->op != IR_PHI) continue;
+                for (int p = 0; p < in->block->predCount; p++) {
+                    in->phiArgs[p] = resolve(replace, in->phiArgs[p]);
+                }
+            }
+        }
+    }
+    free(replace);
+}
+
+void constructSSA(IRFunction *function) {
+    fn = function;
+    computeDominators(fn);
+    computeFrontiers();
+    insertPhis();
+
+    originalCount = fn->vregCount;
+    stacks = calloc(originalCount, sizeof(IntList));
+    renameBlock(fn->blocks[0]);
+
+    for (int v = 0; v < originalCount; v++) free(stacks[v].items);
+    for (int i = 0; i < fn->blockCount; i++) free(frontiers[i].items);
+    free(stacks);
+    free(frontiers);
+    free(isVariable);
+
+    simplifyPhis();
+}
+
+// ---------- CODICE MORTO ----------
+
+// Istruzioni che si possono togliere se il risultato non serve. Divisione e
+// modulo restano se possono fallire a runtime (divisore zero o -1 ignoto).
+static int isRemovable(IRInstr *in) {
+    switch (in->op) {
+        case IR_CONST: case IR_COPY: case IR_LOAD: case IR_ADD: case IR_SUB:
+        case IR_MUL: case IR_NEG: case IR_CMP: case IR_PHI:
+            return 1;
+        case IR_DIV: case IR_MOD:
+            return in->b.kind == IRV_IMM && in->b.value != 0 && in->b.value != -1;
+        default:
+            return 0;
+    }
+}
+
+static void countUse(int *uses, IRValue value, int delta) {
+    if (value.kind == IRV_VREG) uses[value.value] += delta;
+}
+
+// Applica delta agli usi degli operandi di in (un phi non conta se stesso)
+static void countOperands(int *uses, IRInstr *in, int delta) {
+    countUse(uses, in->a, delta);
+    countUse(uses, in->b, delta);
+    if (in->op != IR_PHI) return;
+    for (int p = 0; p < in->block->predCount; p++) {
+        if (in->phiArgs[p].kind == IRV_VREG && in->phiArgs[p].value == in->dst) continue;
+        countUse(uses, in->phiArgs[p], delta);
+    }
+}
+
+int removeDeadCode(IRFunction *function) {
+    int n = function->vregCount;
+    int *uses = calloc(n, sizeof(int));
+    IRInstr **defs = calloc(n, sizeof(IRInstr*));
+    for (int i = 0; i < function->blockCount; i++) {
+        for (IRInstr *in = function->blocks[i]->first; in; in = in->next) {
+            countOperands(uses, in, 1);
+            if (in->dst >= 0) defs[in->dst] = in;
+        }
+    }
+
+    // Vreg da controllare: all'inizio tutti, poi gli operandi delle
+    // istruzioni rimosse
+    IntList work = { NULL, 0, 0 };
+    for (int v = n - 1; v >= 0; v--) {
+        if (defs[v]) pushInt(&work, v);
+    }
+
+    int removed = 0;
+    while (work.count > 0) {
+        int v = work.items[--work.count];
+        IRInstr *in = defs[v];
+        if (!in || uses[v] > 0 || !isRemovable(in)) continue;
+        countOperands(uses, in, -1);
+        if (in->a.kind == IRV_VREG) pushInt(&work, (int) in->a.value);
+        if (in->b.kind == IRV_VREG) pushInt(&work, (int) in->b.value);
+        if (in->op == IR_PHI) {
+            for (int p = 0; p < in->block->predCount; p++) {
+                if (in->phiArgs[p].kind == IRV_VREG) pushInt(&work, (int) in->phiArgs[p].value);
+            }
+        }
+        defs[v] = NULL;
+        removeIRInstr(in);
+        removed++;
+    }
+
+    free(work.items);
+    free(defs);
+    free(uses);
+    return removed;
+}
+
+// ---------- DISTRUZIONE ----------
+
+static void emitCopyBefore(IRInstr *pos, int dst, IRValue src) {
+    IRInstr *copy = createIRInstr(src.kind == IRV_IMM ? IR_CONST : IR_COPY);
+    copy->dst = dst;
+    copy->a = src;
+    insertIRInstrBefore(pos, copy);
+}
+
+// Serializza una copia parallela prima di pos; i cicli vengono spezzati con
+// un vreg temporaneo
+static void sequentializeCopies(IRInstr *pos, int *dsts, IRValue *srcs, int count) {
+    int pending = 0;
+    for (int i = 0; i < count; i++) {
+        if (srcs[i].kind == IRV_VREG && srcs[i].value == dsts[i]) continue;
+        dsts[pending] = dsts[i];
+        srcs[pending] = srcs[i];
+        pending++;
+    }
+
+    while (pending > 0) {
+        int ready = -1;
+        for (int i = 0; i < pending && ready < 0; i++) {
+            int blocked = 0;
+            for (int j = 0; j < pending; j++) {
+                if (j != i && srcs[j].kind == IRV_VREG && srcs[j].value == dsts[i]) {
+                    blocked = 1;
+                    break;
+                }
+            }
+            if (!blocked) ready = i;
+        }
+
+        if (ready >= 0) {
+            emitCopyBefore(pos, dsts[ready], srcs[ready]);
+            dsts[ready] = dsts[pending - 1];
+            srcs[ready] = srcs[pending - 1];
+            pending--;
+            continue;
+        }
+
+        // Tutte le copie rimaste formano cicli: salva una destinazione
+        int saved = newVreg(fn);
+        emitCopyBefore(pos, saved, irVreg(dsts[0]));
+        for (int j = 0; j < pending; j++) {
+            if (srcs[j].kind == IRV_VREG && srcs[j].value == dsts[0]) srcs[j] = irVreg(saved);
+        }
+    }
+}
+
+static int usesVreg(IRInstr *in, int vreg) {
+    return (in->a.kind == IRV_VREG && in->a.value == vreg) || (in->b.kind == IRV_VREG && in->b.value == vreg);
+}
+
+// Stima prudente: vreg è vivo sull'arco from -> start se un suo uso si
+// raggiunge senza ripassare da def, l'unico blocco che lo definisce (un phi in
+// SSA). Di un phi conta solo l'argomento dell'arco percorso.
+static int reachesUse(int vreg, IRBlock *from, IRBlock *start, IRBlock *def, char *visited) {
+    for (IRInstr *in = start->first; in && in->op == IR_PHI; in = in->next) {
+        for (int p = 0; p < start->predCount; p++) {
+            IRValue arg = in->phiArgs[p];
+            if (start->preds[p] == from && arg.kind == IRV_VREG && arg.value == vreg) return 1;
+        }
+    }
+    if (start == def || visited[start->id]) return 0;
+    visited[start->id] = 1;
+    for (IRInstr *in = start->first; in; in = in->next) {
+        if (in->op != IR_PHI && usesVreg(in, vreg)) return 1;
+    }
+    for (int s = 0; s < start->succCount; s++) {
+        if (reachesUse(vreg, start, start->succs[s], def, visited)) return 1;
+    }
+    return 0;
+}
+
+// Le copie di un arco critico pred -> block si possono fare in fondo a pred,
+// senza spezzare l'arco, se nessuna destinazione è viva nell'altro successore
+// e il salto non legge una destinazione. È il caso del salto all'indietro di
+// un ciclo ruotato: così il blocco intermedio non aggiunge un jmp per giro.
+static IRInstr* copiesInPredecessor(IRBlock *pred, IRBlock *block, int *dsts, IRValue *srcs, int count) {
+    IRInstr *branch = pred->last;
+    IRBlock *other = pred->succs[pred->succs[0] == block ? 1 : 0];
+    // Solo sull'arco all'indietro: le copie verso l'uscita conviene pagarle
+    // una volta, in un blocco intermedio, e non a ogni giro in fondo al corpo
+    if (other == block || block->rpoIndex > pred->rpoIndex) return NULL;
+    // Indicizzato per id: i blocchi degli archi già spezzati non hanno rpoIndex
+    char *visited = malloc(fn->nextBlockId);
+    int movable = 1;
+    for (int i = 0; i < count && movable; i++) {
+        if (usesVreg(branch, dsts[i])) movable = 0;
+        memset(visited, 0, fn->nextBlockId);
+        if (movable && reachesUse(dsts[i], pred, other, block, visited)) movable = 0;
+    }
+    free(visited);
+    if (!movable) return NULL;
+
+    // Prima del confronto che decide il salto, se possibile, perché il
+    // codegen possa ancora fonderli
+    IRInstr *compare = branch->prev;
+    if (!compare || compare->op != IR_CMP || branch->a.kind != IRV_VREG || branch->a.value != compare->dst) return branch;
+    for (int i = 0; i < count; i++) {
+        if (usesVreg(compare, dsts[i])) return branch;
+        if (srcs[i].kind == IRV_VREG && srcs[i].value == compare->dst) return branch;
+    }
+    return compare;
+}
+
+void destructSSA(IRFunction *function) {
+    fn = function;
+    int originalBlocks = fn->blockCount;
+
+    for (int i = 0; i < originalBlocks; i++) {
+        IRBlock *block = fn->blocks[i];
+        if (!block->first || block->first->op != IR_PHI) continue;
+
+        int phiCount = 0;
+        for (IRInstr *in = block->first; in && in->op == IR_PHI; in = in->next) phiCount++;
+        int *dsts = malloc(sizeof(int) * phiCount);
+        IRValue *srcs = malloc(sizeof(IRValue) * phiCount);
+
+        for (int p = 0; p < block->predCount; p++) {
+            IRBlock *pred = block->preds[p];
+            int k = 0;
+            for (IRInstr *in = block->first; in && in->op == IR_PHI; in = in->next) {
+                dsts[k] = in->dst;
+                srcs[k] = in->phiArgs[p];
+                k++;
+            }
+            IRInstr *pos = pred->last;
+            if (pred->succCount > 1) {
+                pos = copiesInPredecessor(pred, block, dsts, srcs, phiCount);
+                if (!pos) {
+                    // Arco critico: le copie vanno in un blocco intermedio
+                    int index = pred->succs[0] == block ? 0 : 1;
+                    pos = splitEdge(fn, pred, index)->last;
+                }
+            }
+            sequentializeCopies(pos, dsts, srcs, phiCount);
+        }
+
+        while (block->first && block->first->op == IR_PHI) removeIRInstr(block->first);
+        free(dsts);
+        free(srcs);
+    }
+
+    computeCFG(fn);
+}
@@ -0,0 +1,16 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include "ir.h"
+
+// Costruzione SSA (phi ai confini di dominanza, rinomina sull'albero dei
+// dominatori) e distruzione tramite copie parallele sui predecessori
+void constructSSA(IRFunction *fn);
+void destructSSA(IRFunction *fn);
+
+// Elimina le definizioni senza usi e senza effetti collaterali contando gli
+// usi di ogni vreg: togliere un'istruzione può lasciare senza usi i suoi
+// operandi. Da eseguire in forma SSA. Restituisce le istruzioni rimosse.
+int removeDeadCode(IRFunction *fn);
+
+#endif // SSA_H
@@ -1,45 +1,120 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "symbol_table.h"
+#include "intern.h"
 
 void initSymbolTable(SymbolTable *table) {
-    table->count = 0;
+    memset(table, 0, sizeof(SymbolTable));
 }
 
-bool insertSymbol(SymbolTable *table, Symbol symbol) {
-    // Controlla duplicati
-    for (int i = 0; i < table->count; i++) {
-        if (strcmp(table->symbols[i].name, symbol.name) == 0 &&
-            table->symbols[i].scope == symbol.scope) {
-            return false; // simbolo già esistente in questo scope
-        }
+void freeSymbolTable(SymbolTable *table) {
+    free(table->entries);
+    free(table->scopeStart);
+    free(table->slotSymbols);
+    free(table->slotHeads);
+    initSymbolTable(table);
+}
+
+// Hash moltiplicativo: gli ID sono interi densi, basta sparpagliarli
+static unsigned slotOf(int symbol, int cap) {
+    return ((unsigned) symbol * 2654435761u) & (cap - 1);
+}
+
+static int findSlot(SymbolTable *table, int symbol) {
+    unsigned s = slotOf(symbol, table->slotCap);
+    while (table->slotSymbols[s] != symbol && table->slotSymbols[s] != -1) {
+        s = (s + 1) & (table->slotCap - 1);
     }
-    if (table->count < MAX_SYMBOLS) {
-        table->symbols[table->count++] = symbol;
-        return true;
+    return s;
+}
+
+static void growSlots(SymbolTable *table) {
+    int oldCap = table->slotCap;
+    int *oldSymbols = table->slotSymbols;
+    int *oldHeads = table->slotHeads;
+
+    table->slotCap = oldCap ? oldCap * 2 : 64;
+    table->slotSymbols = malloc(sizeof(int) * table->slotCap);
+    table->slotHeads = malloc(sizeof(int) * table->slotCap);
+    memset(table->slotSymbols, -1, sizeof(int) * table->slotCap);
+    for (int i = 0; i < oldCap; i++) {
+        if (oldSymbols[i] == -1) continue;
+        int s = findSlot(table, oldSymbols[i]);
+        table->slotSymbols[s] = oldSymbols[i];
+        table->slotHeads[s] = oldHeads[i];
     }
-    return false;
+    free(oldSymbols);
+    free(oldHeads);
 }
 
-Symbol* lookupSymbol(SymbolTable *table, const char *name, int scope) {
-    for (int i = 0; i < table->count; i++) {
-        if (strcmp(table->symbols[i].name, name) == 0 &&
-            table->symbols[i].scope == scope) {
-            return &table->symbols[i];
-        }
+void pushScope(SymbolTable *table) {
+    if (table->depth == table->scopeCap) {
+        table->scopeCap = table->scopeCap ? table->scopeCap * 2 : 16;
+        table->scopeStart = realloc(table->scopeStart, sizeof(int) * table->scopeCap);
+    }
+    table->scopeStart[table->depth++] = table->count;
+}
+
+void popScope(SymbolTable *table) {
+    if (table->depth == 0) return;
+    int start = table->scopeStart[--table->depth];
+    // Le definizioni dello scope tornano a scoprire quelle che nascondevano.
+    // Gli slot dei nomi restano occupati (head -1): niente cancellazioni.
+    while (table->count > start) {
+        Symbol *sym = &table->entries[--table->count];
+        table->slotHeads[findSlot(table, sym->symbol)] = sym->shadowed;
+    }
+}
+
+Symbol* insertSymbol(SymbolTable *table, int symbol, SymbolKind kind, long long value) {
+    // Il carico resta sotto il 50%
+    if (2 * (table->slotUsed + 1) > table->slotCap) growSlots(table);
+
+    int s = findSlot(table, symbol);
+    if (table->slotSymbols[s] == -1) {
+        table->slotSymbols[s] = symbol;
+        table->slotHeads[s] = -1;
+        table->slotUsed++;
     }
-    return NULL;
+
+    int head = table->slotHeads[s];
+    if (head >= 0 && table->entries[head].depth == table->depth) {
+        table->entries[head].kind = kind;
+        table->entries[head].value = value;
+        return &table->entries[head];
+    }
+
+    if (table->count == table->cap) {
+        table->cap = table->cap ? table->cap * 2 : 64;
+        table->entries = realloc(table->entries, sizeof(Symbol) * table->cap);
+    }
+    Symbol *sym = &table->entries[table->count];
+    sym->symbol = symbol;
+    sym->kind = kind;
+    sym->value = value;
+    sym->depth = table->depth;
+    sym->shadowed = head;
+    table->slotHeads[s] = table->count++;
+    return sym;
+}
+
+Symbol* lookupSymbol(SymbolTable *table, int symbol) {
+    if (table->slotCap == 0) return NULL;
+    int s = findSlot(table, symbol);
+    if (table->slotSymbols[s] == -1 || table->slotHeads[s] < 0) return NULL;
+    return &table->entries[table->slotHeads[s]];
 }
 
-bool symbolExists(SymbolTable *table, const char *name, int scope) {
-    return (lookupSymbol(table, name, scope) != NULL);
+bool symbolExists(SymbolTable *table, int symbol) {
+    return (lookupSymbol(table, symbol) != NULL);
 }
 
 void printSymbolTable(SymbolTable *table) {
-    printf("Symbol Table (count = %d):\n", table->count);
+    printf("Symbol Table (count = %d, depth = %d):\n", table->count, table->depth);
     for (int i = 0; i < table->count; i++) {
-        Symbol *sym = &table->symbols[i];
-        printf("  [%d] Name: %s, Type: %d, Scope: %d\n",
-               i, sym->name, sym->type, sym->scope);
+        Symbol *sym = &table->entries[i];
+        printf("  [%d] Name: %s, Kind: %d, Value: %lld, Scope: %d\n",
+               i, symbolName(sym->symbol), sym->kind, sym->value, sym->depth);
     }
 }
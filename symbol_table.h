@@ -2,27 +2,49 @@
 #define SYMBOL_TABLE_H
 
 #include <stdbool.h>
-#include "lexer.h"  // Per riutilizzare i TokenType se necessario
 
-#define MAX_SYMBOLS 100
+// Tabella dei simboli con scope annidati. Le chiavi sono gli ID interned dei
+// nomi (intern.h), indicizzati con una tabella hash a indirizzamento aperto.
+// Una definizione in uno scope interno nasconde quelle esterne finché lo
+// scope non viene chiuso; nessun limite al numero di simboli.
+
+typedef enum {
+    SYM_VAR,
+    SYM_FUNCTION,
+    SYM_CONST,          // variabile di valore noto
+    SYM_UNKNOWN,        // variabile di valore ignoto: nasconde le costanti esterne
+} SymbolKind;
 
 typedef struct {
-    char name[64];
-    TokenType type;   // Tipo del simbolo (INT, FLOAT, FUNCTION, ecc.)
-    int scope;        // Ambito (0 = globale, 1 = locale, ecc.)
-    // Valori aggiuntivi, se servono
+    int symbol;         // ID interned del nome
+    SymbolKind kind;
+    long long value;    // valore della costante o indice (globale, funzione)
+    int depth;          // profondità dello scope che l'ha definito
+    int shadowed;       // definizione nascosta dello stesso nome, -1 se nessuna
 } Symbol;
 
 typedef struct {
-    Symbol symbols[MAX_SYMBOLS];
-    int count;
+    Symbol *entries;    // in ordine di definizione: gli scope ne sono suffissi
+    int count, cap;
+    int *scopeStart;    // per ogni scope aperto, il primo indice in entries
+    int depth, scopeCap;
+
+    // Hash: per ogni nome l'ultima definizione visibile (-1 se nessuna)
+    int *slotSymbols;   // -1 se lo slot è vuoto
+    int *slotHeads;
+    int slotCap, slotUsed;
 } SymbolTable;
 
 // Funzioni
 void initSymbolTable(SymbolTable *table);
-bool insertSymbol(SymbolTable *table, Symbol symbol);
-Symbol* lookupSymbol(SymbolTable *table, const char *name, int scope);
-bool symbolExists(SymbolTable *table, const char *name, int scope);
+void freeSymbolTable(SymbolTable *table);
+void pushScope(SymbolTable *table);
+void popScope(SymbolTable *table);
+// Definisce il nome nello scope corrente (sostituisce una definizione dello
+// stesso scope, nasconde quelle esterne)
+Symbol* insertSymbol(SymbolTable *table, int symbol, SymbolKind kind, long long value);
+Symbol* lookupSymbol(SymbolTable *table, int symbol);
+bool symbolExists(SymbolTable *table, int symbol);
 void printSymbolTable(SymbolTable *table);
 
 #endif // SYMBOL_TABLE_H
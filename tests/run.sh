@@ -0,0 +1,97 @@
+#!/bin/sh
+# Esegue ogni programma di tests/ (e test.atl) in tre modi: eseguibile ELF,
+# --run e --interp. Le tre uscite devono coincidere con <nome>.out e i codici
+# di uscita fra loro. Se nasm e ld sono installati si prova anche il testo di
+# --emit-asm. Con un compilatore C ($CC, predefinito cc) si esegue anche
+# scan_fuzz.c, che confronta i percorsi di scansione del lexer.
+#
+# Uso: tests/run.sh [compilatore]        (predefinito: ./compiler)
+
+compiler=${1:-./compiler}
+tests=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+if [ ! -x "$compiler" ]; then
+    echo "Compilatore non trovato: $compiler" >&2
+    exit 2
+fi
+case $compiler in
+    /*) ;;
+    *) compiler=$(pwd)/$compiler ;;
+esac
+
+assembler=0
+command -v nasm >/dev/null 2>&1 && command -v ld >/dev/null 2>&1 && assembler=1
+
+failures=0
+count=0
+
+fail() {
+    echo "FALLITO $1: $2"
+    failed=1
+}
+
+# $1 = nome dell'esecuzione, poi il comando: stdout in $work/$1, il codice
+# di uscita in $work/$1.status
+capture() {
+    output=$work/$1
+    shift
+    "$@" > "$output" 2>/dev/null
+    echo $? > "$output.status"
+}
+
+for source in "$tests"/../test.atl "$tests"/*.atl; do
+    name=$(basename "$source" .atl)
+    expected="$tests/$name.out"
+    count=$((count + 1))
+    failed=0
+    if [ ! -f "$expected" ]; then
+        fail "$name" "manca $name.out"
+    elif ! "$compiler" -o "$work/$name.elf" "$source" > /dev/null; then
+        fail "$name" "compilazione"
+    fi
+    if [ $failed = 1 ]; then
+        failures=$((failures + 1))
+        continue
+    fi
+    capture elf "$work/$name.elf"
+    capture run "$compiler" --run "$source"
+    capture interp "$compiler" --interp "$source"
+    modes="elf run interp"
+
+    if [ $assembler = 1 ]; then
+        if "$compiler" --emit-asm -o "$work/$name.asm" "$source" > /dev/null &&
+            nasm -f elf64 -o "$work/$name.o" "$work/$name.asm" && ld -o "$work/$name.nasm" "$work/$name.o"; then
+            capture nasm "$work/$name.nasm"
+            modes="$modes nasm"
+        else
+            fail "$name" "nasm o ld"
+        fi
+    fi
+
+    for mode in $modes; do
+        if ! cmp -s "$work/$mode" "$expected"; then
+            fail "$name" "uscita diversa con $mode"
+        elif ! cmp -s "$work/$mode.status" "$work/elf.status"; then
+            fail "$name" "codice di uscita diverso con $mode"
+        fi
+    done
+    failures=$((failures + failed))
+done
+
+cc=${CC:-cc}
+if command -v "$cc" >/dev/null 2>&1; then
+    count=$((count + 1))
+    root="$tests/.."
+    if ! "$cc" -O2 -o "$work/scan_fuzz" "$tests/scan_fuzz.c" "$root/lexer.c" "$root/scan.c" "$root/intern.c"; then
+        echo "FALLITO scan_fuzz: compilazione"
+        failures=$((failures + 1))
+    elif ! "$work/scan_fuzz" > /dev/null; then
+        echo "FALLITO scan_fuzz: percorsi di scansione diversi"
+        failures=$((failures + 1))
+    fi
+fi
+
+echo "$((count - failures)) / $count programmi corretti"
+[ $failures = 0 ]
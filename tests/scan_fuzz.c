@@ -0,0 +1,227 @@
+// Fuzz dei percorsi di scansione del lexer (scan.h). Su ogni input casuale
+// scalare, SSE2 e AVX2 devono dare lo stesso stream di token e, da ogni
+// posizione, lo stesso risultato di skipIdentChars, skipStringChars e
+// skipSpaces. Gli input finiscono spesso contro una pagina senza permessi o
+// cominciano all'inizio di una pagina: un blocco letto oltre i confini
+// termina il programma con un fault.
+//
+// Compilazione: gcc -O2 -Wall tests/scan_fuzz.c lexer.c scan.c intern.c -o scan_fuzz
+// Uso: scan_fuzz [iterazioni] [seme]
+// Con lo stesso seme le iterazioni sono le stesse: un errore si riproduce
+// rilanciando con gli argomenti stampati.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../lexer.h"
+#include "../intern.h"
+#include "../scan.h"
+
+#define MAX_INPUT 6000      // meno di due pagine: l'input sta nella regione
+
+static const ScanPath paths[] = { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+static const char *pathNames[] = { "scalar", "sse2", "avx2" };
+#define PATH_COUNT 3
+
+// xorshift64*: deterministico e uguale su ogni piattaforma
+static uint64_t state;
+
+static uint32_t nextRandom() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (uint32_t) ((state * 2685821657736338717ull) >> 32);
+}
+
+static int below(int n) {
+    return (int) (nextRandom() % (uint32_t) n);
+}
+
+// Byte ai bordi degli intervalli confrontati dai percorsi vettoriali (il
+// confronto senza segno passa per quello con segno) e qualche byte alto
+static const unsigned char edgeBytes[] = {
+    '/', ':', '@', '[', '^', '`', '{', 0x7F, 0x08, 0x0E, 0x1F, '!', '#',
+    0x80, 0x81, 0x89, 0x8A, 0xA0, 0xC0, 0xDF, 0xE1, 0xFF,
+};
+
+static const char *words[] = {
+    "VAR", "LOOP", "NEXT", "IF", "THEN", "ELSE", "ENDIF", "FUNCTION", "RETURN",
+    "PRINT", "BREAK", "x", "_", "a1", "==", "!=", "<=", "&&", "||", "3.14", "42",
+};
+
+static const char identChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+static const char spaceChars[] = " \t\n\r\v\f";
+static const char opChars[] = "=+-*/%<>!&|(),;.";
+
+// Sequenze di una stessa classe, a volte più lunghe di un blocco da 32 byte
+static int runLength() {
+    return below(4) == 0 ? 1 + below(100) : 1 + below(8);
+}
+
+static int generate(char *out, int limit) {
+    int n = 0;
+    while (n < limit) {
+        int run = runLength();
+        int kind = below(7);
+        for (int i = 0; i < run && n < limit; i++) {
+            switch (kind) {
+                case 0: out[n++] = identChars[below(sizeof(identChars) - 1)]; break;
+                case 1: out[n++] = spaceChars[below(sizeof(spaceChars) - 1)]; break;
+                case 2: out[n++] = opChars[below(sizeof(opChars) - 1)]; break;
+                case 3: out[n++] = (char) edgeBytes[below(sizeof(edgeBytes))]; break;
+                case 4: out[n++] = (char) (1 + below(255)); break;
+                case 5:
+                    // Stringa, con escape e a volte senza chiusura
+                    out[n++] = below(6) == 0 ? '\\' : below(8) == 0 ? '"' : identChars[below(10)];
+                    break;
+                default: {
+                    const char *w = words[below(sizeof(words) / sizeof(words[0]))];
+                    for (int k = 0; w[k] && n < limit; k++) out[n++] = w[k];
+                    if (n < limit) out[n++] = ' ';
+                    break;
+                }
+            }
+        }
+        if (kind == 5 && n < limit) out[n++] = '"';
+    }
+    return n;
+}
+
+typedef struct {
+    Token *tokens;
+    int count;
+} Stream;
+
+static Stream scanAll(const char *input, int length) {
+    // Ogni token tranne EOF consuma almeno un byte
+    Stream s = { malloc(sizeof(Token) * (length + 1)), 0 };
+    freeSymbols();
+    initLexer(input);
+    for (;;) {
+        const Token *t = peekToken(0);
+        s.tokens[s.count++] = *t;
+        if (t->type == TOKEN_EOF || s.count > length) break;
+        nextToken();
+    }
+    return s;
+}
+
+static int sameToken(const Token *a, const Token *b) {
+    return a->type == b->type && a->offset == b->offset && a->length == b->length &&
+           a->symbol == b->symbol && a->line == b->line && a->position == b->position;
+}
+
+// Confronta il percorso corrente con il riferimento scalare
+static int checkPath(const char *input, int length, const Stream *reference,
+                     const char **ident, const char **string, const char **spaces,
+                     const int *lines, const int *positions) {
+    Stream s = scanAll(input, length);
+    int ok = 1;
+    for (int i = 0; i < s.count || i < reference->count; i++) {
+        if (i >= s.count || i >= reference->count || !sameToken(&s.tokens[i], &reference->tokens[i])) {
+            fprintf(stderr, "token %d diverso\n", i);
+            ok = 0;
+            break;
+        }
+    }
+    free(s.tokens);
+
+    for (int i = 0; i <= length && ok; i++) {
+        int line = 1, pos = 1;
+        const char *p = input + i;
+        if (skipIdentChars(p) != ident[i]) {
+            fprintf(stderr, "skipIdentChars diverso dalla posizione %d\n", i);
+            ok = 0;
+        } else if (skipStringChars(p) != string[i]) {
+            fprintf(stderr, "skipStringChars diverso dalla posizione %d\n", i);
+            ok = 0;
+        } else if (skipSpaces(p, &line, &pos) != spaces[i] || line != lines[i] || pos != positions[i]) {
+            fprintf(stderr, "skipSpaces diverso dalla posizione %d\n", i);
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+
+    int available[PATH_COUNT];
+    for (int k = 0; k < PATH_COUNT; k++) {
+        available[k] = setScanPath(paths[k]);
+        if (!available[k]) printf("Percorso %s non supportato: saltato\n", pathNames[k]);
+    }
+
+    // Due pagine leggibili e una senza permessi subito dopo
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    char *region = mmap(NULL, 3 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED || mprotect(region + 2 * page, page, PROT_NONE) != 0) {
+        perror("Errore nel mappare la regione di prova");
+        return 2;
+    }
+    size_t capacity = 2 * page;
+    int limit = capacity - 1 < MAX_INPUT ? (int) capacity - 1 : MAX_INPUT;
+
+    const char **ident = malloc(sizeof(char*) * (limit + 1));
+    const char **string = malloc(sizeof(char*) * (limit + 1));
+    const char **spaces = malloc(sizeof(char*) * (limit + 1));
+    int *lines = malloc(sizeof(int) * (limit + 1));
+    int *positions = malloc(sizeof(int) * (limit + 1));
+    char *text = malloc(limit);
+
+    for (int iter = 0; iter < iterations; iter++) {
+        state = (seed * 0x9E3779B97F4A7C15ull) ^ (unsigned long long) (iter + 1);
+        if (!state) state = 1;
+
+        int length = generate(text, below(8) == 0 ? below(limit + 1) : below(200));
+
+        // Contro la pagina di guardia, all'inizio di una pagina o ovunque;
+        // i byte fuori dall'input sono casuali e non nulli
+        size_t start;
+        switch (below(3)) {
+            case 0: start = capacity - (size_t) length - 1; break;
+            case 1: start = length < (int) page ? page * (size_t) below(2) : 0; break;
+            default: start = (size_t) below((int) (capacity - (size_t) length));
+        }
+        for (size_t i = 0; i < capacity; i++) region[i] = (char) (1 + below(255));
+        char *input = region + start;
+        memcpy(input, text, length);
+        input[length] = '\0';
+
+        setScanPath(SCAN_SCALAR);
+        Stream reference = scanAll(input, length);
+        for (int i = 0; i <= length; i++) {
+            lines[i] = positions[i] = 1;
+            ident[i] = skipIdentChars(input + i);
+            string[i] = skipStringChars(input + i);
+            spaces[i] = skipSpaces(input + i, &lines[i], &positions[i]);
+        }
+
+        for (int k = 1; k < PATH_COUNT; k++) {
+            if (!available[k]) continue;
+            setScanPath(paths[k]);
+            if (!checkPath(input, length, &reference, ident, string, spaces, lines, positions)) {
+                fprintf(stderr, "Percorso %s diverso da scalar: iterazione %d, seme %llu "
+                        "(scan_fuzz %d %llu), inizio a %zu byte dalla pagina\n",
+                        pathNames[k], iter, seed, iter + 1, seed, start % page);
+                return 1;
+            }
+        }
+        free(reference.tokens);
+    }
+
+    free(ident);
+    free(string);
+    free(spaces);
+    free(lines);
+    free(positions);
+    free(text);
+    freeSymbols();
+    munmap(region, 3 * page);
+    printf("%d input: token e scansioni uguali su tutti i percorsi\n", iterations);
+    return 0;
+}
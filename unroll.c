@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unroll.h"
+
+#define UNROLL_MAX_NODES 256    // nodi del corpo moltiplicati per le copie
+#define UNROLL_MAX_FULL 16      // giri di un ciclo che sparisce del tutto
+
+// Un LOOP con contatore: i op bound, con i = i + step una volta per giro
+typedef struct {
+    int symbol;
+    const char *op;
+    ASTNode *bound;
+    long long step;
+    int bodyNodes;
+    int knownInit;      // giri noti: valore iniziale e limite letterali
+    long long init;
+} CountedLoop;
+
+static _Thread_local int factor;
+static _Thread_local int unrolled;
+
+// ---------- ANALISI ----------
+
+static int countAssignments(ASTNode *node, int symbol) {
+    if (!node) return 0;
+    int count = assignedSymbol(node) == symbol;
+    for (int i = 0; i < node->childCount; i++) count += countAssignments(node->children[i], symbol);
+    return count;
+}
+
+// Chiamate (possono scrivere il contatore o il limite), funzioni annidate
+// (non si duplicano) e BREAK di questo ciclo (uscirebbe solo dalla copia
+// srotolata e il resto continuerebbe): ognuno impedisce la trasformazione
+static int blocksUnrolling(ASTNode *node, int nested) {
+    if (!node) return 0;
+    if (node->type == AST_CALL || node->type == AST_FUNCTION_DEF) return 1;
+    if (node->type == AST_BREAK && !nested) return 1;
+    if (node->type == AST_LOOP) nested = 1;
+    for (int i = 0; i < node->childCount; i++) {
+        if (blocksUnrolling(node->children[i], nested)) return 1;
+    }
+    return 0;
+}
+
+static int isIdentifier(ASTNode *node, int symbol) {
+    return node->type == AST_IDENTIFIER && node->symbol == symbol;
+}
+
+// Solo somme, differenze e prodotti di letterali e variabili: il limite si
+// valuta più volte e fuori posto, quindi non deve poter fallire
+static int isSimpleBound(ASTNode *node, int symbol) {
+    if (node->type == AST_LITERAL) return 1;
+    if (node->type == AST_IDENTIFIER) return node->symbol != symbol;
+    if (node->type != AST_BINARY_EXPR) return 0;
+    const char *op = node->text;
+    if (strcmp(op, "+") != 0 && strcmp(op, "-") != 0 && strcmp(op, "*") != 0 && strcmp(op, "-u") != 0) return 0;
+    for (int i = 0; i < node->childCount; i++) {
+        if (!isSimpleBound(node->children[i], symbol)) return 0;
+    }
+    return 1;
+}
+
+static int boundInvariant(ASTNode *node, ASTNode *body) {
+    if (node->type == AST_IDENTIFIER) return countAssignments(body, node->symbol) == 0;
+    for (int i = 0; i < node->childCount; i++) {
+        if (!boundInvariant(node->children[i], body)) return 0;
+    }
+    return 1;
+}
+
+// i = i + c, i = c + i oppure i = i - c: restituisce il passo (0 se non lo è)
+static long long incrementStep(ASTNode *node, int symbol) {
+    if (node->type != AST_ASSIGNMENT || node->children[0]->symbol != symbol) return 0;
+    ASTNode *expr = node->children[1];
+    if (expr->type != AST_BINARY_EXPR || expr->childCount != 2) return 0;
+    ASTNode *left = expr->children[0], *right = expr->children[1];
+    if (strcmp(expr->text, "+") == 0) {
+        if (isIdentifier(left, symbol) && right->type == AST_LITERAL) return right->number;
+        if (isIdentifier(right, symbol) && left->type == AST_LITERAL) return left->number;
+    } else if (strcmp(expr->text, "-") == 0 && isIdentifier(left, symbol) && right->type == AST_LITERAL) {
+        // -LLONG_MIN non è rappresentabile
+        return right->number == -right->number ? 0 : -right->number;
+    }
+    return 0;
+}
+
+// VAR i = n oppure i = n subito prima del ciclo
+static int literalInit(ASTNode *previous, int symbol, long long *value) {
+    if (!previous || assignedSymbol(previous) != symbol) return 0;
+    ASTNode *expr = previous->type == AST_VAR_DECL ?
+        (previous->childCount > 0 ? previous->children[0] : NULL) : previous->children[1];
+    if (!expr) {
+        *value = 0;
+        return 1;
+    }
+    if (expr->type != AST_LITERAL) return 0;
+    *value = expr->number;
+    return 1;
+}
+
+static int analyzeLoop(ASTNode *loop, ASTNode *previous, CountedLoop *info) {
+    ASTNode *cond = loop->children[0];
+    ASTNode *body = loop->children[1];
+    if (cond->type != AST_BINARY_EXPR || cond->childCount != 2 || cond->children[0]->type != AST_IDENTIFIER) return 0;
+    info->symbol = cond->children[0]->symbol;
+    info->op = cond->text;
+    info->bound = cond->children[1];
+    int upward = strcmp(info->op, "<") == 0 || strcmp(info->op, "<=") == 0;
+    int downward = strcmp(info->op, ">") == 0 || strcmp(info->op, ">=") == 0;
+    if (!upward && !downward) return 0;
+    if (body->type != AST_BLOCK || blocksUnrolling(body, 0)) return 0;
+    if (!isSimpleBound(info->bound, info->symbol) || !boundInvariant(info->bound, body)) return 0;
+
+    // Il contatore cambia solo con l'incremento, al primo livello del corpo
+    // (non dentro un IF), quindi esattamente una volta per giro
+    if (countAssignments(body, info->symbol) != 1) return 0;
+    info->step = 0;
+    for (int i = 0; i < body->childCount; i++) {
+        if (assignedSymbol(body->children[i]) == info->symbol) info->step = incrementStep(body->children[i], info->symbol);
+    }
+    if (info->step == 0 || (info->step > 0) != upward) return 0;
+
+    info->bodyNodes = countNodes(body);
+    info->knownInit = info->bound->type == AST_LITERAL && literalInit(previous, info->symbol, &info->init);
+    return 1;
+}
+
+// Giri del ciclo con valore iniziale e limite noti; -1 se il contatore
+// uscirebbe dall'intervallo a 64 bit (il wrap-around cambierebbe il conto)
+static long long tripCount(CountedLoop *info) {
+    __int128 init = info->init, bound = info->bound->number, step = info->step;
+    int inclusive = info->op[1] == '=';
+    __int128 distance = step > 0 ? bound - init : init - bound;
+    __int128 stride = step > 0 ? step : -step;
+    __int128 trips;
+    if (inclusive) trips = distance < 0 ? 0 : distance / stride + 1;
+    else trips = distance <= 0 ? 0 : (distance + stride - 1) / stride;
+    __int128 last = init + trips * step;
+    if (last > __INT64_MAX__ || last < -__INT64_MAX__ - 1) return -1;
+    return (long long) trips;
+}
+
+// ---------- TRASFORMAZIONE ----------
+
+static ASTNode* copyAST(ASTNode *node) {
+    if (!node) return NULL;
+    ASTNode *copy = createASTNode(node->type, node->childCount);
+    copy->number = node->number;    // copia l'intera union
+    for (int i = 0; i < node->childCount; i++) copy->children[i] = copyAST(node->children[i]);
+    return copy;
+}
+
+static ASTNode* binary(const char *op, ASTNode *left, ASTNode *right) {
+    ASTNode *node = createTextNode(AST_BINARY_EXPR, op, (int) strlen(op), 2);
+    node->children[0] = left;
+    node->children[1] = right;
+    return node;
+}
+
+static ASTNode* identifier(int symbol) {
+    ASTNode *node = createASTNode(AST_IDENTIFIER, 0);
+    node->symbol = symbol;
+    return node;
+}
+
+// Le istruzioni del corpo ripetute copies volte, di seguito
+static ASTNode* repeatBody(ASTNode *body, int copies) {
+    ASTNode *block = createASTNode(AST_BLOCK, body->childCount * copies);
+    for (int c = 0; c < copies; c++) {
+        for (int i = 0; i < body->childCount; i++) {
+            block->children[c * body->childCount + i] = copyAST(body->children[i]);
+        }
+    }
+    return block;
+}
+
+static ASTNode* newLoop(ASTNode *cond, ASTNode *body) {
+    ASTNode *loop = createASTNode(AST_LOOP, 2);
+    loop->children[0] = cond;
+    loop->children[1] = body;
+    return loop;
+}
+
+static ASTNode* sequence(ASTNode *first, ASTNode *second) {
+    ASTNode *block = createASTNode(AST_BLOCK, 2);
+    block->children[0] = first;
+    block->children[1] = second;
+    return block;
+}
+
+// Giri noti: floor(trips / factor) giri del corpo replicato con un solo
+// confronto ciascuno, poi le iterazioni restanti in linea, senza test
+static ASTNode* unrollKnown(ASTNode *loop, CountedLoop *info, long long trips) {
+    ASTNode *body = loop->children[1];
+    if (trips == 0) return createASTNode(AST_BLOCK, 0);
+    if (trips <= UNROLL_MAX_FULL && trips * info->bodyNodes <= UNROLL_MAX_NODES) {
+        return repeatBody(body, (int) trips);
+    }
+    if (trips < factor || (long long) factor * info->bodyNodes > UNROLL_MAX_NODES) return loop;
+
+    // Con giri * passo nell'intervallo (tripCount) anche questo limite lo è
+    long long groups = trips / factor;
+    long long limit = (long long) (info->init + (__int128) groups * factor * info->step);
+    ASTNode *cond = binary(info->step > 0 ? "<" : ">", identifier(info->symbol), createNumberNode(limit));
+    ASTNode *unrolledLoop = newLoop(cond, repeatBody(body, factor));
+    int rest = (int) (trips % factor);
+    return rest ? sequence(unrolledLoop, repeatBody(body, rest)) : unrolledLoop;
+}
+
+// Giri ignoti: il ciclo srotolato gira finché restano factor iterazioni
+// (i < E - k, con k = (factor - 1) * passo), poi il ciclo originale finisce
+// le altre. Se E - k va in overflow il ciclo srotolato si salta.
+static ASTNode* unrollUnknown(ASTNode *loop, CountedLoop *info) {
+    if ((long long) factor * info->bodyNodes > UNROLL_MAX_NODES) return loop;
+    __int128 k = (__int128) (factor - 1) * info->step;
+    if (k > __INT64_MAX__ || k < -__INT64_MAX__ - 1) return loop;
+
+    ASTNode *limit;
+    int guarded = info->bound->type != AST_LITERAL;
+    if (guarded) {
+        limit = binary("-", copyAST(info->bound), createNumberNode((long long) k));
+    } else {
+        __int128 value = info->bound->number - k;
+        if (value > __INT64_MAX__ || value < -__INT64_MAX__ - 1) return loop;
+        limit = createNumberNode((long long) value);
+    }
+    ASTNode *cond = binary(info->op, identifier(info->symbol), limit);
+    ASTNode *unrolledLoop = newLoop(cond, repeatBody(loop->children[1], factor));
+    if (guarded) {
+        // E - k < E (> con passo negativo) è falso proprio quando va in overflow
+        ASTNode *check = binary(info->step > 0 ? "<" : ">", copyAST(limit), copyAST(info->bound));
+        ASTNode *guard = createASTNode(AST_IF, 2);
+        guard->children[0] = check;
+        guard->children[1] = sequence(unrolledLoop, createASTNode(AST_BLOCK, 0));
+        unrolledLoop = guard;
+    }
+    return sequence(unrolledLoop, loop);
+}
+
+static ASTNode* unrollLoop(ASTNode *loop, ASTNode *previous) {
+    CountedLoop info;
+    if (!analyzeLoop(loop, previous, &info)) return loop;
+    ASTNode *result = loop;
+    if (info.knownInit) {
+        long long trips = tripCount(&info);
+        if (trips >= 0) result = unrollKnown(loop, &info, trips);
+    } else {
+        result = unrollUnknown(loop, &info);
+    }
+    if (result != loop) unrolled++;
+    return result;
+}
+
+// Prima i cicli interni: il corpo di quello esterno cresce e di solito
+// supera il limite di nodi, così si replica solo il ciclo più caldo
+static void unrollStatements(ASTNode *node) {
+    if (!node) return;
+    for (int i = 0; i < node->childCount; i++) unrollStatements(node->children[i]);
+    if (node->type != AST_PROGRAM && node->type != AST_BLOCK) return;
+    for (int i = 0; i < node->childCount; i++) {
+        if (node->children[i]->type != AST_LOOP) continue;
+        node->children[i] = unrollLoop(node->children[i], i > 0 ? node->children[i - 1] : NULL);
+    }
+}
+
+int unrollLoops(ASTNode *root, int unrollFactor) {
+    factor = unrollFactor;
+    unrolled = 0;
+    if (factor > 1) unrollStatements(root);
+    return unrolled;
+}
@@ -0,0 +1,13 @@
+#ifndef UNROLL_H
+#define UNROLL_H
+
+#include "ast.h"
+
+// Srotolamento dei LOOP con contatore: condizione i < E (<=, >, >=) con E
+// invariante e un solo assegnamento i = i + c, al primo livello del corpo.
+// Il corpo si replica factor volte sotto un unico test, seguito da un ciclo
+// (o da copie) per le iterazioni che restano; con il numero di giri noto e
+// piccolo il ciclo sparisce. Restituisce il numero di cicli trasformati.
+int unrollLoops(ASTNode *root, int factor);
+
+#endif // UNROLL_H
@@ -0,0 +1,1078 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "x86.h"
+#include "intern.h"
+#include "context.h"
+
+// Due passate sul programma: la prima definisce i simboli (etichette, dati,
+// equ) e riempie .data/.bss, la seconda codifica le istruzioni. I salti verso
+// etichette vengono risolti dopo, quando la disposizione del codice è nota;
+// i riferimenti a .data/.bss restano come Fixup per relocateMachineCode().
+
+// ---------- REGISTRI ----------
+
+#define NUM_REGS 16
+#define NO_REG  -1
+#define RSP      4
+#define RBP      5
+
+// Nell'ordine della codifica hardware
+static const char *regs64[NUM_REGS] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+static const char *regs32[NUM_REGS] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+static const char *regs16[NUM_REGS] = {
+    "ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+    "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"
+};
+static const char *regs8[NUM_REGS] = {
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+
+static int matches(const char *name, int len, const char *word) {
+    return (int) strlen(word) == len && strncmp(name, word, len) == 0;
+}
+
+// Numero del registro e ampiezza in byte, -1 se il nome non è un registro.
+// Ogni operando passa di qui: i nomi si confrontano come interi a 32 bit.
+static unsigned registerKey(const char *name, int len) {
+    unsigned key = 0;
+    for (int i = 0; i < len; i++) key |= (unsigned) (unsigned char) name[i] << (8 * i);
+    return key;
+}
+
+static int parseRegister(const char *name, int len, int *size) {
+    static _Thread_local unsigned keys[4 * NUM_REGS];
+    static const char **tables[4] = { regs64, regs32, regs16, regs8 };
+    static const int sizes[4] = { 8, 4, 2, 1 };
+    if (len < 2 || len > 4) return -1;
+    if (!keys[0]) {
+        for (int t = 0; t < 4; t++) {
+            for (int i = 0; i < NUM_REGS; i++) {
+                keys[t * NUM_REGS + i] = registerKey(tables[t][i], (int) strlen(tables[t][i]));
+            }
+        }
+    }
+    unsigned key = registerKey(name, len);
+    for (int k = 0; k < 4 * NUM_REGS; k++) {
+        if (keys[k] == key) {
+            *size = sizes[k / NUM_REGS];
+            return k % NUM_REGS;
+        }
+    }
+    return -1;
+}
+
+// Codice della condizione di jcc/setcc/cmovcc, -1 se sconosciuta
+static int parseCondition(const char *cc) {
+    static const struct { const char *name; int code; } conditions[] = {
+        { "o", 0 }, { "no", 1 }, { "b", 2 }, { "c", 2 }, { "nae", 2 },
+        { "ae", 3 }, { "nb", 3 }, { "nc", 3 }, { "e", 4 }, { "z", 4 },
+        { "ne", 5 }, { "nz", 5 }, { "be", 6 }, { "na", 6 }, { "a", 7 },
+        { "nbe", 7 }, { "s", 8 }, { "ns", 9 }, { "p", 10 }, { "pe", 10 },
+        { "np", 11 }, { "po", 11 }, { "l", 12 }, { "nge", 12 }, { "ge", 13 },
+        { "nl", 13 }, { "le", 14 }, { "ng", 14 }, { "g", 15 }, { "nle", 15 }
+    };
+    for (int i = 0; i < (int) (sizeof(conditions) / sizeof(conditions[0])); i++) {
+        if (strcmp(cc, conditions[i].name) == 0) return conditions[i].code;
+    }
+    return -1;
+}
+
+// ---------- ERRORI ----------
+
+static _Thread_local AsmLine *context;            // riga in corso di traduzione
+
+static void fail(const char *message) {
+    char line[256] = "(fine del programma)";
+    if (context && context->kind != ASM_INSTR) {
+        snprintf(line, sizeof(line), "%s", context->text);
+    } else if (context) {
+        int pos = snprintf(line, sizeof(line), "%s", context->mnemonic);
+        for (int i = 0; i < context->operandCount && pos < (int) sizeof(line); i++) {
+            pos += snprintf(line + pos, sizeof(line) - pos, "%s%s", i ? ", " : " ", context->operands[i]);
+        }
+    }
+    sourceError(0, 0, "Errore dell'assemblatore: %s: %s", message, line);
+}
+
+// ---------- SIMBOLI ----------
+
+// Per ID interned: segmento e valore (offset nel segmento, indice della
+// prima istruzione che segue per le etichette di text, valore per equ)
+static _Thread_local signed char *segmentOf;      // -1 se non definito
+static _Thread_local long long *valueOf;
+static _Thread_local int symbolCap = 0;
+static _Thread_local char scope[MAX_ASM_OPERAND]; // ultima etichetta non locale
+
+static void reserveSymbol(int id) {
+    if (id < symbolCap) return;
+    int oldCap = symbolCap;
+    symbolCap = id * 2 + 64;
+    segmentOf = realloc(segmentOf, sizeof(signed char) * symbolCap);
+    valueOf = realloc(valueOf, sizeof(long long) * symbolCap);
+    memset(segmentOf + oldCap, -1, sizeof(signed char) * (symbolCap - oldCap));
+}
+
+// Le etichette che iniziano con '.' appartengono all'ultima non locale
+static int symbolId(const char *name, int len) {
+    int id;
+    if (name[0] == '.') {
+        char scoped[2 * MAX_ASM_OPERAND];
+        int scopeLen = (int) strlen(scope);
+        if (len >= MAX_ASM_OPERAND) fail("nome troppo lungo");
+        memcpy(scoped, scope, scopeLen);
+        memcpy(scoped + scopeLen, name, len);
+        id = internSymbol(scoped, scopeLen + len);
+    } else {
+        id = internSymbol(name, len);
+    }
+    reserveSymbol(id);
+    return id;
+}
+
+static void defineSymbol(const char *name, int len, Segment segment, long long value) {
+    int id = symbolId(name, len);
+    if (segmentOf[id] >= 0) fail("simbolo definito più volte");
+    segmentOf[id] = (signed char) segment;
+    valueOf[id] = value;
+}
+
+// ---------- ESPRESSIONI ----------
+
+static int isSymbolChar(char c) {
+    return isalnum((unsigned char) c) || c == '_' || c == '.' || c == '$';
+}
+
+static const char* skipBlanks(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// Somma di termini: numeri, 'c', simboli, registri (solo negli indirizzi,
+// eventualmente con *scala) e $ (posizione corrente, solo nei dati)
+typedef struct {
+    long long value;
+    int symbol;             // simbolo rilocabile (value ne è l'addendo), -1 se nessuno
+    int base, index, scale;
+} Sum;
+
+static _Thread_local Segment currentSegment;
+static _Thread_local long long currentOffset;     // per $
+
+static void parseSum(const char *p, const char *end, Sum *sum, int allowRegisters) {
+    int relocCount[SEG_COUNT] = { 0 };
+    int textTerms = 0;
+    sum->value = 0;
+    sum->symbol = -1;
+    sum->base = sum->index = NO_REG;
+    sum->scale = 1;
+
+    p = skipBlanks(p);
+    if (p >= end) fail("espressione vuota");
+    while (p < end) {
+        int sign = 1;
+        while (*p == '+' || *p == '-') {
+            if (*p == '-') sign = -sign;
+            p = skipBlanks(p + 1);
+        }
+        const char *start = p;
+        if (*p == '\'') {
+            if (p + 2 >= end || p[2] != '\'') fail("carattere non valido");
+            sum->value += sign * (unsigned char) p[1];
+            p += 3;
+        } else if (isdigit((unsigned char) *p)) {
+            unsigned long long n;
+            if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) n = strtoull(p + 2, (char**) &p, 16);
+            else n = strtoull(p, (char**) &p, 10);
+            sum->value += sign > 0 ? (long long) n : (long long) (0 - n);
+        } else if (*p == '$' && !isSymbolChar(p[1])) {
+            if (currentSegment == SEG_TEXT) fail("$ non supportato nel codice");
+            relocCount[currentSegment] += sign;
+            sum->value += sign * currentOffset;
+            p++;
+        } else if (isSymbolChar(*p)) {
+            while (p < end && isSymbolChar(*p)) p++;
+            int size;
+            int reg = parseRegister(start, (int) (p - start), &size);
+            if (reg >= 0) {
+                if (!allowRegisters || sign < 0 || size != 8) fail("registro non valido nell'indirizzo");
+                const char *q = skipBlanks(p);
+                int scale = 1;
+                if (*q == '*') {
+                    scale = (int) strtol(skipBlanks(q + 1), (char**) &p, 10);
+                    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) fail("scala non valida");
+                }
+                if (scale == 1 && sum->base == NO_REG) {
+                    sum->base = reg;
+                } else if (sum->index == NO_REG) {
+                    if (reg == RSP) fail("rsp non può fare da indice");
+                    sum->index = reg;
+                    sum->scale = scale;
+                } else {
+                    fail("troppi registri nell'indirizzo");
+                }
+            } else {
+                int id = symbolId(start, (int) (p - start));
+                if (segmentOf[id] < 0) fail("simbolo non definito");
+                sum->value += sign * valueOf[id];
+                // Le etichette di text valgono un indice di istruzione: niente aritmetica tra loro
+                if (segmentOf[id] == SEG_TEXT && (++textTerms > 1 || sign < 0)) fail("espressione non rilocabile");
+                if (segmentOf[id] != SEG_ABS) {
+                    relocCount[segmentOf[id]] += sign;
+                    if (sign > 0) sum->symbol = id;
+                }
+            }
+        } else {
+            fail("espressione non valida");
+        }
+        p = skipBlanks(p);
+        if (p < end && *p != '+' && *p != '-') fail("espressione non valida");
+    }
+
+    // Al più un simbolo rilocabile; le differenze nello stesso segmento sono costanti
+    int relocs = 0;
+    for (int s = 0; s < SEG_COUNT; s++) {
+        if (relocCount[s] < 0 || relocCount[s] > 1) fail("espressione non rilocabile");
+        relocs += relocCount[s];
+    }
+    if (relocs > 1) fail("espressione non rilocabile");
+    if (relocs == 0) sum->symbol = -1;
+    else sum->value -= valueOf[sum->symbol];
+}
+
+// ---------- OPERANDI ----------
+
+typedef enum { OPD_REG, OPD_IMM, OPD_MEM } OperandKind;
+
+typedef struct {
+    OperandKind kind;
+    int size;               // 1, 2, 4, 8; 0 se non indicata
+    int reg;                // OPD_REG
+    Sum sum;                // OPD_IMM, OPD_MEM
+} Operand;
+
+static void parseOperand(const char *text, Operand *op) {
+    static const struct { const char *name; int size; } sizes[] = {
+        { "byte", 1 }, { "word", 2 }, { "dword", 4 }, { "qword", 8 }
+    };
+    const char *p = skipBlanks(text);
+    op->size = 0;
+    for (int i = 0; i < 4; i++) {
+        int len = (int) strlen(sizes[i].name);
+        if (strncmp(p, sizes[i].name, len) == 0 && (p[len] == ' ' || p[len] == '[')) {
+            op->size = sizes[i].size;
+            p = skipBlanks(p + len);
+            break;
+        }
+    }
+
+    const char *end = p + strlen(p);
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    if (*p == '[') {
+        if (end[-1] != ']') fail("indirizzo non chiuso");
+        op->kind = OPD_MEM;
+        parseSum(p + 1, end - 1, &op->sum, 1);
+        return;
+    }
+    int size;
+    int reg = parseRegister(p, (int) (end - p), &size);
+    if (reg >= 0) {
+        op->kind = OPD_REG;
+        op->reg = reg;
+        op->size = size;
+        return;
+    }
+    op->kind = OPD_IMM;
+    parseSum(p, end, &op->sum, 0);
+}
+
+// ---------- ISTRUZIONI ----------
+
+typedef enum { BR_NONE, BR_JMP, BR_JCC, BR_CALL } BranchKind;
+
+// Un'istruzione (o un align) di text. I salti verso etichette vengono
+// codificati solo a disposizione fissata: qui restano target e condizione.
+typedef struct {
+    unsigned char bytes[15];
+    unsigned char length;
+    unsigned char branch;       // BranchKind
+    unsigned char cond;         // condizione di BR_JCC
+    unsigned char isLong;       // salto con spiazzamento a 32 bit
+    unsigned char align;        // > 0: riempitivo fino a un multiplo di align
+    signed char fixupAt;        // posizione del campo a 32 bit da rilocare, -1 se nessuno
+    unsigned char fixupKind;    // FixupKind
+    int target;                 // simbolo del salto o del campo da rilocare
+    long long addend;
+} Item;
+
+static _Thread_local Item *items;
+static _Thread_local int itemCount, itemCap;
+static _Thread_local Item *cur;
+
+static void newItem() {
+    if (itemCount == itemCap) {
+        itemCap = itemCap ? itemCap * 2 : 1024;
+        items = realloc(items, sizeof(Item) * itemCap);
+    }
+    cur = &items[itemCount++];
+    memset(cur, 0, sizeof(Item));
+    cur->fixupAt = -1;
+}
+
+static void byte1(int b) {
+    if (cur->length >= sizeof(cur->bytes)) fail("istruzione troppo lunga");
+    cur->bytes[cur->length++] = (unsigned char) b;
+}
+
+static void immediate(long long value, int size) {
+    for (int i = 0; i < size; i++) byte1((int) ((unsigned long long) value >> (8 * i)) & 0xFF);
+}
+
+static int fits8(long long v) {
+    return v >= -128 && v <= 127;
+}
+
+static int fits32(long long v) {
+    return v >= -2147483648LL && v <= 2147483647LL;
+}
+
+// Campo a 32 bit: costante, oppure indirizzo di un simbolo da rilocare
+static void field32(const Sum *sum, FixupKind kind) {
+    if (sum->symbol >= 0) {
+        cur->fixupAt = (signed char) cur->length;
+        cur->fixupKind = kind;
+        cur->target = sum->symbol;
+        cur->addend = sum->value;
+        immediate(0, 4);
+    } else {
+        if (kind == FIX_REL32 || !fits32(sum->value)) fail("valore fuori dall'intervallo a 32 bit");
+        immediate(sum->value, 4);
+    }
+}
+
+static int needsRexForByte(const Operand *op) {
+    return op->kind == OPD_REG && op->size == 1 && op->reg >= 4 && op->reg < 8;
+}
+
+// Prefisso 66, REX, opcode e ModRM/SIB/spiazzamento. reg è il campo reg del
+// ModRM (registro o estensione dell'opcode); regOp il suo operando, se c'è.
+static void encodeRM(int size, const unsigned char *opcode, int opcodeLength,
+                     int reg, const Operand *regOp, const Operand *rm) {
+    int rex = 0;
+    if (size == 8) rex |= 0x48;
+    if (reg & 8) rex |= 0x44;
+    if (rm->kind == OPD_REG) {
+        if (rm->reg & 8) rex |= 0x41;
+    } else {
+        if (rm->sum.base != NO_REG && (rm->sum.base & 8)) rex |= 0x41;
+        if (rm->sum.index != NO_REG && (rm->sum.index & 8)) rex |= 0x42;
+    }
+    // spl, bpl, sil, dil esistono solo con REX (altrimenti sono ah, ch, dh, bh)
+    if (needsRexForByte(rm) || (regOp && needsRexForByte(regOp))) rex |= 0x40;
+
+    if (size == 2) byte1(0x66);
+    if (rex) byte1(rex);
+    for (int i = 0; i < opcodeLength; i++) byte1(opcode[i]);
+
+    int r = (reg & 7) << 3;
+    if (rm->kind == OPD_REG) {
+        byte1(0xC0 | r | (rm->reg & 7));
+        return;
+    }
+    const Sum *m = &rm->sum;
+    int scaleBits = m->scale == 8 ? 3 : m->scale == 4 ? 2 : m->scale == 2 ? 1 : 0;
+    if (m->base == NO_REG && m->index == NO_REG) {
+        if (m->symbol >= 0) {
+            // Simbolo senza registri: relativo a rip
+            byte1(0x05 | r);
+            field32(m, FIX_REL32);
+        } else {
+            byte1(0x04 | r);
+            byte1(0x25);
+            field32(m, FIX_ABS32);
+        }
+        return;
+    }
+    if (m->base == NO_REG) {
+        byte1(0x04 | r);
+        byte1((scaleBits << 6) | ((m->index & 7) << 3) | 5);
+        field32(m, FIX_ABS32);
+        return;
+    }
+
+    int mod;
+    if (m->symbol >= 0 || !fits8(m->value)) mod = 2;
+    else if (m->value != 0 || (m->base & 7) == RBP) mod = 1;
+    else mod = 0;
+    if (m->index != NO_REG || (m->base & 7) == RSP) {
+        byte1((mod << 6) | r | 4);
+        byte1((scaleBits << 6) | (((m->index == NO_REG ? RSP : m->index) & 7) << 3) | (m->base & 7));
+    } else {
+        byte1((mod << 6) | r | (m->base & 7));
+    }
+    if (mod == 1) immediate(m->value, 1);
+    else if (mod == 2) field32(m, FIX_ABS32);
+}
+
+static void encodeRM1(int size, int opcode, int reg, const Operand *regOp, const Operand *rm) {
+    unsigned char op = (unsigned char) opcode;
+    encodeRM(size, &op, 1, reg, regOp, rm);
+}
+
+static void encodeRM2(int size, int opcode, int reg, const Operand *regOp, const Operand *rm) {
+    unsigned char op[2] = { 0x0F, (unsigned char) opcode };
+    encodeRM(size, op, 2, reg, regOp, rm);
+}
+
+// Ampiezza dell'operazione: quella dei registri o quella indicata sulla memoria
+static int operationSize(const Operand *a, const Operand *b) {
+    int size = a->size;
+    if (b && b->kind == OPD_REG) {
+        if (size && size != b->size) fail("ampiezze degli operandi diverse");
+        size = b->size;
+    }
+    if (!size) fail("ampiezza dell'operando non indicata");
+    return size;
+}
+
+static void immediateOfSize(const Sum *sum, int size) {
+    if (size == 1 || size == 2) {
+        if (sum->symbol >= 0) fail("indirizzo in un immediato corto");
+        immediate(sum->value, size);
+    } else {
+        field32(sum, FIX_ABS32);
+    }
+}
+
+// add, or, adc, sbb, and, sub, xor, cmp: /ext nel gruppo 80-83
+static void encodeAlu(int ext, const Operand *dst, const Operand *src) {
+    if (dst->kind == OPD_IMM) fail("destinazione immediata");
+    if (src->kind == OPD_IMM) {
+        int size = operationSize(dst, NULL);
+        if (size == 1) {
+            encodeRM1(1, 0x80, ext, NULL, dst);
+            immediateOfSize(&src->sum, 1);
+        } else if (src->sum.symbol < 0 && fits8(src->sum.value)) {
+            encodeRM1(size, 0x83, ext, NULL, dst);
+            immediate(src->sum.value, 1);
+        } else {
+            encodeRM1(size, 0x81, ext, NULL, dst);
+            immediateOfSize(&src->sum, size == 2 ? 2 : 4);
+        }
+    } else if (src->kind == OPD_REG) {
+        int size = operationSize(dst, src);
+        encodeRM1(size, (ext << 3) | (size == 1 ? 0x00 : 0x01), src->reg, src, dst);
+    } else {
+        if (dst->kind != OPD_REG) fail("due operandi in memoria");
+        int size = operationSize(src, dst);
+        encodeRM1(size, (ext << 3) | (size == 1 ? 0x02 : 0x03), dst->reg, dst, src);
+    }
+}
+
+static void encodeMov(const Operand *dst, const Operand *src) {
+    if (dst->kind == OPD_IMM) fail("destinazione immediata");
+    if (src->kind == OPD_REG) {
+        int size = operationSize(dst, src);
+        encodeRM1(size, size == 1 ? 0x88 : 0x89, src->reg, src, dst);
+    } else if (src->kind == OPD_MEM) {
+        if (dst->kind != OPD_REG) fail("due operandi in memoria");
+        int size = operationSize(src, dst);
+        encodeRM1(size, size == 1 ? 0x8A : 0x8B, dst->reg, dst, src);
+    } else if (dst->kind == OPD_REG) {
+        int size = dst->size;
+        long long v = src->sum.value;
+        int rex = (dst->reg & 8) ? 0x41 : 0;
+        if (size == 1 && needsRexForByte(dst)) rex |= 0x40;
+        if (size == 8 && src->sum.symbol < 0 && (v < 0 || v > 0xFFFFFFFFLL)) {
+            if (fits32(v)) {
+                // Immediato con segno esteso a 64 bit
+                encodeRM1(8, 0xC7, 0, NULL, dst);
+                immediate(v, 4);
+            } else {
+                byte1(0x48 | rex);
+                byte1(0xB8 | (dst->reg & 7));
+                immediate(v, 8);
+            }
+            return;
+        }
+        // A 64 bit basta la forma a 32: la scrittura azzera la parte alta
+        if (size == 2) byte1(0x66);
+        if (rex) byte1(rex);
+        byte1((size == 1 ? 0xB0 : 0xB8) | (dst->reg & 7));
+        if (size == 8 && src->sum.symbol < 0) immediate(v, 4);
+        else immediateOfSize(&src->sum, size == 8 ? 4 : size);
+    } else {
+        int size = operationSize(dst, NULL);
+        encodeRM1(size, size == 1 ? 0xC6 : 0xC7, 0, NULL, dst);
+        if (size == 8 && src->sum.symbol < 0 && !fits32(src->sum.value)) fail("immediato oltre 32 bit");
+        immediateOfSize(&src->sum, size == 8 ? 4 : size);
+    }
+}
+
+// neg, not, mul, imul, div, idiv a un operando: /ext nel gruppo F6/F7
+static void encodeUnary(int ext, const Operand *op) {
+    if (op->kind == OPD_IMM) fail("operando immediato");
+    int size = operationSize(op, NULL);
+    encodeRM1(size, size == 1 ? 0xF6 : 0xF7, ext, NULL, op);
+}
+
+static void encodeShift(int ext, const Operand *dst, const Operand *count) {
+    if (dst->kind == OPD_IMM) fail("destinazione immediata");
+    int size = operationSize(dst, NULL);
+    if (count->kind == OPD_REG) {
+        if (count->reg != 1 || count->size != 1) fail("lo scorrimento accetta solo cl");
+        encodeRM1(size, size == 1 ? 0xD2 : 0xD3, ext, NULL, dst);
+    } else if (count->kind == OPD_IMM && count->sum.symbol < 0) {
+        if (count->sum.value == 1) {
+            encodeRM1(size, size == 1 ? 0xD0 : 0xD1, ext, NULL, dst);
+        } else {
+            encodeRM1(size, size == 1 ? 0xC0 : 0xC1, ext, NULL, dst);
+            immediate(count->sum.value, 1);
+        }
+    } else {
+        fail("conteggio dello scorrimento non valido");
+    }
+}
+
+static void encodeImul(int count, const Operand *op) {
+    if (count == 1) {
+        encodeUnary(5, &op[0]);
+        return;
+    }
+    // imul r, imm sta per imul r, r, imm
+    const Operand *src = count == 2 && op[1].kind == OPD_IMM ? &op[0] : &op[1];
+    const Operand *factor = count == 3 ? &op[2] : (src == &op[0] ? &op[1] : NULL);
+    if (op[0].kind != OPD_REG || src->kind == OPD_IMM) fail("forma di imul non supportata");
+    int size = operationSize(src, &op[0]);
+    if (!factor) {
+        encodeRM2(size, 0xAF, op[0].reg, &op[0], src);
+        return;
+    }
+    if (factor->kind != OPD_IMM) fail("forma di imul non supportata");
+    if (factor->sum.symbol < 0 && fits8(factor->sum.value)) {
+        encodeRM1(size, 0x6B, op[0].reg, &op[0], src);
+        immediate(factor->sum.value, 1);
+    } else {
+        encodeRM1(size, 0x69, op[0].reg, &op[0], src);
+        immediateOfSize(&factor->sum, size == 2 ? 2 : 4);
+    }
+}
+
+static void encodePushPop(int isPush, const Operand *op) {
+    if (op->kind == OPD_REG) {
+        if (op->size != 8) fail("push/pop solo su registri a 64 bit");
+        if (op->reg & 8) byte1(0x41);
+        byte1((isPush ? 0x50 : 0x58) | (op->reg & 7));
+    } else if (op->kind == OPD_MEM) {
+        if (op->size && op->size != 8) fail("push/pop solo su qword");
+        encodeRM1(4, isPush ? 0xFF : 0x8F, isPush ? 6 : 0, NULL, op);
+    } else {
+        if (!isPush) fail("pop su un immediato");
+        if (op->sum.symbol < 0 && fits8(op->sum.value)) {
+            byte1(0x6A);
+            immediate(op->sum.value, 1);
+        } else {
+            byte1(0x68);
+            field32(&op->sum, FIX_ABS32);
+        }
+    }
+}
+
+// Salto o chiamata: verso un'etichetta si codifica in layoutText()
+static void encodeBranch(BranchKind kind, int cond, const char *text, int indirectExt) {
+    Operand op;
+    const char *p = skipBlanks(text);
+    int size;
+    if (*p == '[' || strncmp(p, "qword", 5) == 0 || parseRegister(p, (int) strlen(p), &size) >= 0) {
+        if (kind == BR_JCC) fail("salto condizionato indiretto");
+        parseOperand(text, &op);
+        if (op.kind == OPD_MEM && !op.size) op.size = 8;
+        if (op.size != 8) fail("salto indiretto non a 64 bit");
+        encodeRM1(4, 0xFF, indirectExt, NULL, &op);
+        return;
+    }
+    const char *end = p + strlen(p);
+    while (end > p && end[-1] == ' ') end--;
+    cur->branch = (unsigned char) kind;
+    cur->cond = (unsigned char) cond;
+    cur->target = symbolId(p, (int) (end - p));
+    if (segmentOf[cur->target] != SEG_TEXT) fail("destinazione del salto non è nel codice");
+}
+
+// Istruzioni su stringhe, con eventuale prefisso rep/repe/repne
+static int encodeStringOp(int prefix, const char *name) {
+    static const struct { const char *name; int rexW; int opcode; } ops[] = {
+        { "movsb", 0, 0xA4 }, { "movsq", 1, 0xA5 }, { "cmpsb", 0, 0xA6 },
+        { "stosb", 0, 0xAA }, { "stosq", 1, 0xAB }, { "lodsb", 0, 0xAC },
+        { "scasb", 0, 0xAE }
+    };
+    for (int i = 0; i < (int) (sizeof(ops) / sizeof(ops[0])); i++) {
+        if (strcmp(name, ops[i].name) != 0) continue;
+        if (prefix) byte1(prefix);
+        if (ops[i].rexW) byte1(0x48);
+        byte1(ops[i].opcode);
+        return 1;
+    }
+    return 0;
+}
+
+static void encodeInstr(AsmLine *line) {
+    static const char *alu[] = { "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp" };
+    static const struct { const char *name; int ext; } unary[] = {
+        { "not", 2 }, { "neg", 3 }, { "mul", 4 }, { "div", 6 }, { "idiv", 7 }
+    };
+    static const struct { const char *name; int ext; } shifts[] = {
+        { "rol", 0 }, { "ror", 1 }, { "shl", 4 }, { "sal", 4 }, { "shr", 5 }, { "sar", 7 }
+    };
+    static const struct { const char *name; int bytes; unsigned char code[2]; } plain[] = {
+        { "ret", 1, { 0xC3 } }, { "syscall", 2, { 0x0F, 0x05 } }, { "cqo", 2, { 0x48, 0x99 } },
+        { "cdq", 1, { 0x99 } }, { "cdqe", 2, { 0x48, 0x98 } }, { "nop", 1, { 0x90 } },
+        { "leave", 1, { 0xC9 } }, { "int3", 1, { 0xCC } }, { "ud2", 2, { 0x0F, 0x0B } }
+    };
+    const char *m = line->mnemonic;
+    int n = line->operandCount;
+    Operand op[MAX_ASM_OPERANDS];
+
+    for (int i = 0; i < (int) (sizeof(plain) / sizeof(plain[0])); i++) {
+        if (strcmp(m, plain[i].name) != 0) continue;
+        if (n != 0) fail("operandi inattesi");
+        for (int b = 0; b < plain[i].bytes; b++) byte1(plain[i].code[b]);
+        return;
+    }
+
+    // Salti e chiamate: l'operando è un'etichetta, non un'espressione
+    if (strcmp(m, "jmp") == 0 || strcmp(m, "call") == 0) {
+        if (n != 1) fail("numero di operandi errato");
+        int isCall = m[0] == 'c';
+        encodeBranch(isCall ? BR_CALL : BR_JMP, 0, line->operands[0], isCall ? 2 : 4);
+        return;
+    }
+    if (m[0] == 'j' && parseCondition(m + 1) >= 0) {
+        if (n != 1) fail("numero di operandi errato");
+        encodeBranch(BR_JCC, parseCondition(m + 1), line->operands[0], 0);
+        return;
+    }
+    if (strcmp(m, "rep") == 0 || strcmp(m, "repe") == 0 || strcmp(m, "repz") == 0 ||
+        strcmp(m, "repne") == 0 || strcmp(m, "repnz") == 0) {
+        int prefix = strncmp(m, "repn", 4) == 0 ? 0xF2 : 0xF3;
+        if (n != 1 || !encodeStringOp(prefix, line->operands[0])) fail("istruzione su stringhe non supportata");
+        return;
+    }
+    if (n == 0 && encodeStringOp(0, m)) return;
+
+    for (int i = 0; i < n; i++) parseOperand(line->operands[i], &op[i]);
+
+    for (int i = 0; i < 8; i++) {
+        if (strcmp(m, alu[i]) != 0) continue;
+        if (n != 2) fail("numero di operandi errato");
+        encodeAlu(i, &op[0], &op[1]);
+        return;
+    }
+    for (int i = 0; i < (int) (sizeof(unary) / sizeof(unary[0])); i++) {
+        if (strcmp(m, unary[i].name) != 0) continue;
+        if (n != 1) fail("numero di operandi errato");
+        encodeUnary(unary[i].ext, &op[0]);
+        return;
+    }
+    for (int i = 0; i < (int) (sizeof(shifts) / sizeof(shifts[0])); i++) {
+        if (strcmp(m, shifts[i].name) != 0) continue;
+        if (n != 2) fail("numero di operandi errato");
+        encodeShift(shifts[i].ext, &op[0], &op[1]);
+        return;
+    }
+
+    if (strcmp(m, "mov") == 0 && n == 2) {
+        encodeMov(&op[0], &op[1]);
+    } else if (strcmp(m, "imul") == 0 && n >= 1) {
+        encodeImul(n, op);
+    } else if ((strcmp(m, "push") == 0 || strcmp(m, "pop") == 0) && n == 1) {
+        encodePushPop(m[1] == 'u', &op[0]);
+    } else if (strcmp(m, "lea") == 0 && n == 2) {
+        if (op[0].kind != OPD_REG || op[1].kind != OPD_MEM) fail("forma di lea non supportata");
+        encodeRM1(op[0].size, 0x8D, op[0].reg, &op[0], &op[1]);
+    } else if (strcmp(m, "test") == 0 && n == 2) {
+        if (op[1].kind == OPD_IMM) {
+            int size = operationSize(&op[0], NULL);
+            encodeRM1(size, size == 1 ? 0xF6 : 0xF7, 0, NULL, &op[0]);
+            immediateOfSize(&op[1].sum, size == 8 ? 4 : size);
+        } else if (op[1].kind == OPD_REG) {
+            int size = operationSize(&op[0], &op[1]);
+            encodeRM1(size, size == 1 ? 0x84 : 0x85, op[1].reg, &op[1], &op[0]);
+        } else {
+            fail("forma di test non supportata");
+        }
+    } else if ((strcmp(m, "inc") == 0 || strcmp(m, "dec") == 0) && n == 1) {
+        int size = operationSize(&op[0], NULL);
+        encodeRM1(size, size == 1 ? 0xFE : 0xFF, m[0] == 'd', NULL, &op[0]);
+    } else if ((strcmp(m, "movzx") == 0 || strcmp(m, "movsx") == 0) && n == 2) {
+        if (op[0].kind != OPD_REG || op[1].kind == OPD_IMM) fail("forma di movzx/movsx non supportata");
+        int srcSize = op[1].size;
+        if (srcSize != 1 && srcSize != 2) fail("sorgente di movzx/movsx non a 8 o 16 bit");
+        int opcode = (m[3] == 'z' ? 0xB6 : 0xBE) + (srcSize == 2);
+        encodeRM2(op[0].size, opcode, op[0].reg, &op[0], &op[1]);
+    } else if (strcmp(m, "movsxd") == 0 && n == 2) {
+        if (op[0].kind != OPD_REG || op[0].size != 8 || op[1].kind == OPD_IMM) fail("forma di movsxd non supportata");
+        encodeRM1(8, 0x63, op[0].reg, &op[0], &op[1]);
+    } else if (strncmp(m, "set", 3) == 0 && parseCondition(m + 3) >= 0 && n == 1) {
+        if (op[0].kind == OPD_IMM || operationSize(&op[0], NULL) != 1) fail("setcc vuole un byte");
+        encodeRM2(1, 0x90 + parseCondition(m + 3), 0, NULL, &op[0]);
+    } else if (strncmp(m, "cmov", 4) == 0 && parseCondition(m + 4) >= 0 && n == 2) {
+        if (op[0].kind != OPD_REG || op[1].kind == OPD_IMM || op[0].size == 1) fail("forma di cmov non supportata");
+        encodeRM2(op[0].size, 0x40 + parseCondition(m + 4), op[0].reg, &op[0], &op[1]);
+    } else {
+        fail("istruzione non supportata");
+    }
+}
+
+// ---------- DATI ----------
+
+static _Thread_local unsigned char *data;
+static _Thread_local int dataSize, dataCap;
+static _Thread_local long long bssSize;
+
+static void dataByte(int b) {
+    if (dataSize == dataCap) {
+        dataCap = dataCap ? dataCap * 2 : 4096;
+        data = realloc(data, dataCap);
+    }
+    data[dataSize++] = (unsigned char) b;
+}
+
+// Posizione corrente in .data o .bss (anche per $)
+static long long segmentOffset() {
+    if (currentSegment == SEG_TEXT) fail("dati in .text");
+    currentOffset = currentSegment == SEG_DATA ? dataSize : bssSize;
+    return currentOffset;
+}
+
+// db/dw/dd/dq: costanti separate da virgole; le stringhe vanno solo in db
+static void emitDataItems(const char *p, int width) {
+    if (currentSegment != SEG_DATA) fail("dati inizializzati fuori da .data");
+    while (*(p = skipBlanks(p))) {
+        const char *end = p;
+        if (*p == '"' || *p == '`') {
+            char quote = *p;
+            end = strchr(p + 1, quote);
+            if (!end || width != 1) fail("stringa non valida");
+            for (const char *c = p + 1; c < end; c++) dataByte(*c);
+            end++;
+        } else {
+            int quoted = 0;
+            while (*end && (quoted || *end != ',')) {
+                if (*end == '\'') quoted = !quoted;
+                end++;
+            }
+            Sum sum;
+            segmentOffset();
+            parseSum(p, end, &sum, 0);
+            if (sum.symbol >= 0) fail("indirizzi nei dati non supportati");
+            for (int i = 0; i < width; i++) dataByte((int) ((unsigned long long) sum.value >> (8 * i)) & 0xFF);
+        }
+        end = skipBlanks(end);
+        if (*end == ',') end++;
+        else if (*end) fail("separatore atteso");
+        p = end;
+    }
+}
+
+static long long parseConstant(const char *p) {
+    Sum sum;
+    parseSum(p, p + strlen(p), &sum, 0);
+    if (sum.symbol >= 0) fail("costante attesa");
+    return sum.value;
+}
+
+static void alignData(long long alignment) {
+    if (alignment <= 0 || (alignment & (alignment - 1))) fail("allineamento non valido");
+    if (currentSegment == SEG_DATA) {
+        while (dataSize & (alignment - 1)) dataByte(0);
+    } else if (currentSegment == SEG_BSS) {
+        bssSize = (long long) alignUp(bssSize, alignment);
+    }
+}
+
+// Prima passata sulle direttive: section, dati, equ, align (in text conta
+// come un elemento, codificato nella seconda passata)
+static const struct { const char *name; int width; int reserve; } dataKinds[] = {
+    { "db", 1, 0 }, { "dw", 2, 0 }, { "dd", 4, 0 }, { "dq", 8, 0 },
+    { "resb", 1, 1 }, { "resw", 2, 1 }, { "resd", 4, 1 }, { "resq", 8, 1 }
+};
+
+#define NUM_DATA_KINDS ((int) (sizeof(dataKinds) / sizeof(dataKinds[0])))
+
+static int dataKind(const char *word, int len) {
+    for (int i = 0; i < NUM_DATA_KINDS; i++) {
+        if (matches(word, len, dataKinds[i].name)) return i;
+    }
+    return -1;
+}
+
+static void defineDirective(const char *text, int *textItems) {
+    const char *p = skipBlanks(text);
+    const char *word = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+    int wordLen = (int) (p - word);
+    p = skipBlanks(p);
+
+    if (matches(word, wordLen, "section") || matches(word, wordLen, "segment")) {
+        if (strcmp(p, ".text") == 0) currentSegment = SEG_TEXT;
+        else if (strcmp(p, ".data") == 0 || strcmp(p, ".rodata") == 0) currentSegment = SEG_DATA;
+        else if (strcmp(p, ".bss") == 0) currentSegment = SEG_BSS;
+        else fail("sezione sconosciuta");
+        return;
+    }
+    if (matches(word, wordLen, "global") || matches(word, wordLen, "default")) return;
+    if (matches(word, wordLen, "align")) {
+        if (currentSegment == SEG_TEXT) (*textItems)++;
+        else alignData(parseConstant(p));
+        return;
+    }
+
+    // [nome] direttiva argomenti
+    const char *name = NULL;
+    int nameLen = 0;
+    const char *kind = word;
+    int kindLen = wordLen;
+    if (*p && dataKind(word, wordLen) < 0) {
+        name = word;
+        nameLen = wordLen;
+        kind = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+        kindLen = (int) (p - kind);
+        p = skipBlanks(p);
+    }
+
+    if (matches(kind, kindLen, "equ")) {
+        if (!name) fail("equ senza nome");
+        if (currentSegment != SEG_TEXT) segmentOffset();
+        defineSymbol(name, nameLen, SEG_ABS, parseConstant(p));
+        return;
+    }
+    int i = dataKind(kind, kindLen);
+    if (i < 0) fail("direttiva non supportata");
+    if (name) defineSymbol(name, nameLen, currentSegment, segmentOffset());
+    if (!dataKinds[i].reserve) {
+        emitDataItems(p, dataKinds[i].width);
+    } else {
+        if (currentSegment != SEG_BSS) fail("res* fuori da .bss");
+        bssSize += dataKinds[i].width * parseConstant(p);
+    }
+}
+
+// ---------- DISPOSIZIONE ----------
+
+static int branchLength(const Item *item) {
+    if (item->branch == BR_CALL) return 5;
+    if (item->branch == BR_JMP) return item->isLong ? 5 : 2;
+    return item->isLong ? 6 : 2;
+}
+
+static long long itemLength(const Item *item, long long pc) {
+    if (item->align) return (-pc) & (item->align - 1);
+    if (item->branch) return branchLength(item);
+    return item->length;
+}
+
+// Offset di ogni elemento (e della fine, in offsets[itemCount]). I salti
+// partono corti e si allungano finché qualcuno non raggiunge la destinazione:
+// gli allungamenti sono monotoni, quindi il ciclo termina.
+static long long* layoutText() {
+    long long *offsets = malloc(sizeof(long long) * (itemCount + 1));
+    for (int i = 0; i < itemCount; i++) items[i].isLong = items[i].branch == BR_CALL;
+    int changed;
+    do {
+        long long pc = 0;
+        for (int i = 0; i < itemCount; i++) {
+            offsets[i] = pc;
+            pc += itemLength(&items[i], pc);
+        }
+        offsets[itemCount] = pc;
+
+        changed = 0;
+        for (int i = 0; i < itemCount; i++) {
+            Item *item = &items[i];
+            if (!item->branch || item->isLong) continue;
+            long long distance = offsets[valueOf[item->target]] - (offsets[i] + 2);
+            if (!fits8(distance)) {
+                item->isLong = 1;
+                changed = 1;
+            }
+        }
+    } while (changed);
+    return offsets;
+}
+
+// Riempitivo con le nop multi-byte consigliate da Intel
+static void emitPadding(unsigned char *out, long long length) {
+    static const unsigned char nops[9][9] = {
+        { 0x90 },
+        { 0x66, 0x90 },
+        { 0x0F, 0x1F, 0x00 },
+        { 0x0F, 0x1F, 0x40, 0x00 },
+        { 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 }
+    };
+    while (length > 0) {
+        int chunk = length > 9 ? 9 : (int) length;
+        memcpy(out, nops[chunk - 1], chunk);
+        out += chunk;
+        length -= chunk;
+    }
+}
+
+static void emitBranch(unsigned char *out, const Item *item, long long offset, long long target) {
+    int length = branchLength(item);
+    long long distance = target - (offset + length);
+    int pos = 0;
+    if (item->branch == BR_CALL) {
+        out[pos++] = 0xE8;
+    } else if (item->branch == BR_JMP) {
+        out[pos++] = item->isLong ? 0xE9 : 0xEB;
+    } else if (item->isLong) {
+        out[pos++] = 0x0F;
+        out[pos++] = (unsigned char) (0x80 | item->cond);
+    } else {
+        out[pos++] = (unsigned char) (0x70 | item->cond);
+    }
+    if (!fits32(distance)) fail("salto oltre 2 GiB");
+    for (; pos < length; pos++) {
+        out[pos] = (unsigned char) (distance & 0xFF);
+        distance >>= 8;
+    }
+}
+
+// ---------- API ----------
+
+static void resetAssembler() {
+    free(items);
+    free(segmentOf);
+    free(valueOf);
+    items = NULL;
+    segmentOf = NULL;
+    valueOf = NULL;
+    itemCount = itemCap = symbolCap = 0;
+    data = NULL;
+    dataSize = dataCap = 0;
+    bssSize = 0;
+}
+
+MachineCode* assembleProgram(AsmProgram *program) {
+    resetAssembler();
+
+    // Prima passata: simboli e dati
+    int textItems = 0;
+    scope[0] = '\0';
+    currentSegment = SEG_TEXT;
+    for (AsmLine *line = program->first; line; line = line->next) {
+        context = line;
+        if (line->kind == ASM_LABEL) {
+            long long value = currentSegment == SEG_TEXT ? textItems : segmentOffset();
+            defineSymbol(line->text, (int) strlen(line->text), currentSegment, value);
+            if (line->text[0] != '.') strcpy(scope, line->text);
+        } else if (line->kind == ASM_DIRECTIVE) {
+            defineDirective(line->text, &textItems);
+        } else {
+            if (currentSegment != SEG_TEXT) fail("istruzione fuori da .text");
+            textItems++;
+        }
+    }
+
+    // Seconda passata: istruzioni
+    scope[0] = '\0';
+    currentSegment = SEG_TEXT;
+    for (AsmLine *line = program->first; line; line = line->next) {
+        if (line->kind == ASM_LABEL) {
+            if (line->text[0] != '.') strcpy(scope, line->text);
+        } else if (line->kind == ASM_DIRECTIVE) {
+            context = line;
+            const char *p = skipBlanks(line->text);
+            if (strncmp(p, "section", 7) == 0 || strncmp(p, "segment", 7) == 0) {
+                defineDirective(p, &textItems);
+            } else if (currentSegment == SEG_TEXT && strncmp(p, "align", 5) == 0) {
+                long long alignment = parseConstant(p + 5);
+                if (alignment <= 0 || alignment > 4096 || (alignment & (alignment - 1))) fail("allineamento non valido");
+                newItem();
+                cur->align = (unsigned char) (alignment > 128 ? 128 : alignment);
+            }
+        } else {
+            context = line;
+            newItem();
+            encodeInstr(line);
+        }
+    }
+    context = NULL;
+
+    long long *offsets = layoutText();
+    MachineCode *code = calloc(1, sizeof(MachineCode));
+    code->textSize = (int) offsets[itemCount];
+    code->text = malloc((size_t) code->textSize + 1);
+    code->fixups = malloc(sizeof(Fixup) * ((size_t) itemCount + 1));
+    for (int i = 0; i < itemCount; i++) {
+        Item *item = &items[i];
+        unsigned char *out = code->text + offsets[i];
+        if (item->align) {
+            emitPadding(out, offsets[i + 1] - offsets[i]);
+            continue;
+        }
+        if (item->branch) {
+            emitBranch(out, item, offsets[i], offsets[valueOf[item->target]]);
+            continue;
+        }
+        memcpy(out, item->bytes, item->length);
+        if (item->fixupAt < 0) continue;
+        Fixup *fixup = &code->fixups[code->fixupCount++];
+        fixup->offset = (int) offsets[i] + item->fixupAt;
+        fixup->end = (int) offsets[i] + item->length;
+        fixup->kind = (FixupKind) item->fixupKind;
+        fixup->segment = (Segment) segmentOf[item->target];
+        fixup->value = item->addend +
+            (fixup->segment == SEG_TEXT ? offsets[valueOf[item->target]] : valueOf[item->target]);
+    }
+
+    int start = internSymbol("_start", 6);
+    if (start >= symbolCap || segmentOf[start] != SEG_TEXT) {
+        sourceError(0, 0, "Errore dell'assemblatore: _start non definito");
+    }
+    code->entry = (int) offsets[valueOf[start]];
+    code->data = data;
+    code->dataSize = dataSize;
+    code->bssSize = (int) bssSize;
+    data = NULL;
+    free(offsets);
+    resetAssembler();
+    return code;
+}
+
+int relocateMachineCode(MachineCode *code, const unsigned long long address[SEG_COUNT]) {
+    for (int i = 0; i < code->fixupCount; i++) {
+        Fixup *fixup = &code->fixups[i];
+        long long value = (long long) (address[fixup->segment] + fixup->value);
+        if (fixup->kind == FIX_REL32) value -= (long long) (address[SEG_TEXT] + fixup->end);
+        // Gli assoluti a 32 bit vengono estesi col segno da quasi tutte le istruzioni
+        if (!fits32(value) || (fixup->kind == FIX_ABS32 && value < 0)) return 0;
+        for (int b = 0; b < 4; b++) code->text[fixup->offset + b] = (unsigned char) (value >> (8 * b));
+    }
+    return 1;
+}
+
+unsigned long long alignUp(unsigned long long value, unsigned long long alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void freeMachineCode(MachineCode *code) {
+    free(code->text);
+    free(code->data);
+    free(code->fixups);
+    free(code);
+}
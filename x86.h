@@ -0,0 +1,54 @@
+#ifndef X86_H
+#define X86_H
+
+#include "asm.h"
+
+// Assemblatore x86-64: traduce il programma in memoria (asm.h) direttamente
+// in codice macchina, senza passare dal testo NASM. Accetta la sintassi NASM
+// che producono il codegen e il peephole: etichette locali (.L1) relative
+// all'ultima etichetta non locale, section, db/dw/dd/dq, resb/resq, equ,
+// align. I salti usano la forma corta quando l'offset sta in 8 bit.
+
+typedef enum {
+    SEG_TEXT,
+    SEG_DATA,
+    SEG_BSS,
+    SEG_COUNT,
+    SEG_ABS = SEG_COUNT     // costante (equ): nessun segmento
+} Segment;
+
+typedef enum {
+    FIX_ABS32,      // indirizzo assoluto a 32 bit (immediato o spiazzamento)
+    FIX_REL32       // spiazzamento relativo a rip (fine dell'istruzione)
+} FixupKind;
+
+// Campo a 32 bit del codice che dipende dagli indirizzi dei segmenti
+typedef struct {
+    int offset;             // posizione del campo in text
+    int end;                // fine dell'istruzione (base per FIX_REL32)
+    FixupKind kind;
+    Segment segment;        // segmento del simbolo riferito
+    long long value;        // offset del simbolo nel segmento + addendo
+} Fixup;
+
+typedef struct {
+    unsigned char *text;
+    int textSize;
+    unsigned char *data;
+    int dataSize;
+    int bssSize;
+    int entry;              // offset di _start in text
+    Fixup *fixups;
+    int fixupCount;
+} MachineCode;
+
+// Errori (istruzioni o operandi non supportati) abbandonano la compilazione (failCompilation)
+MachineCode* assembleProgram(AsmProgram *program);
+// Scrive nel codice gli indirizzi scelti per i segmenti. Restituisce 0 se un
+// riferimento non è rappresentabile in 32 bit.
+int relocateMachineCode(MachineCode *code, const unsigned long long address[SEG_COUNT]);
+void freeMachineCode(MachineCode *code);
+// Multiplo di alignment (potenza di 2) più vicino da sopra, per disporre i segmenti
+unsigned long long alignUp(unsigned long long value, unsigned long long alignment);
+
+#endif // X86_H